@@ -1,4 +1,4 @@
-from libc.stdint cimport uint16_t, uint32_t, uint64_t, int32_t
+from libc.stdint cimport uint16_t, uint32_t, uint64_t, int32_t, int64_t
 
 cdef extern from "ismrmrd/version.h":
     cdef enum:
@@ -227,12 +227,57 @@ cdef extern from "ismrmrd/ismrmrd.h":
             float read_dir[3], float phase_dir[3], float slice_dir[3])
 
 cdef extern from "ismrmrd/dataset.h":
+    ctypedef struct ISMRMRD_DatasetCache:
+        pass
+
+    cdef enum:
+        ISMRMRD_MAX_FILTER_PARAMS = 8
+
+    ctypedef struct ISMRMRD_CompressionOptions:
+        int shuffle                       # Non-zero applies the HDF5 byte shuffle filter
+        int deflate_level                 # Deflate level from 1 to 9, 0 disables deflate
+        unsigned int filter_id            # Registered HDF5 filter, 0 for none
+        unsigned int filter_num_params    # Number of used filter_params
+        unsigned int filter_params[ISMRMRD_MAX_FILTER_PARAMS]
+
+    ctypedef struct ISMRMRD_DatasetOptions:
+        uint32_t acquisition_chunk_rows   # Acquisitions per chunk, 0 sizes the chunks by chunk_size
+        uint32_t image_chunk_rows         # Images per chunk of header, attributes and data
+        uint32_t array_chunk_rows         # NDArrays per chunk
+        size_t chunk_size                 # Target chunk size in bytes for variables with 0 rows per chunk
+        size_t chunk_cache_size           # Raw data chunk cache in bytes for each open variable
+        size_t chunk_cache_slots          # Number of hash slots in the chunk cache
+        size_t meta_block_size            # Minimum size in bytes of metadata block allocations
+        int index_acquisitions            # Non-zero keeps the acquisition index up to date while appending
+        int acquisition_layout            # One of ISMRMRD_AcquisitionLayouts
+        int swmr                          # One of ISMRMRD_SwmrModes
+        uint32_t swmr_flush_rows          # Acquisitions appended between flushes to SWMR readers
+        int driver                        # One of ISMRMRD_FileDrivers
+        size_t core_increment             # With ISMRMRD_DRIVER_CORE, bytes by which the memory of the file grows
+        int core_backing_store            # With ISMRMRD_DRIVER_CORE, non-zero writes the file to disk when it is closed
+        uint32_t uring_queue_depth        # With ISMRMRD_DRIVER_IO_URING, most requests in flight at once
+        size_t direct_io_size             # With ISMRMRD_DRIVER_IO_URING, transfers bypassing the page cache
+        int file_format                   # One of ISMRMRD_FileFormats
+        size_t file_space_page_size       # Page size in bytes of the paged file space of new files
+        size_t page_buffer_size           # Bytes of the page buffer of files with paged file space
+        size_t alignment                  # Alignment in bytes of large file objects
+        size_t alignment_threshold        # Smallest file object in bytes that is aligned
+        size_t sieve_buf_size             # Bytes of the sieve buffer for partial I/O on contiguous data
+        int extent_growth                 # One of ISMRMRD_ExtentGrowth
+        uint32_t extent_block_rows        # With ISMRMRD_GROWTH_BLOCKS, rows added to a full variable
+        ISMRMRD_CompressionOptions acquisition_compression
+        ISMRMRD_CompressionOptions image_compression
+        ISMRMRD_CompressionOptions array_compression
+
     ctypedef struct ISMRMRD_Dataset:
         char *filename
         char *groupname
-        int fileid
+        int64_t fileid
+        ISMRMRD_DatasetOptions options    # Used by ismrmrd_open_dataset
+        ISMRMRD_DatasetCache *cache       # Open datasets and datatypes, owned by the library while the file is open
 
     cdef int ismrmrd_init_dataset(ISMRMRD_Dataset*, const char*, const char*)
+    cdef int ismrmrd_init_dataset_options(ISMRMRD_DatasetOptions*)
     cdef int ismrmrd_open_dataset(ISMRMRD_Dataset*, const bint)
     cdef int ismrmrd_close_dataset(ISMRMRD_Dataset*)
     cdef char *ismrmrd_read_header(const ISMRMRD_Dataset *)
@@ -0,0 +1,202 @@
+/* ISMRMRD Dataset Storage Backends */
+
+/**
+ * @file backend.h
+ */
+
+#pragma once
+#ifndef ISMRMRD_BACKEND_H
+#define ISMRMRD_BACKEND_H
+
+#include "ismrmrd/dataset.h"
+#include "ismrmrd/stream.h"
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ISMRMRD {
+
+/**
+ * Storage of the header, acquisitions, images and arrays of a dataset.
+ *
+ * The public methods check their arguments and call the protected virtual
+ * methods, which a backend implements. Indices are checked against the
+ * counts before a backend is asked to read.
+ */
+class EXPORTISMRMRD DatasetBackend {
+public:
+    virtual ~DatasetBackend();
+
+    // XML Header
+    void writeHeader(const std::string &xmlstring);
+    void readHeader(std::string &xmlstring);
+    // Acquisitions
+    void appendAcquisition(const Acquisition &acq);
+    void appendAcquisitions(const std::vector<Acquisition> &acqs);
+    void readAcquisition(uint32_t index, Acquisition &acq);
+    void readAcquisitions(uint32_t start, uint32_t count, std::vector<Acquisition> &acqs);
+    uint32_t getNumberOfAcquisitions();
+    // Images
+    template <typename T> void appendImage(const std::string &var, const Image<T> &im);
+    void appendImage(const std::string &var, const ISMRMRD_Image *im);
+    /// Throws if the image is not of type T, im is left unchanged
+    template <typename T> void readImage(const std::string &var, uint32_t index, Image<T> &im);
+    /// Reads an image of any data type
+    void readImage(const std::string &var, uint32_t index, ISMRMRD_Image *im);
+    uint32_t getNumberOfImages(const std::string &var);
+    // NDArrays
+    template <typename T> void appendNDArray(const std::string &var, const NDArray<T> &arr);
+    void appendNDArray(const std::string &var, const ISMRMRD_NDArray *arr);
+    /// Throws if the array is not of type T, arr is left unchanged
+    template <typename T> void readNDArray(const std::string &var, uint32_t index, NDArray<T> &arr);
+    /// Reads an array of any data type
+    void readNDArray(const std::string &var, uint32_t index, ISMRMRD_NDArray *arr);
+    uint32_t getNumberOfNDArrays(const std::string &var);
+
+    /// Writes out what the backend buffers
+    void flush();
+
+protected:
+    DatasetBackend();
+
+    virtual void doWriteHeader(const std::string &xmlstring) = 0;
+    virtual void doReadHeader(std::string &xmlstring) = 0;
+    virtual void doAppendAcquisitions(const ISMRMRD_Acquisition *acqs, uint32_t count) = 0;
+    /// acqs are initialized, their buffers may be reused
+    virtual void doReadAcquisitions(uint32_t start, uint32_t count, ISMRMRD_Acquisition *acqs) = 0;
+    virtual uint32_t doGetNumberOfAcquisitions() = 0;
+    virtual void doAppendImage(const std::string &var, const ISMRMRD_Image *im) = 0;
+    virtual void doReadImage(const std::string &var, uint32_t index, ISMRMRD_Image *im) = 0;
+    virtual uint32_t doGetNumberOfImages(const std::string &var) = 0;
+    virtual void doAppendNDArray(const std::string &var, const ISMRMRD_NDArray *arr) = 0;
+    virtual void doReadNDArray(const std::string &var, uint32_t index, ISMRMRD_NDArray *arr) = 0;
+    virtual uint32_t doGetNumberOfNDArrays(const std::string &var) = 0;
+    virtual void doFlush();
+
+private:
+    DatasetBackend(const DatasetBackend &);
+    DatasetBackend & operator= (const DatasetBackend &);
+};
+
+/**
+ * Stores a dataset in a group of an HDF5 file, like Dataset.
+ */
+class EXPORTISMRMRD HDF5Backend : public DatasetBackend {
+public:
+    HDF5Backend(const char *filename, const char *groupname, bool create_file_if_needed = true);
+    HDF5Backend(const char *filename, const char *groupname, bool create_file_if_needed,
+                const DatasetOptions &options);
+    ~HDF5Backend();
+
+protected:
+    virtual void doWriteHeader(const std::string &xmlstring);
+    virtual void doReadHeader(std::string &xmlstring);
+    virtual void doAppendAcquisitions(const ISMRMRD_Acquisition *acqs, uint32_t count);
+    virtual void doReadAcquisitions(uint32_t start, uint32_t count, ISMRMRD_Acquisition *acqs);
+    virtual uint32_t doGetNumberOfAcquisitions();
+    virtual void doAppendImage(const std::string &var, const ISMRMRD_Image *im);
+    virtual void doReadImage(const std::string &var, uint32_t index, ISMRMRD_Image *im);
+    virtual uint32_t doGetNumberOfImages(const std::string &var);
+    virtual void doAppendNDArray(const std::string &var, const ISMRMRD_NDArray *arr);
+    virtual void doReadNDArray(const std::string &var, uint32_t index, ISMRMRD_NDArray *arr);
+    virtual uint32_t doGetNumberOfNDArrays(const std::string &var);
+
+private:
+    void open(const char *filename, const char *groupname, bool create_file_if_needed,
+              const DatasetOptions &options);
+
+    ISMRMRD_Dataset dset_;
+};
+
+/**
+ * Keeps a dataset in memory.
+ *
+ * Appended acquisitions, images and arrays are copied, reads copy them out.
+ * The contents are lost when the backend is destroyed.
+ */
+class EXPORTISMRMRD MemoryBackend : public DatasetBackend {
+public:
+    MemoryBackend();
+    ~MemoryBackend();
+
+protected:
+    virtual void doWriteHeader(const std::string &xmlstring);
+    virtual void doReadHeader(std::string &xmlstring);
+    virtual void doAppendAcquisitions(const ISMRMRD_Acquisition *acqs, uint32_t count);
+    virtual void doReadAcquisitions(uint32_t start, uint32_t count, ISMRMRD_Acquisition *acqs);
+    virtual uint32_t doGetNumberOfAcquisitions();
+    virtual void doAppendImage(const std::string &var, const ISMRMRD_Image *im);
+    virtual void doReadImage(const std::string &var, uint32_t index, ISMRMRD_Image *im);
+    virtual uint32_t doGetNumberOfImages(const std::string &var);
+    virtual void doAppendNDArray(const std::string &var, const ISMRMRD_NDArray *arr);
+    virtual void doReadNDArray(const std::string &var, uint32_t index, ISMRMRD_NDArray *arr);
+    virtual uint32_t doGetNumberOfNDArrays(const std::string &var);
+
+private:
+    bool has_header_;
+    std::string header_;
+    std::vector<ISMRMRD_Acquisition> acquisitions_;
+    std::map<std::string, std::vector<ISMRMRD_Image> > images_;
+    std::map<std::string, std::vector<ISMRMRD_NDArray> > arrays_;
+};
+
+/**
+ * Stores a dataset in an append-only log file.
+ *
+ * The file is a sequence of messages in the stream format of stream.h. Every
+ * header, acquisition, image and array is appended as one message, a later
+ * header replaces an earlier one. Closing the backend appends an index of the
+ * message offsets and a footer pointing at it, reopening the file loads the
+ * index and appends after the footer. A file without a valid footer, e.g.
+ * after a crash, is indexed by scanning its messages.
+ *
+ * The file is opened for writing on the first append, so read-only files can
+ * be read. Writes are buffered until the next read, flush() or close.
+ */
+class EXPORTISMRMRD LogBackend : public DatasetBackend {
+public:
+    LogBackend(const char *filename, bool create_file_if_needed = true);
+    /// Writes the index, call flush() before to see write errors
+    ~LogBackend();
+
+protected:
+    virtual void doWriteHeader(const std::string &xmlstring);
+    virtual void doReadHeader(std::string &xmlstring);
+    virtual void doAppendAcquisitions(const ISMRMRD_Acquisition *acqs, uint32_t count);
+    virtual void doReadAcquisitions(uint32_t start, uint32_t count, ISMRMRD_Acquisition *acqs);
+    virtual uint32_t doGetNumberOfAcquisitions();
+    virtual void doAppendImage(const std::string &var, const ISMRMRD_Image *im);
+    virtual void doReadImage(const std::string &var, uint32_t index, ISMRMRD_Image *im);
+    virtual uint32_t doGetNumberOfImages(const std::string &var);
+    virtual void doAppendNDArray(const std::string &var, const ISMRMRD_NDArray *arr);
+    virtual void doReadNDArray(const std::string &var, uint32_t index, ISMRMRD_NDArray *arr);
+    virtual uint32_t doGetNumberOfNDArrays(const std::string &var);
+    virtual void doFlush();
+
+private:
+    typedef std::map<std::string, std::vector<uint64_t> > VariableIndex;
+
+    bool loadIndex();
+    void scan();
+    void writeIndex();
+    void beginAppend();
+    void seekRecord(uint64_t offset);
+
+    std::string filename_;
+    std::ifstream in_;
+    std::ofstream out_;
+    StreamWriter *writer_;      // created on the first append
+    uint64_t size_;             // of the file when it was opened
+    bool complete_;             // the file ends with a complete message
+    bool modified_;
+    uint64_t header_offset_;
+    std::vector<uint64_t> acquisitions_;
+    VariableIndex images_;
+    VariableIndex arrays_;
+};
+
+} // namespace ISMRMRD
+
+#endif // ISMRMRD_BACKEND_H
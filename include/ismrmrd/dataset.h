@@ -12,6 +12,7 @@
 
 #ifdef __cplusplus
 #include <string>
+#include <vector>
 namespace ISMRMRD {
 extern "C" {
 #endif
@@ -22,33 +23,269 @@ extern "C" {
  *   A given ISMRMRD dataset if assumed to be stored under one group name in the
  *   HDF5 file.  To make the datasets consistent, this library enforces that the
  *   XML configuration is stored in the variable groupname/xml and the
- *   Acquisitions are stored in the variable groupname/data.
+ *   Acquisitions are stored in the variable groupname/data, or in the
+ *   groupname/acquisitions group for the flat layout (see ISMRMRD_AcquisitionLayouts).
  *
  */
+typedef struct ISMRMRD_DatasetCache ISMRMRD_DatasetCache;
+
+/**
+ * Single-writer/multiple-reader modes of a dataset, see ISMRMRD_DatasetOptions.
+ */
+enum ISMRMRD_SwmrModes {
+    ISMRMRD_SWMR_OFF = 0,   /**< Normal read/write access */
+    ISMRMRD_SWMR_WRITE,     /**< Streams acquisitions to readers while appending */
+    ISMRMRD_SWMR_READ       /**< Read only access to a file being written in ISMRMRD_SWMR_WRITE mode */
+};
+
+/**
+ * Storage layouts of the acquisitions, see ISMRMRD_DatasetOptions.
+ *
+ * The layout is chosen when the first acquisitions are appended, a file that
+ * already holds acquisitions keeps its layout. Both layouts are read the same way.
+ */
+enum ISMRMRD_AcquisitionLayouts {
+    ISMRMRD_LAYOUT_VLEN = 0, /**< groupname/data, one row per acquisition with variable length traj and data */
+    ISMRMRD_LAYOUT_FLAT,     /**< groupname/acquisitions/header table and fixed shape arrays
+                                  groupname/acquisitions/data (acquisition x channel x sample) and
+                                  groupname/acquisitions/traj (acquisition x sample x dimension), for
+                                  acquisitions that all have the same shape */
+    ISMRMRD_LAYOUT_AUTO      /**< Flat while the acquisitions have the same shape, moved to vlen otherwise */
+};
+
+/**
+ * HDF5 file drivers of a dataset, see ISMRMRD_DatasetOptions.
+ */
+enum ISMRMRD_FileDrivers {
+    ISMRMRD_DRIVER_DEFAULT = 0, /**< The HDF5 default, POSIX I/O on the file */
+    ISMRMRD_DRIVER_CORE,        /**< The whole file is kept in memory, an existing file is read when it is opened */
+    ISMRMRD_DRIVER_IO_URING     /**< Linux io_uring, large transfers go in parallel pieces, POSIX I/O where it is not available */
+};
+
+/**
+ * Oldest HDF5 file format a dataset writes objects in, see ISMRMRD_DatasetOptions.
+ *
+ * Newer formats index links, attributes and chunks faster but the files can
+ * only be read by the HDF5 version that introduced them or later.
+ */
+enum ISMRMRD_FileFormats {
+    ISMRMRD_FORMAT_EARLIEST = 0, /**< The HDF5 default, each object in the earliest format that can store it */
+    ISMRMRD_FORMAT_V18,          /**< At least the format of HDF5 1.8 */
+    ISMRMRD_FORMAT_LATEST        /**< The latest format of the HDF5 library in use */
+};
+
+/**
+ * How appending grows the extent of a variable, see ISMRMRD_DatasetOptions.
+ *
+ * A variable grown ahead of its rows records the number of rows in its "count"
+ * attribute after every append, readers of this library read no further.
+ * Closing the dataset trims the variables it grew to their rows and removes the
+ * attribute, or leaves that to the last dataset to close a shared file.
+ */
+enum ISMRMRD_ExtentGrowth {
+    ISMRMRD_GROWTH_EXACT = 0,   /**< Every append extends the variable by the appended rows */
+    ISMRMRD_GROWTH_GEOMETRIC,   /**< A full variable doubles its extent */
+    ISMRMRD_GROWTH_BLOCKS       /**< A full variable grows by extent_block_rows rows */
+};
+
+/** Maximum number of parameters passed to a third-party compression filter */
+#define ISMRMRD_MAX_FILTER_PARAMS 8
+
+/**
+ * Default HDF5 filter id of the in-tree LZ codec.
+ *
+ * The id is in the range 256 to 511 that HDF5 leaves for testing, it is not
+ * registered with The HDF Group and another filter may use it. Variables
+ * compressed with the codec can only be read by applications that register
+ * this library's codec under the same id, h5dump and other HDF5 tools cannot
+ * read their chunks. ismrmrd_register_lz_filter_id registers the codec under
+ * another id.
+ */
+#define ISMRMRD_FILTER_LZ 306
+
+/**
+ * Compression of one kind of variable, see ISMRMRD_DatasetOptions.
+ *
+ * The filters run in the order shuffle, filter_id, deflate. All of them are
+ * optional HDF5 filters, a chunk that does not shrink is stored as is. Rows
+ * with variable length members are not compressed, use the flat acquisition
+ * layout to compress acquisition data.
+ */
+typedef struct ISMRMRD_CompressionOptions {
+    int shuffle;                      /**< Non-zero applies the HDF5 byte shuffle filter */
+    int deflate_level;                /**< Deflate level from 1 to 9, 0 disables deflate */
+    unsigned int filter_id;           /**< Registered HDF5 filter, e.g. ISMRMRD_FILTER_LZ, 0 for none */
+    unsigned int filter_num_params;   /**< Number of used filter_params */
+    unsigned int filter_params[ISMRMRD_MAX_FILTER_PARAMS]; /**< Client data of the filter */
+} ISMRMRD_CompressionOptions;
+
+/**
+ * Storage and I/O tuning for a dataset.
+ *
+ * The chunk settings apply to variables created while the dataset is open,
+ * variables already in the file keep the chunking they were written with.
+ */
+typedef struct ISMRMRD_DatasetOptions {
+    uint32_t acquisition_chunk_rows; /**< Acquisitions per chunk, 0 sizes the chunks by chunk_size */
+    uint32_t image_chunk_rows;       /**< Images per chunk of header, attributes and data, 0 sizes the chunks by chunk_size */
+    uint32_t array_chunk_rows;       /**< NDArrays per chunk, 0 sizes the chunks by chunk_size */
+    size_t chunk_size;               /**< Target chunk size in bytes for variables with 0 rows per chunk */
+    size_t chunk_cache_size;         /**< Raw data chunk cache in bytes for each open variable, 0 keeps the HDF5 default */
+    size_t chunk_cache_slots;        /**< Number of hash slots in the chunk cache, 0 keeps the HDF5 default */
+    size_t meta_block_size;          /**< Minimum size in bytes of metadata block allocations, 0 keeps the HDF5 default */
+    int index_acquisitions;          /**< Non-zero keeps the acquisition index up to date while appending acquisitions */
+    int acquisition_layout;          /**< One of ISMRMRD_AcquisitionLayouts, flat payload arrays are chunked by chunk_size */
+    int swmr;                        /**< One of ISMRMRD_SwmrModes */
+    uint32_t swmr_flush_rows;        /**< In ISMRMRD_SWMR_WRITE mode, acquisitions appended between flushes to readers, 0 flushes every append */
+    int driver;                      /**< One of ISMRMRD_FileDrivers */
+    size_t core_increment;           /**< With ISMRMRD_DRIVER_CORE, bytes by which the memory of the file grows, 0 uses 1 MB */
+    int core_backing_store;          /**< With ISMRMRD_DRIVER_CORE, non-zero writes the file to disk when it is closed */
+    uint32_t uring_queue_depth;      /**< With ISMRMRD_DRIVER_IO_URING, most requests in flight at once, 0 uses 32 */
+    size_t direct_io_size;           /**< With ISMRMRD_DRIVER_IO_URING, transfers of at least this many bytes bypass the page cache with O_DIRECT, 0 never */
+    int file_format;                 /**< One of ISMRMRD_FileFormats */
+    size_t file_space_page_size;     /**< Page size in bytes of the paged file space of new files, 0 keeps unpaged file space */
+    size_t page_buffer_size;         /**< Bytes of the page buffer of files with paged file space, 0 for none, not used in the SWMR modes */
+    size_t alignment;                /**< Alignment in bytes of file objects of at least alignment_threshold bytes, 0 keeps the HDF5 default */
+    size_t alignment_threshold;      /**< Smallest file object in bytes that is aligned */
+    size_t sieve_buf_size;           /**< Bytes of the sieve buffer for partial I/O on contiguous data, 0 keeps the HDF5 default */
+    int extent_growth;               /**< One of ISMRMRD_ExtentGrowth, appends grow the extent exactly in the SWMR modes */
+    uint32_t extent_block_rows;      /**< With ISMRMRD_GROWTH_BLOCKS, rows added to a full variable, 0 uses 1024 */
+    ISMRMRD_CompressionOptions acquisition_compression; /**< Compression of the acquisition variables */
+    ISMRMRD_CompressionOptions image_compression;       /**< Compression of the image header, attribute and data variables */
+    ISMRMRD_CompressionOptions array_compression;       /**< Compression of the NDArray variables */
+} ISMRMRD_DatasetOptions;
+
 typedef struct ISMRMRD_Dataset {
     char *filename;
     char *groupname;
-    int fileid;
+    int64_t fileid;
+    ISMRMRD_DatasetOptions options; /**< Used by ismrmrd_open_dataset, set by ismrmrd_init_dataset to the defaults */
+    ISMRMRD_DatasetCache *cache; /**< Open datasets and datatypes, owned by the library while the file is open */
 } ISMRMRD_Dataset;
 
 /**
  * Initializes an ISMRMRD dataset structure
  *
+ * The options are set to the defaults and may be changed before the dataset is opened.
  */
 EXPORTISMRMRD int ismrmrd_init_dataset(ISMRMRD_Dataset *dset, const char *filename, const char *groupname);
+
+/**
+ * Sets dataset options to the library defaults
+ *
+ */
+EXPORTISMRMRD int ismrmrd_init_dataset_options(ISMRMRD_DatasetOptions *options);
             
+/**
+ * Applies a named tuning profile to dataset options.
+ *
+ * The profiles set the file format, file space, buffer, cache, chunk, extent
+ * growth, compression and acquisition layout options from the defaults, the
+ * other options are left as they are. Apply a profile before changing single
+ * options:
+ *  - "default": the values set by ismrmrd_init_dataset_options
+ *  - "streaming-write": latest file format, objects from 512 kB aligned to
+ *    1 MB and 1 MB metadata blocks for striped file systems, geometric extent
+ *    growth, for files written by appending
+ *  - "random-read": latest file format, 64 kB pages of file space with a
+ *    16 MB page buffer and 16 MB chunk caches, for files read in any order.
+ *    The pages only apply to new files, existing files without them are read
+ *    without the page buffer
+ *  - "archive": earliest file format and shuffle plus deflate on all
+ *    variables with the ISMRMRD_LAYOUT_AUTO acquisition layout, for small
+ *    files that any HDF5 version reads
+ *
+ * Returns an error and leaves the options unchanged for an unknown profile.
+ */
+EXPORTISMRMRD int ismrmrd_set_dataset_profile(ISMRMRD_DatasetOptions *options, const char *profile);
+
 /**
  * Opens an ISMRMRD dataset.
  *
+ * With options.swmr set to ISMRMRD_SWMR_WRITE the file uses the latest file
+ * format and switches to single-writer/multiple-reader access on the first
+ * appended acquisition. The XML header must be written before then, no other
+ * variables can be created while streaming. Every options.swmr_flush_rows
+ * acquisitions the file is flushed and the number of acquisitions readers may
+ * read is recorded in groupname/data_committed.
+ *
+ * Readers open the file with ISMRMRD_SWMR_READ once the writer has started
+ * streaming and call ismrmrd_refresh_dataset to see new acquisitions.
+ *
+ * Datasets on the same file, e.g. the groups of a multi-measurement file,
+ * share one HDF5 file handle. Opening fails if the file driver, file format,
+ * metadata block, page buffer, alignment or sieve buffer options differ from
+ * those of the dataset that opened the file, the chunk cache options may
+ * differ. Files in the SWMR modes or with ISMRMRD_DRIVER_CORE are not shared.
  */
 EXPORTISMRMRD int ismrmrd_open_dataset(ISMRMRD_Dataset *dset, const bool create_if_neded);
 
+/**
+ * Opens an ISMRMRD dataset from a file image, e.g. one from ismrmrd_get_file_image.
+ *
+ * The image is copied into memory owned by the dataset, which is opened with
+ * ISMRMRD_DRIVER_CORE whatever options.driver is. The filename only names the
+ * file unless options.core_backing_store is set, then the file is written
+ * there when it is closed. SWMR access is not available.
+ */
+EXPORTISMRMRD int ismrmrd_open_dataset_from_image(ISMRMRD_Dataset *dset, const void *image, size_t size);
+
+/**
+ * Copies the file of an open dataset into a buffer.
+ *
+ * The file is flushed first. On success *image holds *size bytes allocated with
+ * malloc, which the caller frees with free. Works with any driver.
+ */
+EXPORTISMRMRD int ismrmrd_get_file_image(const ISMRMRD_Dataset *dset, void **image, size_t *size);
+
 /**
  * Closes all references to the underlying HDF5 file.
  *
+ * Variables grown ahead of their rows are trimmed first, see ISMRMRD_ExtentGrowth.
  */
 EXPORTISMRMRD int ismrmrd_close_dataset(ISMRMRD_Dataset *dset);
 
+/**
+ * Updates the open variables of a dataset opened in ISMRMRD_SWMR_READ mode
+ * with the acquisitions flushed by the writer since the last refresh.
+ *
+ * Does nothing in the other modes.
+ */
+EXPORTISMRMRD int ismrmrd_refresh_dataset(ISMRMRD_Dataset *dset);
+
+/**
+ * Registers a third-party compression filter with HDF5.
+ *
+ * filter_class points to an H5Z_class2_t. The filter can then be selected with
+ * ISMRMRD_CompressionOptions.filter_id, readers must register it as well.
+ */
+EXPORTISMRMRD int ismrmrd_register_filter(const void *filter_class);
+
+/**
+ * Registers the in-tree LZ codec, ISMRMRD_FILTER_LZ, with HDF5.
+ *
+ * ismrmrd_open_dataset does this, it is only needed to read the files with HDF5 directly.
+ */
+EXPORTISMRMRD int ismrmrd_register_lz_filter(void);
+
+/**
+ * Registers the in-tree LZ codec with HDF5 under filter_id, from 256 to 65535.
+ *
+ * For an id assigned by The HDF Group or agreed with the readers of the files,
+ * selected with ISMRMRD_CompressionOptions.filter_id. Writers and readers must
+ * both register it before opening a dataset.
+ */
+EXPORTISMRMRD int ismrmrd_register_lz_filter_id(unsigned int filter_id);
+
+/**
+ * Sets the io_uring file driver, ISMRMRD_DRIVER_IO_URING, on a file access property list.
+ *
+ * queue_depth and direct_io_size are as in ISMRMRD_DatasetOptions. ismrmrd_open_dataset
+ * does this, it is only needed to open the files with HDF5 directly. Built without
+ * io_uring, the property list keeps its driver.
+ */
+EXPORTISMRMRD int ismrmrd_set_fapl_io_uring(int64_t fapl, uint32_t queue_depth, size_t direct_io_size);
+
 /**
  *  Writes the XML header string to the dataset.
  *
@@ -65,6 +302,14 @@ EXPORTISMRMRD int ismrmrd_write_header(const ISMRMRD_Dataset *dset, const char *
  */
 EXPORTISMRMRD char * ismrmrd_read_header(const ISMRMRD_Dataset *dset);
 
+/**
+ *  Lists the groups at the root of the file of the dataset, e.g. the measurements of a multi-measurement file.
+ *
+ *  Returns an array of *count names, or NULL on error. The array and the names
+ *  are a single block that the caller must free.
+ */
+EXPORTISMRMRD char ** ismrmrd_list_groups(const ISMRMRD_Dataset *dset, uint32_t *count);
+
 /**
  *  Appends and NMR/MRI acquisition to the dataset.
  *
@@ -72,11 +317,122 @@ EXPORTISMRMRD char * ismrmrd_read_header(const ISMRMRD_Dataset *dset);
  */
 EXPORTISMRMRD int ismrmrd_append_acquisition(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acq);
 
+/**
+ *  Appends n acquisitions to the dataset.
+ *
+ *  The dataset is grown once and the acquisitions are written with a single H5Dwrite.
+ */
+EXPORTISMRMRD int ismrmrd_append_acquisitions(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acqs, uint32_t n);
+
 /**
  *  Reads the acquisition with the specified index from the dataset.
+ *
+ *  The payload is read straight into the buffers of acq, reading acquisitions
+ *  of the same shape into the same acq allocates no memory.
  */
 EXPORTISMRMRD int ismrmrd_read_acquisition(const ISMRMRD_Dataset *dset, uint32_t index, ISMRMRD_Acquisition *acq);
 
+/**
+ *  Reads count consecutive acquisitions starting at index start.
+ *
+ *  The range is transferred with a single hyperslab read.
+ *  acqs must point to an array of count initialized acquisitions. Their
+ *  payload buffers are reused for payloads of the same size, possibly of
+ *  another acquisition in the range.
+ */
+EXPORTISMRMRD int ismrmrd_read_acquisitions(const ISMRMRD_Dataset *dset, uint32_t start, uint32_t count,
+                                            ISMRMRD_Acquisition *acqs);
+
+/**
+ *  Reads the headers of count consecutive acquisitions starting at index start.
+ *
+ *  Only the header part of each acquisition is transferred, the trajectory
+ *  and data payloads are not read.
+ *  heads must point to an array of count headers.
+ */
+EXPORTISMRMRD int ismrmrd_read_acquisition_headers(const ISMRMRD_Dataset *dset, uint32_t start, uint32_t count,
+                                                   ISMRMRD_AcquisitionHeader *heads);
+
+/**
+ *  Selection of acquisitions by flags and encoding counters.
+ *
+ *  Flag masks use bit (flag - 1) for each ISMRMRD_AcquisitionFlags value.
+ *  Counter bounds are inclusive.
+ */
+typedef struct ISMRMRD_AcquisitionQuery {
+    uint64_t flags_set;                /**< Flags that must all be set */
+    uint64_t flags_clear;              /**< Flags that must all be clear */
+    ISMRMRD_EncodingCounters idx_min;  /**< Lower bound of each encoding counter */
+    ISMRMRD_EncodingCounters idx_max;  /**< Upper bound of each encoding counter */
+} ISMRMRD_AcquisitionQuery;
+
+/**
+ *  Initializes a query that matches every acquisition.
+ */
+EXPORTISMRMRD int ismrmrd_init_acquisition_query(ISMRMRD_AcquisitionQuery *query);
+
+/**
+ *  Brings the acquisition index up to date with the acquisitions in the dataset.
+ *
+ *  The index is stored in the variable groupname/acquisition_index, one row of
+ *  flags and encoding counters per acquisition. Only acquisitions not yet indexed
+ *  are read. Fails if the dataset was opened for reading only.
+ */
+EXPORTISMRMRD int ismrmrd_build_acquisition_index(const ISMRMRD_Dataset *dset);
+
+/**
+ *  Finds the acquisitions matching a query.
+ *
+ *  The index is built or extended first if needed and the dataset is writable,
+ *  otherwise acquisitions missing from the index are matched on their headers
+ *  without writing to the file. On success *rows holds
+ *  the *count matching acquisition numbers in increasing order, the caller
+ *  releases the array with free().
+ */
+EXPORTISMRMRD int ismrmrd_find_acquisitions(const ISMRMRD_Dataset *dset, const ISMRMRD_AcquisitionQuery *query,
+                                            uint32_t **rows, uint32_t *count);
+
+/**
+ *  Cursor over the acquisitions matching a query.
+ *
+ *  The query is evaluated on the flags and encoding counters of batch_size
+ *  acquisitions at a time, and only the matching acquisitions are read in full.
+ *  The members are managed by the cursor functions.
+ */
+typedef struct ISMRMRD_AcquisitionCursor {
+    const ISMRMRD_Dataset *dset;
+    ISMRMRD_AcquisitionQuery query;
+    uint32_t batch_size;     /**< Acquisitions evaluated per header read */
+    uint32_t next_row;       /**< First acquisition not evaluated yet */
+    uint32_t *matches;       /**< Matching rows of the current batch */
+    uint32_t num_matches;
+    uint32_t next_match;     /**< First match not returned yet */
+    void *entries;           /**< Header buffer for one batch */
+} ISMRMRD_AcquisitionCursor;
+
+/**
+ *  Initializes a cursor positioned before the first acquisition.
+ *
+ *  A batch_size of 0 uses 1024.
+ */
+EXPORTISMRMRD int ismrmrd_init_acquisition_cursor(ISMRMRD_AcquisitionCursor *cursor, const ISMRMRD_Dataset *dset,
+                                                  const ISMRMRD_AcquisitionQuery *query, uint32_t batch_size);
+
+/**
+ *  Reads up to max matching acquisitions.
+ *
+ *  acqs must point to an array of max initialized acquisitions. If rows is not NULL
+ *  it receives the acquisition numbers. *count is 0 once the cursor is exhausted.
+ *  Runs of consecutive matching acquisitions are read with a single range read.
+ */
+EXPORTISMRMRD int ismrmrd_acquisition_cursor_next(ISMRMRD_AcquisitionCursor *cursor, ISMRMRD_Acquisition *acqs,
+                                                  uint32_t *rows, uint32_t max, uint32_t *count);
+
+/**
+ *  Releases the cursor buffers.
+ */
+EXPORTISMRMRD int ismrmrd_cleanup_acquisition_cursor(ISMRMRD_AcquisitionCursor *cursor);
+
 /**
  *  Return the number of acquisitions in the dataset.
  */
@@ -105,6 +461,23 @@ EXPORTISMRMRD int ismrmrd_append_image(const ISMRMRD_Dataset *dset, const char *
 EXPORTISMRMRD int ismrmrd_read_image(const ISMRMRD_Dataset *dset, const char *varname,
                                      const uint32_t index, ISMRMRD_Image *im);
 
+/**
+ *  Appends n images of the same data type and size to the variable named varname.
+ *
+ *  The headers, attribute strings and data are each written in one block.
+ */
+EXPORTISMRMRD int ismrmrd_append_images(const ISMRMRD_Dataset *dset, const char *varname,
+                                        const ISMRMRD_Image *ims, uint32_t n);
+
+/**
+ *  Reads count images from start into an array of initialized images.
+ *
+ *  The headers, attribute strings and data are each read in one block, the
+ *  data buffers of the images are reused if their size does not change.
+ */
+EXPORTISMRMRD int ismrmrd_read_images(const ISMRMRD_Dataset *dset, const char *varname,
+                                      uint32_t start, uint32_t count, ISMRMRD_Image *ims);
+
 /**
  *  Return the number of images in the variable varname in the dataset.
  */
@@ -135,6 +508,47 @@ EXPORTISMRMRD int ismrmrd_read_array(const ISMRMRD_Dataset *dataset, const char
  */
 EXPORTISMRMRD uint32_t ismrmrd_get_number_of_arrays(const ISMRMRD_Dataset *dset, const char *varname);
 
+/**
+ *  Read-only frames of an NDArray or image variable, see ismrmrd_map_array.
+ *
+ *  The frames are split into segments of segment_frames frames, consecutive
+ *  frames of a segment are frame_size bytes apart. The members are managed by
+ *  the array map functions.
+ */
+typedef struct ISMRMRD_ArrayMap {
+    uint16_t data_type;                  /**< One of ISMRMRD_DataTypes */
+    uint16_t ndim;                       /**< Number of dimensions of a frame */
+    size_t dims[ISMRMRD_NDARRAY_MAXDIM]; /**< Dimensions of a frame */
+    uint32_t count;                      /**< Number of frames */
+    size_t frame_size;                   /**< Bytes per frame */
+    uint32_t segment_frames;             /**< Frames per segment */
+    const char **segments;               /**< First frame of each segment */
+    int mapped;                          /**< Non-zero if the frames are mapped from the file, zero if they were copied */
+    void *memory;                        /**< File mapping or copy holding the frames */
+    size_t memory_size;
+} ISMRMRD_ArrayMap;
+
+/**
+ *  Maps all frames of the NDArray variable varname, or of the image variable varname, from the file.
+ *
+ *  Frames stored without filters, contiguously or one chunk after another,
+ *  are mapped read-only into memory and only read when touched. Otherwise,
+ *  or when the file is not a plain file on disk, the frames are copied. Frames
+ *  appended later are not part of the map, which stays valid after the
+ *  dataset is closed. map must be released with ismrmrd_cleanup_array_map.
+ */
+EXPORTISMRMRD int ismrmrd_map_array(const ISMRMRD_Dataset *dset, const char *varname, ISMRMRD_ArrayMap *map);
+
+/**
+ *  Returns frame index of a map, or NULL if it is out of range.
+ */
+EXPORTISMRMRD const void * ismrmrd_array_map_frame(const ISMRMRD_ArrayMap *map, uint32_t index);
+
+/**
+ *  Unmaps or frees the frames of a map.
+ */
+EXPORTISMRMRD int ismrmrd_cleanup_array_map(ISMRMRD_ArrayMap *map);
+
     
 #ifdef __cplusplus
 } /* extern "C" */
@@ -143,33 +557,154 @@ EXPORTISMRMRD uint32_t ismrmrd_get_number_of_arrays(const ISMRMRD_Dataset *dset,
 //  ISMRMRD Datset C++ Interface
 //
 
+typedef ISMRMRD_DatasetOptions DatasetOptions;
+typedef ISMRMRD_CompressionOptions CompressionOptions;
+typedef ISMRMRD_AcquisitionQuery AcquisitionQuery;
+
+/**
+ * Read-only view of every frame of an NDArray or image variable, see Dataset::mapNDArray.
+ *
+ * The view does not own the frames of a mapped file, it stays valid after the dataset is closed.
+ */
+template <typename T> class EXPORTISMRMRD NDArrayView {
+public:
+    NDArrayView();
+    ~NDArrayView();
+
+    /// Number of frames
+    uint32_t getNumberOfFrames() const;
+    /// Number of dimensions of a frame
+    uint16_t getNDim() const;
+    /// Dimensions of a frame
+    const size_t (&getDims() const)[ISMRMRD_NDARRAY_MAXDIM];
+    /// Number of elements of a frame
+    size_t getNumberOfElements() const;
+    /// Frame index, throws if it is out of range
+    const T * getFrame(uint32_t index) const;
+    /// Whether the frames are mapped from the file rather than copied
+    bool isMapped() const;
+
+protected:
+    friend class Dataset;
+    NDArrayView(const NDArrayView &);
+    NDArrayView & operator= (const NDArrayView &);
+
+    ISMRMRD_ArrayMap map_;
+};
+
 class EXPORTISMRMRD Dataset {
 public:
     // Constructor and destructor
     Dataset(const char* filename, const char* groupname, bool create_file_if_needed = true);
+    Dataset(const char* filename, const char* groupname, bool create_file_if_needed, const DatasetOptions &options);
+    /// Opens a copy of a file image in memory, see ismrmrd_open_dataset_from_image
+    Dataset(const char* filename, const char* groupname, const void *image, size_t size);
+    Dataset(const char* filename, const char* groupname, const void *image, size_t size, const DatasetOptions &options);
+    /// Writes buffered acquisitions and closes the dataset, failures are left on the error stack
     ~Dataset();
     
     // Methods
     // XML Header
     void writeHeader(const std::string &xmlstring);
     void readHeader(std::string& xmlstring);
+    // Groups
+    /// Names of the groups at the root of the file, see ismrmrd_list_groups
+    std::vector<std::string> listGroups();
     // Acquisitions
     void appendAcquisition(const Acquisition &acq);
+    void appendAcquisitions(const std::vector<Acquisition> &acqs);
     void readAcquisition(uint32_t index, Acquisition &acq);
+    void readAcquisitions(uint32_t start, uint32_t count, std::vector<Acquisition> &acqs);
+    void readAcquisitionHeaders(uint32_t start, uint32_t count, std::vector<AcquisitionHeader> &heads);
     uint32_t getNumberOfAcquisitions();
+    // Acquisition index
+    void buildAcquisitionIndex();
+    void findAcquisitions(const AcquisitionQuery &query, std::vector<uint32_t> &rows);
     // Images
     template <typename T> void appendImage(const std::string &var, const Image<T> &im);
     void appendImage(const std::string &var, const ISMRMRD_Image *im);
     template <typename T> void readImage(const std::string &var, uint32_t index, Image<T> &im);
+    template <typename T> void appendImages(const std::string &var, const std::vector<Image<T> > &ims);
+    void appendImages(const std::string &var, const ISMRMRD_Image *ims, uint32_t count);
+    template <typename T> void readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<T> > &ims);
+    void readImages(const std::string &var, uint32_t start, uint32_t count, ISMRMRD_Image *ims);
     uint32_t getNumberOfImages(const std::string &var);
     // NDArrays
     template <typename T> void appendNDArray(const std::string &var, const NDArray<T> &arr);
     void appendNDArray(const std::string &var, const ISMRMRD_NDArray *arr);
     template <typename T> void readNDArray(const std::string &var, uint32_t index, NDArray<T> &arr);
     uint32_t getNumberOfNDArrays(const std::string &var);
+    /// Maps all frames of an NDArray or image variable read-only, see ismrmrd_map_array
+    template <typename T> void mapNDArray(const std::string &var, NDArrayView<T> &view);
+
+    // Write-behind buffering of acquisitions
+    /**
+     * Enables write-behind buffering of appended acquisitions.
+     *
+     * Acquisitions are kept in memory and written as one block when either
+     * max_acquisitions are pending or max_bytes of payload are pending.
+     * A threshold of 0 is ignored, passing 0 for both disables buffering.
+     */
+    void setAcquisitionBuffering(size_t max_acquisitions, size_t max_bytes = 0);
+    /**
+     * Writes any buffered acquisitions to the file.
+     *
+     * Call it before the Dataset is destroyed to see write errors as
+     * exceptions, the destructor cannot throw them.
+     */
+    void flush();
+
+    // File image
+    /**
+     * Copies the file into image, e.g. to send a dataset held in memory elsewhere.
+     */
+    void getFileImage(std::vector<char> &image);
+
+    // Streaming (ISMRMRD_SWMR_READ mode)
+    /**
+     * Picks up the acquisitions flushed by the writer since the last refresh.
+     */
+    void refresh();
+    /**
+     * Refreshes until the dataset holds at least n acquisitions.
+     *
+     * Returns false if timeout_seconds elapse first, a negative timeout waits forever.
+     */
+    bool waitForAcquisitions(uint32_t n, double timeout_seconds);
 
 protected:
+    friend class AcquisitionCursor;
+    friend class AcquisitionPrefetcher;
+
     ISMRMRD_Dataset dset_;
+
+    std::vector<Acquisition> acq_buffer_;
+    size_t acq_buffer_bytes_;
+    size_t acq_buffer_max_count_;
+    size_t acq_buffer_max_bytes_;
+};
+
+/**
+ * Iterates over the acquisitions of a dataset that match a query.
+ *
+ * Payloads are only read for matching acquisitions. The dataset must outlive the cursor.
+ */
+class EXPORTISMRMRD AcquisitionCursor {
+public:
+    AcquisitionCursor(Dataset &dataset, const AcquisitionQuery &query, uint32_t batch_size = 1024);
+    ~AcquisitionCursor();
+
+    /// Reads the next matching acquisition, returns false when there are none left
+    bool next(Acquisition &acq);
+    /// Reads up to max matching acquisitions and their numbers, returns false when there are none left
+    bool next(std::vector<Acquisition> &acqs, std::vector<uint32_t> &rows, uint32_t max);
+
+protected:
+    AcquisitionCursor(const AcquisitionCursor &);
+    AcquisitionCursor & operator= (const AcquisitionCursor &);
+
+    Dataset &dataset_;
+    ISMRMRD_AcquisitionCursor cursor_;
 };
 
 } /* ISMRMRD namespace */
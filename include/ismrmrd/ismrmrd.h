@@ -393,19 +393,77 @@ typedef void (*ismrmrd_error_handler_t)(const char *file, int line,
         const char *function, int code, const char *msg);
 #define ISMRMRD_PUSH_ERR(code, msg) ismrmrd_push_error(__FILE__, __LINE__, \
         __func__, (code), (msg))
+/** Pushes an error on the calling thread's error stack, which holds the most recent 32 errors */
 int ismrmrd_push_error(const char *file, const int line, const char *func,
         const int code, const char *msg);
-/** Sets a custom error handler */
+/** Sets a custom error handler, called on the thread that pushes the error */
 EXPORTISMRMRD void ismrmrd_set_error_handler(ismrmrd_error_handler_t);
 /** Returns message for corresponding error code */
 EXPORTISMRMRD char *ismrmrd_strerror(int code);
 /** @} */
 
-/** Populates parameters (if non-NULL) with error information
+/** Pops the calling thread's most recent error and populates parameters (if non-NULL) with its information
  * @returns true if there was error information to return, false otherwise */
 bool ismrmrd_pop_error(char **file, int *line, char **func,
         int *code, char **msg);
 
+/*********************/
+/* Memory Management */
+/*********************/
+/** @addtogroup capi
+ *  @{
+ */
+/** Alignment in bytes of the payload buffers from the aligned and pool allocators, enough for AVX-512 and cache lines */
+#define ISMRMRD_PAYLOAD_ALIGNMENT 64
+
+typedef void *(*ismrmrd_malloc_t)(size_t size, void *ctx);
+typedef void *(*ismrmrd_realloc_t)(void *ptr, size_t size, void *ctx);
+typedef void (*ismrmrd_free_t)(void *ptr, void *ctx);
+
+/**
+ * Sets the allocator used for the data, trajectory and attribute string buffers of
+ * acquisitions, images and NDArrays, ctx is passed to each call.
+ * All three functions NULL restores the default allocator, plain malloc, realloc and free,
+ * whose buffers callers may release or replace with the C heap functions.
+ * Must be called before any of these buffers is allocated, buffers allocated by one
+ * allocator cannot be released by another.
+ */
+EXPORTISMRMRD int ismrmrd_set_allocator(ismrmrd_malloc_t alloc, ismrmrd_realloc_t realloc_fn,
+        ismrmrd_free_t free_fn, void *ctx);
+/** Allocates, resizes and frees payload buffers with the current allocator */
+EXPORTISMRMRD void *ismrmrd_malloc(size_t size);
+EXPORTISMRMRD void *ismrmrd_realloc(void *ptr, size_t size);
+EXPORTISMRMRD void ismrmrd_free(void *ptr);
+/** Returns true if ptr is aligned to ISMRMRD_PAYLOAD_ALIGNMENT */
+EXPORTISMRMRD bool ismrmrd_is_aligned(const void *ptr);
+
+/**
+ * Allocator for ismrmrd_set_allocator that aligns buffers to ISMRMRD_PAYLOAD_ALIGNMENT,
+ * e.g. for vectorized kernels on the payloads, ctx is unused.
+ * Its buffers are not C heap blocks: once it is set, payload buffers must only be
+ * allocated, resized and released by the library or the ismrmrd_malloc functions.
+ */
+EXPORTISMRMRD void *ismrmrd_aligned_malloc(size_t size, void *ctx);
+EXPORTISMRMRD void *ismrmrd_aligned_realloc(void *ptr, size_t size, void *ctx);
+EXPORTISMRMRD void ismrmrd_aligned_free(void *ptr, void *ctx);
+
+/**
+ * Size class pool allocator for ismrmrd_set_allocator, which recycles the buffers of
+ * readouts and images of recurring sizes instead of returning them to the heap.
+ * Buffers are aligned to ISMRMRD_PAYLOAD_ALIGNMENT.
+ * Up to max_cached_bytes of freed buffers are kept for reuse, the pool is thread safe.
+ */
+typedef struct ISMRMRD_Pool ISMRMRD_Pool;
+EXPORTISMRMRD ISMRMRD_Pool * ismrmrd_create_pool(size_t max_cached_bytes);
+/** Frees the pool and its cached buffers, buffers still in use must not be freed afterwards */
+EXPORTISMRMRD int ismrmrd_free_pool(ISMRMRD_Pool *pool);
+EXPORTISMRMRD void *ismrmrd_pool_malloc(size_t size, void *pool);
+EXPORTISMRMRD void *ismrmrd_pool_realloc(void *ptr, size_t size, void *pool);
+EXPORTISMRMRD void ismrmrd_pool_free(void *ptr, void *pool);
+/** Number of allocations served from the cache and from the heap */
+EXPORTISMRMRD int ismrmrd_pool_stats(const ISMRMRD_Pool *pool, size_t *hits, size_t *misses);
+/** @} */
+
 /*****************************/
 /* Rotations and Quaternions */
 /*****************************/
@@ -429,7 +487,7 @@ EXPORTISMRMRD void ismrmrd_quaternion_to_directions(float quat[4], float read_di
 
 ///  ISMRMRD C++ Interface
 
-/// Construct exception message from ISMRMRD error stack
+/// Construct exception message from the calling thread's ISMRMRD error stack
 std::string build_exception_string(void);
 
 /// Some typedefs to beautify the namespace
@@ -486,14 +544,37 @@ public:
 /// MR Acquisition type
 class EXPORTISMRMRD Acquisition {
     friend class Dataset;
+    friend class StreamWriter;
+    friend class StreamReader;
+    friend class DatasetBackend;
 public:
     // Constructors, assignment, destructor
     Acquisition();
     Acquisition(uint16_t num_samples, uint16_t active_channels=1, uint16_t trajectory_dimensions=0);
     Acquisition(const Acquisition &other);
     Acquisition & operator= (const Acquisition &other);
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+    /// Takes the buffers of other, which is left empty
+    Acquisition(Acquisition &&other) noexcept;
+    Acquisition & operator= (Acquisition &&other) noexcept;
+#endif
     ~Acquisition();
 
+    // Ownership transfer
+    /// Exchanges the headers and buffers of two acquisitions
+    void swap(Acquisition &other);
+    /**
+     * Moves the header and buffers into acq and leaves this acquisition empty.
+     * acq is overwritten, buffers it owned are not freed. The caller frees the
+     * buffers with ismrmrd_cleanup_acquisition.
+     */
+    void release(ISMRMRD_Acquisition *acq);
+    /**
+     * Frees the buffers of this acquisition and takes the header and buffers of
+     * acq, which is left empty. The buffers must be allocated with ismrmrd_malloc.
+     */
+    void adopt(ISMRMRD_Acquisition *acq);
+
     // Accessors and mutators
     const uint16_t &version();
     const uint64_t &flags();
@@ -526,6 +607,8 @@ public:
     const size_t getNumberOfTrajElements();
     const size_t getDataSize();
     const size_t getTrajSize();
+    /** Returns true if the data and trajectory are aligned to ISMRMRD_PAYLOAD_ALIGNMENT **/
+    bool isAligned() const;
 
     // Header, data and trajectory accessors
     const AcquisitionHeader &getHead();
@@ -614,14 +697,38 @@ public:
 /// MR Image type
 template <typename T> class EXPORTISMRMRD Image {
     friend class Dataset;
+    friend class StreamWriter;
+    friend class StreamReader;
+    friend class DatasetBackend;
 public:
     // Constructors
     Image(uint16_t matrix_size_x = 0, uint16_t matrix_size_y = 1,
           uint16_t matrix_size_z = 1, uint16_t channels = 1);
     Image(const Image &other);
     Image & operator= (const Image &other);
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+    /// Takes the buffers of other, which is left empty
+    Image(Image &&other) noexcept;
+    Image & operator= (Image &&other) noexcept;
+#endif
     ~Image();
 
+    // Ownership transfer
+    /// Exchanges the headers and buffers of two images
+    void swap(Image &other);
+    /**
+     * Moves the header and buffers into im and leaves this image empty.
+     * im is overwritten, buffers it owned are not freed. The caller frees the
+     * buffers with ismrmrd_cleanup_image.
+     */
+    void release(ISMRMRD_Image *im);
+    /**
+     * Frees the buffers of this image and takes the header and buffers of im,
+     * which is left empty. The buffers must be allocated with ismrmrd_malloc and the
+     * data type of im must match T.
+     */
+    void adopt(ISMRMRD_Image *im);
+
     // Image dimensions
     void resize(uint16_t matrix_size_x, uint16_t matrix_size_y, uint16_t matrix_size_z, uint16_t channels);
     uint16_t getMatrixSizeX() const;
@@ -755,6 +862,8 @@ public:
     size_t getNumberOfDataElements() const;
     /** Returns the size of the image data in bytes **/
     size_t getDataSize() const;
+    /** Returns true if the image data is aligned to ISMRMRD_PAYLOAD_ALIGNMENT **/
+    bool isAligned() const;
 
     /** Returns iterator to the beginning of the image data **/
     T* begin();
@@ -772,6 +881,9 @@ protected:
 /// N-Dimensional array type
 template <typename T> class EXPORTISMRMRD NDArray {
     friend class Dataset;
+    friend class StreamWriter;
+    friend class StreamReader;
+    friend class DatasetBackend;
 public:
     // Constructors, destructor and copy
     NDArray();
@@ -779,6 +891,27 @@ public:
     NDArray(const NDArray<T> &other);
     ~NDArray();
     NDArray<T> & operator= (const NDArray<T> &other);
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+    /// Takes the data of other, which is left empty
+    NDArray(NDArray<T> &&other) noexcept;
+    NDArray<T> & operator= (NDArray<T> &&other) noexcept;
+#endif
+
+    // Ownership transfer
+    /// Exchanges the dimensions and data of two arrays
+    void swap(NDArray<T> &other);
+    /**
+     * Moves the dimensions and data into arr and leaves this array empty.
+     * arr is overwritten, data it owned is not freed. The caller frees the
+     * data with ismrmrd_cleanup_ndarray.
+     */
+    void release(ISMRMRD_NDArray *arr);
+    /**
+     * Frees the data of this array and takes the dimensions and data of arr,
+     * which is left empty. The data must be allocated with ismrmrd_malloc and the
+     * data type of arr must match T.
+     */
+    void adopt(ISMRMRD_NDArray *arr);
 
     // Accessors and mutators
     const uint16_t getVersion();
@@ -786,6 +919,8 @@ public:
     const uint16_t getNDim();
     const size_t (&getDims())[ISMRMRD_NDARRAY_MAXDIM];
     const size_t getDataSize();
+    /** Returns true if the data is aligned to ISMRMRD_PAYLOAD_ALIGNMENT **/
+    bool isAligned() const;
     void resize(const std::vector<size_t> dimvec);
     const size_t getNumberOfElements();
     T * getDataPtr();
@@ -0,0 +1,95 @@
+/* ISMRMRD Background Acquisition Reader */
+
+/**
+ * @file prefetch.h
+ */
+
+#pragma once
+#ifndef ISMRMRD_PREFETCH_H
+#define ISMRMRD_PREFETCH_H
+
+#include "ismrmrd/dataset.h"
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1800)
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ISMRMRD {
+
+/**
+ * Reads acquisitions on a background thread ahead of the consumer.
+ *
+ * The reader thread fills a bounded single-producer/single-consumer ring of
+ * pre-allocated acquisitions and the consumer pops them with next(). Only the
+ * reader thread uses the dataset while the prefetcher exists, so the dataset
+ * must not be used by other code until the prefetcher is destroyed.
+ */
+class EXPORTISMRMRD AcquisitionPrefetcher {
+public:
+    /**
+     * Prefetches count acquisitions starting at start.
+     *
+     * depth is the number of acquisitions in the ring. max_bytes limits the
+     * payload held in the ring, 0 means no limit. At least one acquisition is
+     * always read.
+     */
+    AcquisitionPrefetcher(Dataset &dataset, uint32_t start, uint32_t count,
+                          size_t depth = 64, size_t max_bytes = 0);
+    /**
+     * Prefetches the acquisitions matching query, see AcquisitionCursor.
+     */
+    AcquisitionPrefetcher(Dataset &dataset, const AcquisitionQuery &query,
+                          size_t depth = 64, size_t max_bytes = 0);
+    /// Stops the reader thread
+    ~AcquisitionPrefetcher();
+
+    /**
+     * Moves the next acquisition into acq, waiting for the reader if needed.
+     *
+     * Returns false once all acquisitions were returned. A read error on the
+     * reader thread is thrown here after the acquisitions read before it.
+     * The buffers previously owned by acq are reused by the reader.
+     */
+    bool next(Acquisition &acq);
+
+private:
+    AcquisitionPrefetcher(const AcquisitionPrefetcher &);
+    AcquisitionPrefetcher & operator= (const AcquisitionPrefetcher &);
+
+    void start();
+    void run();
+    size_t waitForSpace();
+    void wake();
+
+    Dataset &dataset_;
+    bool use_query_;
+    uint32_t next_row_;
+    uint32_t end_row_;
+    ISMRMRD_AcquisitionCursor cursor_;
+    size_t last_size_;              // payload bytes of the last acquisition read
+
+    std::vector<Acquisition> ring_;
+    size_t max_bytes_;
+    std::atomic<size_t> head_;      // next slot to pop, written by the consumer
+    std::atomic<size_t> tail_;      // next slot to fill, written by the reader
+    std::atomic<size_t> bytes_;     // payload bytes in the ring
+    std::atomic<bool> done_;        // reader has finished
+    std::atomic<bool> stop_;        // consumer asks the reader to finish
+    std::atomic<int> waiting_;      // threads sleeping on ready_
+    std::string error_;
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::thread reader_;
+};
+
+} /* ISMRMRD namespace */
+
+#endif /* C++11 */
+
+#endif /* ISMRMRD_PREFETCH_H */
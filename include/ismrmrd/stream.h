@@ -0,0 +1,154 @@
+/* ISMRMRD Binary Stream Format */
+
+/**
+ * @file stream.h
+ */
+
+#pragma once
+#ifndef ISMRMRD_STREAM_H
+#define ISMRMRD_STREAM_H
+
+#include "ismrmrd/ismrmrd.h"
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ISMRMRD {
+
+/**
+ * Message ids of the stream format.
+ *
+ * A stream is a sequence of messages. A message starts with its uint16_t id
+ * and the uint64_t length of its body in bytes, followed by the body. All
+ * values are in the byte order of the host, like the HDF5 datasets.
+ *
+ *  - HEADER: the XML header
+ *  - ACQUISITION: ISMRMRD_AcquisitionHeader, trajectory, data
+ *  - IMAGE: uint16_t name length, name, ISMRMRD_ImageHeader, attribute string, data
+ *  - NDARRAY: uint16_t name length, name, uint16_t version, data type and
+ *    number of dimensions, uint64_t dimensions, data
+ *  - CLOSE: empty, ends the stream
+ *
+ * Images and arrays carry the name of the dataset variable they belong to.
+ */
+enum StreamMessageId {
+    ISMRMRD_STREAM_HEADER = 1,
+    ISMRMRD_STREAM_ACQUISITION = 2,
+    ISMRMRD_STREAM_IMAGE = 3,
+    ISMRMRD_STREAM_NDARRAY = 4,
+    ISMRMRD_STREAM_CLOSE = 5
+};
+
+/**
+ * Writes ISMRMRD messages to a std::ostream or a file descriptor.
+ *
+ * Messages are collected in a buffer. Payloads larger than a quarter of the
+ * buffer are not copied, they are written together with the buffered bytes
+ * in one vectored write before the write call returns.
+ */
+class EXPORTISMRMRD StreamWriter {
+public:
+    StreamWriter(std::ostream &os, size_t buffer_size = 65536);
+    /// Writes to fd, e.g. a pipe or socket, which is not closed by the writer
+    StreamWriter(int fd, size_t buffer_size = 65536);
+    /// Flushes the buffer, call flush() or close() before to see write errors
+    ~StreamWriter();
+
+    void writeHeader(const std::string &xmlstring);
+    void writeAcquisition(const Acquisition &acq);
+    void writeAcquisition(const ISMRMRD_Acquisition *acq);
+    template <typename T> void writeImage(const std::string &var, const Image<T> &im);
+    void writeImage(const std::string &var, const ISMRMRD_Image *im);
+    template <typename T> void writeNDArray(const std::string &var, const NDArray<T> &arr);
+    void writeNDArray(const std::string &var, const ISMRMRD_NDArray *arr);
+
+    /// Writes the close message and flushes
+    void close();
+    /// Writes out the buffered messages
+    void flush();
+    /// Bytes written since the writer was created, including the buffered ones
+    uint64_t position() const;
+
+private:
+    StreamWriter(const StreamWriter &);
+    StreamWriter & operator= (const StreamWriter &);
+
+    void beginMessage(uint16_t id, uint64_t length);
+    void endMessage();
+    void beginVariable(uint16_t id, const std::string &var, uint64_t length);
+    void put(const void *data, size_t size);
+    void putPayload(const void *data, size_t size);
+    void writePending();
+    void writeSegments();
+
+    std::ostream *os_;
+    int fd_;
+    std::vector<char> buffer_;
+    size_t used_;
+    size_t mark_;                                               // start of the buffered bytes not in segments_
+    std::vector<std::pair<const char *, size_t> > segments_;    // queued for the next vectored write
+    uint64_t written_;
+};
+
+/**
+ * Reads ISMRMRD messages from a std::istream or a file descriptor.
+ *
+ * nextMessage() returns the id of the next message, which is then consumed by
+ * the read or skip call for it. Large payloads are read straight into the
+ * buffers of the acquisition, image or array, which are reused when their
+ * size does not change.
+ */
+class EXPORTISMRMRD StreamReader {
+public:
+    StreamReader(std::istream &is, size_t buffer_size = 65536);
+    /// Reads from fd, e.g. a pipe or socket, which is not closed by the reader
+    StreamReader(int fd, size_t buffer_size = 65536);
+
+    /// Id of the next message, ISMRMRD_STREAM_CLOSE at the end of the input
+    uint16_t nextMessage();
+
+    void readHeader(std::string &xmlstring);
+    void readAcquisition(Acquisition &acq);
+    void readAcquisition(ISMRMRD_Acquisition *acq);
+    /// Throws if the image is not of type T, the message is skipped
+    template <typename T> void readImage(std::string &var, Image<T> &im);
+    /// Reads an image of any data type
+    void readImage(std::string &var, ISMRMRD_Image *im);
+    /// Throws if the array is not of type T, the message is skipped
+    template <typename T> void readNDArray(std::string &var, NDArray<T> &arr);
+    /// Reads an array of any data type
+    void readNDArray(std::string &var, ISMRMRD_NDArray *arr);
+    /// Skips the next message
+    void skipMessage();
+
+private:
+    StreamReader(const StreamReader &);
+    StreamReader & operator= (const StreamReader &);
+
+    void beginMessage(uint16_t id);
+    void endMessage();
+    void discard();
+    void readVariableName(std::string &var);
+    void readImageHeader(std::string &var, ISMRMRD_ImageHeader &head);
+    void readImageBody(const ISMRMRD_ImageHeader &head, ISMRMRD_Image *im);
+    void readNDArrayHeader(std::string &var, ISMRMRD_NDArray &arr);
+    void readNDArrayBody(const ISMRMRD_NDArray &head, ISMRMRD_NDArray *arr);
+    void get(void *data, size_t size);
+    size_t fill(char *data, size_t size);
+
+    std::istream *is_;
+    int fd_;
+    std::vector<char> buffer_;
+    size_t pos_;
+    size_t end_;
+    bool pending_;          // the id and length of the next message were read
+    bool closed_;
+    uint16_t id_;
+    uint64_t remaining_;    // body bytes of the current message not read yet
+};
+
+} // namespace ISMRMRD
+
+#endif // ISMRMRD_STREAM_H
@@ -0,0 +1,868 @@
+#include "ismrmrd/backend.h"
+
+// for memcpy and free in older compilers
+#include <string.h>
+#include <stdlib.h>
+#include <stdexcept>
+
+namespace ISMRMRD {
+
+//
+// DatasetBackend class implementation
+//
+DatasetBackend::DatasetBackend()
+{
+}
+
+DatasetBackend::~DatasetBackend()
+{
+}
+
+// XML Header
+void DatasetBackend::writeHeader(const std::string &xmlstring)
+{
+    doWriteHeader(xmlstring);
+}
+
+void DatasetBackend::readHeader(std::string &xmlstring)
+{
+    doReadHeader(xmlstring);
+}
+
+// Acquisitions
+void DatasetBackend::appendAcquisition(const Acquisition &acq)
+{
+    doAppendAcquisitions(&acq.acq, 1);
+}
+
+void DatasetBackend::appendAcquisitions(const std::vector<Acquisition> &acqs)
+{
+    if (acqs.empty()) {
+        return;
+    }
+    doAppendAcquisitions(reinterpret_cast<const ISMRMRD_Acquisition*>(&acqs[0]), static_cast<uint32_t>(acqs.size()));
+}
+
+void DatasetBackend::readAcquisition(uint32_t index, Acquisition &acq)
+{
+    if (index >= doGetNumberOfAcquisitions()) {
+        throw std::runtime_error("Acquisition index out of range");
+    }
+    doReadAcquisitions(index, 1, &acq.acq);
+}
+
+void DatasetBackend::readAcquisitions(uint32_t start, uint32_t count, std::vector<Acquisition> &acqs)
+{
+    uint32_t num_acqs = doGetNumberOfAcquisitions();
+    if (start > num_acqs || count > num_acqs - start) {
+        throw std::runtime_error("Acquisition index out of range");
+    }
+    acqs.resize(count);
+    if (count == 0) {
+        return;
+    }
+    doReadAcquisitions(start, count, reinterpret_cast<ISMRMRD_Acquisition*>(&acqs[0]));
+}
+
+uint32_t DatasetBackend::getNumberOfAcquisitions()
+{
+    return doGetNumberOfAcquisitions();
+}
+
+// Images
+template <typename T> void DatasetBackend::appendImage(const std::string &var, const Image<T> &im)
+{
+    doAppendImage(var, &im.im);
+}
+
+void DatasetBackend::appendImage(const std::string &var, const ISMRMRD_Image *im)
+{
+    if (im == NULL) {
+        throw std::runtime_error("Image pointer should not be NULL");
+    }
+    doAppendImage(var, im);
+}
+
+template <typename T> void DatasetBackend::readImage(const std::string &var, uint32_t index, Image<T> &im)
+{
+    if (index >= doGetNumberOfImages(var)) {
+        throw std::runtime_error("Image index out of range");
+    }
+    // the stored type is not known before the image is read
+    ISMRMRD_Image tmp;
+    ismrmrd_init_image(&tmp);
+    try {
+        doReadImage(var, index, &tmp);
+    } catch (...) {
+        ismrmrd_cleanup_image(&tmp);
+        throw;
+    }
+    if (tmp.head.data_type != im.im.head.data_type) {
+        ismrmrd_cleanup_image(&tmp);
+        throw std::runtime_error("Image data type does not match the stored image");
+    }
+    ismrmrd_cleanup_image(&im.im);
+    im.im = tmp;
+}
+
+void DatasetBackend::readImage(const std::string &var, uint32_t index, ISMRMRD_Image *im)
+{
+    if (im == NULL) {
+        throw std::runtime_error("Image pointer should not be NULL");
+    }
+    if (index >= doGetNumberOfImages(var)) {
+        throw std::runtime_error("Image index out of range");
+    }
+    doReadImage(var, index, im);
+}
+
+uint32_t DatasetBackend::getNumberOfImages(const std::string &var)
+{
+    return doGetNumberOfImages(var);
+}
+
+// NDArrays
+template <typename T> void DatasetBackend::appendNDArray(const std::string &var, const NDArray<T> &arr)
+{
+    doAppendNDArray(var, &arr.arr);
+}
+
+void DatasetBackend::appendNDArray(const std::string &var, const ISMRMRD_NDArray *arr)
+{
+    if (arr == NULL) {
+        throw std::runtime_error("NDArray pointer should not be NULL");
+    }
+    doAppendNDArray(var, arr);
+}
+
+template <typename T> void DatasetBackend::readNDArray(const std::string &var, uint32_t index, NDArray<T> &arr)
+{
+    if (index >= doGetNumberOfNDArrays(var)) {
+        throw std::runtime_error("NDArray index out of range");
+    }
+    ISMRMRD_NDArray tmp;
+    ismrmrd_init_ndarray(&tmp);
+    try {
+        doReadNDArray(var, index, &tmp);
+    } catch (...) {
+        ismrmrd_cleanup_ndarray(&tmp);
+        throw;
+    }
+    if (tmp.data_type != arr.arr.data_type) {
+        ismrmrd_cleanup_ndarray(&tmp);
+        throw std::runtime_error("NDArray data type does not match the stored array");
+    }
+    ismrmrd_cleanup_ndarray(&arr.arr);
+    arr.arr = tmp;
+}
+
+void DatasetBackend::readNDArray(const std::string &var, uint32_t index, ISMRMRD_NDArray *arr)
+{
+    if (arr == NULL) {
+        throw std::runtime_error("NDArray pointer should not be NULL");
+    }
+    if (index >= doGetNumberOfNDArrays(var)) {
+        throw std::runtime_error("NDArray index out of range");
+    }
+    doReadNDArray(var, index, arr);
+}
+
+uint32_t DatasetBackend::getNumberOfNDArrays(const std::string &var)
+{
+    return doGetNumberOfNDArrays(var);
+}
+
+void DatasetBackend::flush()
+{
+    doFlush();
+}
+
+void DatasetBackend::doFlush()
+{
+}
+
+// Specific instantiations
+template EXPORTISMRMRD void DatasetBackend::appendImage(const std::string &var, const Image<uint16_t> &im);
+template EXPORTISMRMRD void DatasetBackend::appendImage(const std::string &var, const Image<int16_t> &im);
+template EXPORTISMRMRD void DatasetBackend::appendImage(const std::string &var, const Image<uint32_t> &im);
+template EXPORTISMRMRD void DatasetBackend::appendImage(const std::string &var, const Image<int32_t> &im);
+template EXPORTISMRMRD void DatasetBackend::appendImage(const std::string &var, const Image<float> &im);
+template EXPORTISMRMRD void DatasetBackend::appendImage(const std::string &var, const Image<double> &im);
+template EXPORTISMRMRD void DatasetBackend::appendImage(const std::string &var, const Image<complex_float_t> &im);
+template EXPORTISMRMRD void DatasetBackend::appendImage(const std::string &var, const Image<complex_double_t> &im);
+
+template EXPORTISMRMRD void DatasetBackend::readImage(const std::string &var, uint32_t index, Image<uint16_t> &im);
+template EXPORTISMRMRD void DatasetBackend::readImage(const std::string &var, uint32_t index, Image<int16_t> &im);
+template EXPORTISMRMRD void DatasetBackend::readImage(const std::string &var, uint32_t index, Image<uint32_t> &im);
+template EXPORTISMRMRD void DatasetBackend::readImage(const std::string &var, uint32_t index, Image<int32_t> &im);
+template EXPORTISMRMRD void DatasetBackend::readImage(const std::string &var, uint32_t index, Image<float> &im);
+template EXPORTISMRMRD void DatasetBackend::readImage(const std::string &var, uint32_t index, Image<double> &im);
+template EXPORTISMRMRD void DatasetBackend::readImage(const std::string &var, uint32_t index, Image<complex_float_t> &im);
+template EXPORTISMRMRD void DatasetBackend::readImage(const std::string &var, uint32_t index, Image<complex_double_t> &im);
+
+template EXPORTISMRMRD void DatasetBackend::appendNDArray(const std::string &var, const NDArray<uint16_t> &arr);
+template EXPORTISMRMRD void DatasetBackend::appendNDArray(const std::string &var, const NDArray<int16_t> &arr);
+template EXPORTISMRMRD void DatasetBackend::appendNDArray(const std::string &var, const NDArray<uint32_t> &arr);
+template EXPORTISMRMRD void DatasetBackend::appendNDArray(const std::string &var, const NDArray<int32_t> &arr);
+template EXPORTISMRMRD void DatasetBackend::appendNDArray(const std::string &var, const NDArray<float> &arr);
+template EXPORTISMRMRD void DatasetBackend::appendNDArray(const std::string &var, const NDArray<double> &arr);
+template EXPORTISMRMRD void DatasetBackend::appendNDArray(const std::string &var, const NDArray<complex_float_t> &arr);
+template EXPORTISMRMRD void DatasetBackend::appendNDArray(const std::string &var, const NDArray<complex_double_t> &arr);
+
+template EXPORTISMRMRD void DatasetBackend::readNDArray(const std::string &var, uint32_t index, NDArray<uint16_t> &arr);
+template EXPORTISMRMRD void DatasetBackend::readNDArray(const std::string &var, uint32_t index, NDArray<int16_t> &arr);
+template EXPORTISMRMRD void DatasetBackend::readNDArray(const std::string &var, uint32_t index, NDArray<uint32_t> &arr);
+template EXPORTISMRMRD void DatasetBackend::readNDArray(const std::string &var, uint32_t index, NDArray<int32_t> &arr);
+template EXPORTISMRMRD void DatasetBackend::readNDArray(const std::string &var, uint32_t index, NDArray<float> &arr);
+template EXPORTISMRMRD void DatasetBackend::readNDArray(const std::string &var, uint32_t index, NDArray<double> &arr);
+template EXPORTISMRMRD void DatasetBackend::readNDArray(const std::string &var, uint32_t index, NDArray<complex_float_t> &arr);
+template EXPORTISMRMRD void DatasetBackend::readNDArray(const std::string &var, uint32_t index, NDArray<complex_double_t> &arr);
+
+//
+// HDF5Backend class implementation
+//
+HDF5Backend::HDF5Backend(const char *filename, const char *groupname, bool create_file_if_needed)
+{
+    DatasetOptions options;
+    ismrmrd_init_dataset_options(&options);
+    open(filename, groupname, create_file_if_needed, options);
+}
+
+HDF5Backend::HDF5Backend(const char *filename, const char *groupname, bool create_file_if_needed,
+                         const DatasetOptions &options)
+{
+    open(filename, groupname, create_file_if_needed, options);
+}
+
+HDF5Backend::~HDF5Backend()
+{
+    ismrmrd_close_dataset(&dset_);
+    free(dset_.filename);
+    free(dset_.groupname);
+}
+
+void HDF5Backend::open(const char *filename, const char *groupname, bool create_file_if_needed,
+                       const DatasetOptions &options)
+{
+    int status = ismrmrd_init_dataset(&dset_, filename, groupname);
+    if (status == ISMRMRD_NOERROR) {
+        dset_.options = options;
+        status = ismrmrd_open_dataset(&dset_, create_file_if_needed);
+    }
+    if (status != ISMRMRD_NOERROR) {
+        free(dset_.filename);
+        free(dset_.groupname);
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+void HDF5Backend::doWriteHeader(const std::string &xmlstring)
+{
+    if (ismrmrd_write_header(&dset_, xmlstring.c_str()) != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+void HDF5Backend::doReadHeader(std::string &xmlstring)
+{
+    char *temp = ismrmrd_read_header(&dset_);
+    if (temp == NULL) {
+        throw std::runtime_error(build_exception_string());
+    }
+    xmlstring = std::string(temp);
+    free(temp);
+}
+
+void HDF5Backend::doAppendAcquisitions(const ISMRMRD_Acquisition *acqs, uint32_t count)
+{
+    if (ismrmrd_append_acquisitions(&dset_, acqs, count) != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+void HDF5Backend::doReadAcquisitions(uint32_t start, uint32_t count, ISMRMRD_Acquisition *acqs)
+{
+    if (ismrmrd_read_acquisitions(&dset_, start, count, acqs) != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+uint32_t HDF5Backend::doGetNumberOfAcquisitions()
+{
+    return ismrmrd_get_number_of_acquisitions(&dset_);
+}
+
+void HDF5Backend::doAppendImage(const std::string &var, const ISMRMRD_Image *im)
+{
+    if (ismrmrd_append_image(&dset_, var.c_str(), im) != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+void HDF5Backend::doReadImage(const std::string &var, uint32_t index, ISMRMRD_Image *im)
+{
+    if (ismrmrd_read_image(&dset_, var.c_str(), index, im) != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+uint32_t HDF5Backend::doGetNumberOfImages(const std::string &var)
+{
+    return ismrmrd_get_number_of_images(&dset_, var.c_str());
+}
+
+void HDF5Backend::doAppendNDArray(const std::string &var, const ISMRMRD_NDArray *arr)
+{
+    if (ismrmrd_append_array(&dset_, var.c_str(), arr) != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+void HDF5Backend::doReadNDArray(const std::string &var, uint32_t index, ISMRMRD_NDArray *arr)
+{
+    if (ismrmrd_read_array(&dset_, var.c_str(), index, arr) != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+uint32_t HDF5Backend::doGetNumberOfNDArrays(const std::string &var)
+{
+    return ismrmrd_get_number_of_arrays(&dset_, var.c_str());
+}
+
+//
+// MemoryBackend class implementation
+//
+
+// Copies an image and keeps its attribute string null terminated like the one read from HDF5
+static void copy_image(ISMRMRD_Image *dest, const ISMRMRD_Image *src)
+{
+    if (ismrmrd_copy_image(dest, src) != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    size_t attr_size = ismrmrd_size_of_image_attribute_string(dest);
+    if (attr_size > 0) {
+        char *attr = static_cast<char *>(ismrmrd_realloc(dest->attribute_string, attr_size + 1));
+        if (attr == NULL) {
+            throw std::runtime_error("Failed to realloc image attribute string");
+        }
+        attr[attr_size] = '\0';
+        dest->attribute_string = attr;
+    }
+}
+
+static void copy_ndarray(ISMRMRD_NDArray *dest, const ISMRMRD_NDArray *src)
+{
+    if (ismrmrd_copy_ndarray(dest, src) != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+MemoryBackend::MemoryBackend()
+    : has_header_(false)
+{
+}
+
+MemoryBackend::~MemoryBackend()
+{
+    for (size_t i = 0; i < acquisitions_.size(); i++) {
+        ismrmrd_cleanup_acquisition(&acquisitions_[i]);
+    }
+    for (std::map<std::string, std::vector<ISMRMRD_Image> >::iterator it = images_.begin(); it != images_.end(); ++it) {
+        for (size_t i = 0; i < it->second.size(); i++) {
+            ismrmrd_cleanup_image(&it->second[i]);
+        }
+    }
+    for (std::map<std::string, std::vector<ISMRMRD_NDArray> >::iterator it = arrays_.begin(); it != arrays_.end(); ++it) {
+        for (size_t i = 0; i < it->second.size(); i++) {
+            ismrmrd_cleanup_ndarray(&it->second[i]);
+        }
+    }
+}
+
+void MemoryBackend::doWriteHeader(const std::string &xmlstring)
+{
+    header_ = xmlstring;
+    has_header_ = true;
+}
+
+void MemoryBackend::doReadHeader(std::string &xmlstring)
+{
+    if (!has_header_) {
+        throw std::runtime_error("Dataset has no header");
+    }
+    xmlstring = header_;
+}
+
+void MemoryBackend::doAppendAcquisitions(const ISMRMRD_Acquisition *acqs, uint32_t count)
+{
+    acquisitions_.reserve(acquisitions_.size() + count);
+    for (uint32_t i = 0; i < count; i++) {
+        ISMRMRD_Acquisition acq;
+        ismrmrd_init_acquisition(&acq);
+        if (ismrmrd_copy_acquisition(&acq, &acqs[i]) != ISMRMRD_NOERROR) {
+            ismrmrd_cleanup_acquisition(&acq);
+            throw std::runtime_error(build_exception_string());
+        }
+        acquisitions_.push_back(acq);
+    }
+}
+
+void MemoryBackend::doReadAcquisitions(uint32_t start, uint32_t count, ISMRMRD_Acquisition *acqs)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        if (ismrmrd_copy_acquisition(&acqs[i], &acquisitions_[start + i]) != ISMRMRD_NOERROR) {
+            throw std::runtime_error(build_exception_string());
+        }
+    }
+}
+
+uint32_t MemoryBackend::doGetNumberOfAcquisitions()
+{
+    return static_cast<uint32_t>(acquisitions_.size());
+}
+
+void MemoryBackend::doAppendImage(const std::string &var, const ISMRMRD_Image *im)
+{
+    ISMRMRD_Image copy;
+    ismrmrd_init_image(&copy);
+    try {
+        copy_image(&copy, im);
+        images_[var].push_back(copy);
+    } catch (...) {
+        ismrmrd_cleanup_image(&copy);
+        throw;
+    }
+}
+
+void MemoryBackend::doReadImage(const std::string &var, uint32_t index, ISMRMRD_Image *im)
+{
+    copy_image(im, &images_[var][index]);
+}
+
+uint32_t MemoryBackend::doGetNumberOfImages(const std::string &var)
+{
+    std::map<std::string, std::vector<ISMRMRD_Image> >::const_iterator it = images_.find(var);
+    return it == images_.end() ? 0 : static_cast<uint32_t>(it->second.size());
+}
+
+void MemoryBackend::doAppendNDArray(const std::string &var, const ISMRMRD_NDArray *arr)
+{
+    ISMRMRD_NDArray copy;
+    ismrmrd_init_ndarray(&copy);
+    try {
+        copy_ndarray(&copy, arr);
+        arrays_[var].push_back(copy);
+    } catch (...) {
+        ismrmrd_cleanup_ndarray(&copy);
+        throw;
+    }
+}
+
+void MemoryBackend::doReadNDArray(const std::string &var, uint32_t index, ISMRMRD_NDArray *arr)
+{
+    copy_ndarray(arr, &arrays_[var][index]);
+}
+
+uint32_t MemoryBackend::doGetNumberOfNDArrays(const std::string &var)
+{
+    std::map<std::string, std::vector<ISMRMRD_NDArray> >::const_iterator it = arrays_.find(var);
+    return it == arrays_.end() ? 0 : static_cast<uint32_t>(it->second.size());
+}
+
+//
+// LogBackend class implementation
+//
+
+// Message ids of the log file besides those of the stream format
+static const uint16_t log_index_id = 0x100;
+static const uint16_t log_footer_id = 0x101;
+
+// The footer holds a magic number and the offset of the index message
+static const char log_magic[8] = { 'I', 'S', 'M', 'R', 'M', 'L', 'O', 'G' };
+static const size_t log_prefix_size = sizeof(uint16_t) + sizeof(uint64_t);
+static const size_t log_footer_size = log_prefix_size + sizeof(log_magic) + sizeof(uint64_t);
+
+static const uint64_t no_offset = ~static_cast<uint64_t>(0);
+
+typedef std::map<std::string, std::vector<uint64_t> > LogVariables;
+
+// The index body is the header offset, the acquisition offsets and the
+// offsets of the images and arrays by variable, every list preceded by its length
+static void put_index(std::string &s, const void *data, size_t size)
+{
+    s.append(static_cast<const char *>(data), size);
+}
+
+static void put_offsets(std::string &s, const std::vector<uint64_t> &offsets)
+{
+    uint64_t count = offsets.size();
+    put_index(s, &count, sizeof(count));
+    if (count > 0) {
+        put_index(s, &offsets[0], offsets.size() * sizeof(uint64_t));
+    }
+}
+
+static void put_variables(std::string &s, const LogVariables &vars)
+{
+    uint32_t count = static_cast<uint32_t>(vars.size());
+    put_index(s, &count, sizeof(count));
+    for (LogVariables::const_iterator it = vars.begin(); it != vars.end(); ++it) {
+        uint16_t name_length = static_cast<uint16_t>(it->first.size());
+        put_index(s, &name_length, sizeof(name_length));
+        put_index(s, it->first.data(), name_length);
+        put_offsets(s, it->second);
+    }
+}
+
+struct LogIndexCursor {
+    const char *pos;
+    const char *end;
+};
+
+static bool get_index(LogIndexCursor &c, void *data, size_t size)
+{
+    if (size > static_cast<size_t>(c.end - c.pos)) {
+        return false;
+    }
+    memcpy(data, c.pos, size);
+    c.pos += size;
+    return true;
+}
+
+static bool get_offsets(LogIndexCursor &c, std::vector<uint64_t> &offsets, uint64_t limit)
+{
+    uint64_t count;
+    if (!get_index(c, &count, sizeof(count)) ||
+        count > static_cast<size_t>(c.end - c.pos) / sizeof(uint64_t) || count > 0xFFFFFFFF) {
+        return false;
+    }
+    offsets.resize(static_cast<size_t>(count));
+    for (size_t i = 0; i < offsets.size(); i++) {
+        if (!get_index(c, &offsets[i], sizeof(uint64_t)) || offsets[i] >= limit) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool get_variables(LogIndexCursor &c, LogVariables &vars, uint64_t limit)
+{
+    uint32_t count;
+    if (!get_index(c, &count, sizeof(count))) {
+        return false;
+    }
+    for (uint32_t n = 0; n < count; n++) {
+        uint16_t name_length;
+        if (!get_index(c, &name_length, sizeof(name_length))) {
+            return false;
+        }
+        std::string name(name_length, '\0');
+        if ((name_length > 0 && !get_index(c, &name[0], name_length)) || !get_offsets(c, vars[name], limit)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+LogBackend::LogBackend(const char *filename, bool create_file_if_needed)
+    : filename_(filename)
+    , writer_(NULL)
+    , size_(0)
+    , complete_(true)
+    , modified_(false)
+    , header_offset_(no_offset)
+{
+    in_.open(filename, std::ios::in | std::ios::binary);
+    if (!in_.is_open()) {
+        if (!create_file_if_needed) {
+            throw std::runtime_error("Failed to open log file " + filename_);
+        }
+        beginAppend();
+        in_.open(filename, std::ios::in | std::ios::binary);
+        if (!in_.is_open()) {
+            delete writer_;
+            throw std::runtime_error("Failed to open log file " + filename_);
+        }
+        return;
+    }
+
+    in_.seekg(0, std::ios::end);
+    size_ = static_cast<uint64_t>(in_.tellg());
+    if (size_ > 0 && !loadIndex()) {
+        scan();
+    }
+}
+
+LogBackend::~LogBackend()
+{
+    try {
+        if (writer_ != NULL && modified_) {
+            writeIndex();
+        }
+    } catch (...) {
+    }
+    delete writer_;
+}
+
+void LogBackend::doWriteHeader(const std::string &xmlstring)
+{
+    beginAppend();
+    uint64_t offset = size_ + writer_->position();
+    writer_->writeHeader(xmlstring);
+    header_offset_ = offset;
+}
+
+void LogBackend::doReadHeader(std::string &xmlstring)
+{
+    if (header_offset_ == no_offset) {
+        throw std::runtime_error("Dataset has no header");
+    }
+    seekRecord(header_offset_);
+    StreamReader reader(in_);
+    reader.readHeader(xmlstring);
+}
+
+void LogBackend::doAppendAcquisitions(const ISMRMRD_Acquisition *acqs, uint32_t count)
+{
+    beginAppend();
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t offset = size_ + writer_->position();
+        writer_->writeAcquisition(&acqs[i]);
+        acquisitions_.push_back(offset);
+    }
+}
+
+void LogBackend::doReadAcquisitions(uint32_t start, uint32_t count, ISMRMRD_Acquisition *acqs)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        seekRecord(acquisitions_[start + i]);
+        StreamReader reader(in_);
+        reader.readAcquisition(&acqs[i]);
+    }
+}
+
+uint32_t LogBackend::doGetNumberOfAcquisitions()
+{
+    return static_cast<uint32_t>(acquisitions_.size());
+}
+
+void LogBackend::doAppendImage(const std::string &var, const ISMRMRD_Image *im)
+{
+    beginAppend();
+    uint64_t offset = size_ + writer_->position();
+    writer_->writeImage(var, im);
+    images_[var].push_back(offset);
+}
+
+void LogBackend::doReadImage(const std::string &var, uint32_t index, ISMRMRD_Image *im)
+{
+    seekRecord(images_[var][index]);
+    StreamReader reader(in_);
+    std::string name;
+    reader.readImage(name, im);
+}
+
+uint32_t LogBackend::doGetNumberOfImages(const std::string &var)
+{
+    VariableIndex::const_iterator it = images_.find(var);
+    return it == images_.end() ? 0 : static_cast<uint32_t>(it->second.size());
+}
+
+void LogBackend::doAppendNDArray(const std::string &var, const ISMRMRD_NDArray *arr)
+{
+    beginAppend();
+    uint64_t offset = size_ + writer_->position();
+    writer_->writeNDArray(var, arr);
+    arrays_[var].push_back(offset);
+}
+
+void LogBackend::doReadNDArray(const std::string &var, uint32_t index, ISMRMRD_NDArray *arr)
+{
+    seekRecord(arrays_[var][index]);
+    StreamReader reader(in_);
+    std::string name;
+    reader.readNDArray(name, arr);
+}
+
+uint32_t LogBackend::doGetNumberOfNDArrays(const std::string &var)
+{
+    VariableIndex::const_iterator it = arrays_.find(var);
+    return it == arrays_.end() ? 0 : static_cast<uint32_t>(it->second.size());
+}
+
+void LogBackend::doFlush()
+{
+    if (writer_ != NULL) {
+        writer_->flush();
+    }
+}
+
+// Loads the index the footer points at, false if there is no valid one
+bool LogBackend::loadIndex()
+{
+    if (size_ < log_prefix_size + log_footer_size) {
+        return false;
+    }
+    char footer[log_footer_size];
+    in_.seekg(static_cast<std::streamoff>(size_ - log_footer_size));
+    if (!in_.read(footer, log_footer_size)) {
+        in_.clear();
+        return false;
+    }
+    uint16_t id;
+    uint64_t length, index_offset;
+    memcpy(&id, footer, sizeof(id));
+    memcpy(&length, footer + sizeof(id), sizeof(length));
+    memcpy(&index_offset, footer + log_prefix_size + sizeof(log_magic), sizeof(index_offset));
+    if (id != log_footer_id || length != log_footer_size - log_prefix_size ||
+        memcmp(footer + log_prefix_size, log_magic, sizeof(log_magic)) != 0 ||
+        index_offset > size_ - log_footer_size - log_prefix_size) {
+        return false;
+    }
+
+    char prefix[log_prefix_size];
+    in_.seekg(static_cast<std::streamoff>(index_offset));
+    if (!in_.read(prefix, log_prefix_size)) {
+        in_.clear();
+        return false;
+    }
+    memcpy(&id, prefix, sizeof(id));
+    memcpy(&length, prefix + sizeof(id), sizeof(length));
+    if (id != log_index_id || length != size_ - log_footer_size - log_prefix_size - index_offset) {
+        return false;
+    }
+    std::vector<char> body(static_cast<size_t>(length));
+    if (length > 0 && !in_.read(&body[0], body.size())) {
+        in_.clear();
+        return false;
+    }
+
+    LogIndexCursor c;
+    c.pos = body.empty() ? NULL : &body[0];
+    c.end = c.pos + body.size();
+    if (!get_index(c, &header_offset_, sizeof(header_offset_)) ||
+        (header_offset_ != no_offset && header_offset_ >= index_offset) ||
+        !get_offsets(c, acquisitions_, index_offset) ||
+        !get_variables(c, images_, index_offset) ||
+        !get_variables(c, arrays_, index_offset) || c.pos != c.end) {
+        header_offset_ = no_offset;
+        acquisitions_.clear();
+        images_.clear();
+        arrays_.clear();
+        return false;
+    }
+    return true;
+}
+
+// Indexes the file by reading the prefix of every message
+void LogBackend::scan()
+{
+    uint64_t pos = 0;
+    while (size_ - pos >= log_prefix_size) {
+        char prefix[log_prefix_size];
+        in_.seekg(static_cast<std::streamoff>(pos));
+        if (!in_.read(prefix, log_prefix_size)) {
+            throw std::runtime_error("Failed to read log file " + filename_);
+        }
+        uint16_t id;
+        uint64_t length;
+        memcpy(&id, prefix, sizeof(id));
+        memcpy(&length, prefix + sizeof(id), sizeof(length));
+        if (length > size_ - pos - log_prefix_size) {
+            break;
+        }
+
+        switch (id) {
+        case ISMRMRD_STREAM_HEADER:
+            header_offset_ = pos;
+            break;
+        case ISMRMRD_STREAM_ACQUISITION:
+            acquisitions_.push_back(pos);
+            break;
+        case ISMRMRD_STREAM_IMAGE:
+        case ISMRMRD_STREAM_NDARRAY: {
+            uint16_t name_length;
+            if (length < sizeof(name_length) || !in_.read(reinterpret_cast<char *>(&name_length), sizeof(name_length)) ||
+                name_length > length - sizeof(name_length)) {
+                throw std::runtime_error("Malformed message in log file " + filename_);
+            }
+            std::string name(name_length, '\0');
+            if (name_length > 0 && !in_.read(&name[0], name_length)) {
+                throw std::runtime_error("Failed to read log file " + filename_);
+            }
+            (id == ISMRMRD_STREAM_IMAGE ? images_ : arrays_)[name].push_back(pos);
+            break;
+        }
+        case ISMRMRD_STREAM_CLOSE:
+        case log_index_id:
+        case log_footer_id:
+            break;
+        default:
+            throw std::runtime_error("Invalid message in log file " + filename_);
+        }
+        pos += log_prefix_size + length;
+    }
+
+    // the messages up to the incomplete one can be read but nothing appended after it
+    complete_ = pos == size_;
+    in_.clear();
+}
+
+void LogBackend::writeIndex()
+{
+    std::string body;
+    put_index(body, &header_offset_, sizeof(header_offset_));
+    put_offsets(body, acquisitions_);
+    put_variables(body, images_);
+    put_variables(body, arrays_);
+
+    writer_->flush();
+    uint64_t index_offset = size_ + writer_->position();
+    uint16_t id = log_index_id;
+    uint64_t length = body.size();
+    out_.write(reinterpret_cast<const char *>(&id), sizeof(id));
+    out_.write(reinterpret_cast<const char *>(&length), sizeof(length));
+    out_.write(body.data(), body.size());
+
+    id = log_footer_id;
+    length = sizeof(log_magic) + sizeof(index_offset);
+    out_.write(reinterpret_cast<const char *>(&id), sizeof(id));
+    out_.write(reinterpret_cast<const char *>(&length), sizeof(length));
+    out_.write(log_magic, sizeof(log_magic));
+    out_.write(reinterpret_cast<const char *>(&index_offset), sizeof(index_offset));
+    if (!out_.flush()) {
+        throw std::runtime_error("Failed to write the index of log file " + filename_);
+    }
+}
+
+// Opens the file for appending on the first write
+void LogBackend::beginAppend()
+{
+    modified_ = true;
+    if (writer_ != NULL) {
+        return;
+    }
+    if (!complete_) {
+        throw std::runtime_error("Log file " + filename_ + " ends with an incomplete message and can only be read");
+    }
+    out_.open(filename_.c_str(), std::ios::out | std::ios::app | std::ios::binary);
+    if (!out_.is_open()) {
+        throw std::runtime_error("Failed to open log file " + filename_ + " for writing");
+    }
+    writer_ = new StreamWriter(out_);
+}
+
+// Positions the input at a message, appended messages are written out first
+void LogBackend::seekRecord(uint64_t offset)
+{
+    if (writer_ != NULL) {
+        writer_->flush();
+    }
+    in_.clear();
+    if (static_cast<uint64_t>(in_.tellg()) != offset) {
+        in_.seekg(static_cast<std::streamoff>(offset));
+    }
+}
+
+} // namespace ISMRMRD
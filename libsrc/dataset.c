@@ -1,3 +1,8 @@
+#ifndef _WIN32
+/* realpath */
+#define _XOPEN_SOURCE 700
+#endif
+
 /* Language and Cross platform section for defining types */
 #ifdef __cplusplus
 #include <cstring>
@@ -10,14 +15,52 @@
 #include <stdio.h>
 #endif /* __cplusplus */
 
+#ifndef _WIN32
+/* mapping frames of a variable from the file */
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #include <hdf5.h>
 #include "ismrmrd/dataset.h"
+#include "lock.h"
 
 #ifdef __cplusplus
 namespace ISMRMRD {
 extern "C" {
 #endif
 
+/* Default dataset options, see ismrmrd_init_dataset_options */
+/* 1024 rows keeps an acquisition chunk (header and payload references) at about 400 kB */
+#define ISMRMRD_DEFAULT_ACQUISITION_CHUNK_ROWS 1024
+/* no larger than the default HDF5 chunk cache */
+#define ISMRMRD_DEFAULT_CHUNK_SIZE (1024 * 1024)
+/* largest staging buffer of a batched image data transfer, larger copies cost more than the extra HDF5 calls */
+#define ISMRMRD_IMAGE_BLOCK_SIZE (4 * 1024 * 1024)
+/* growth of a file held by the core driver when options.core_increment is 0 */
+#define ISMRMRD_DEFAULT_CORE_INCREMENT (1024 * 1024)
+/* rows added to a full variable with ISMRMRD_GROWTH_BLOCKS when options.extent_block_rows is 0 */
+#define ISMRMRD_DEFAULT_EXTENT_BLOCK_ROWS 1024
+/* attribute holding the number of rows of a variable grown ahead of them */
+#define ISMRMRD_COUNT_ATTRIBUTE "count"
+
+/* Single-writer/multiple-reader access is available from HDF5 1.10 */
+#if H5_VERSION_GE(1, 10, 0)
+#define ISMRMRD_HAVE_SWMR
+#endif
+
+/* Paged file space and the page buffer are available from HDF5 1.10.1 */
+#if H5_VERSION_GE(1, 10, 1)
+#define ISMRMRD_HAVE_PAGED_FILE_SPACE
+#endif
+
+/* The file address of each chunk is available from HDF5 1.10.5 */
+#if H5_VERSION_GE(1, 10, 5)
+#define ISMRMRD_HAVE_CHUNK_INFO
+#endif
+
 /******************************/
 /* Private (Static) Functions */
 /******************************/
@@ -128,27 +171,6 @@ static char * append_to_path(const ISMRMRD_Dataset *dset,
     return newpath;
 }
 
-static int delete_var(const ISMRMRD_Dataset *dset, const char *var) {
-    int status = ISMRMRD_NOERROR;
-    herr_t h5status;
-    char *path = NULL;
-
-    if (NULL == dset) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
-    }
-
-    path = make_path(dset, var);
-    if (link_exists(dset, path)) {
-        h5status = H5Ldelete(dset->fileid, path, H5P_DEFAULT);
-        if (h5status < 0) {
-            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-            status = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to delete H5 path");
-        }
-    }
-    free(path);
-    return status;
-}
-
 /*********************************************/
 /* Private (Static) Functions for HDF5 Types */
 /*********************************************/
@@ -159,6 +181,13 @@ typedef struct HDF5_Acquisition
     hvl_t data;
 } HDF5_Acquisition;
 
+/* Row of groupname/acquisition_index, row i describes acquisition i */
+typedef struct HDF5_AcquisitionIndexEntry
+{
+    uint64_t flags;
+    ISMRMRD_EncodingCounters idx;
+} HDF5_AcquisitionIndexEntry;
+
 static hid_t get_hdf5type_uint16(void) {
     hid_t datatype = H5Tcopy(H5T_NATIVE_UINT16);
     return datatype;
@@ -353,6 +382,73 @@ static hid_t get_hdf5type_acquisition(void) {
     return datatype;
 }
 
+/* Memory type selecting only the header of the acquisition compound */
+static hid_t get_hdf5type_acquisition_head_only(void) {
+    hid_t datatype, vartype;
+    herr_t h5status;
+
+    datatype = H5Tcreate(H5T_COMPOUND, sizeof(ISMRMRD_AcquisitionHeader));
+    vartype = get_hdf5type_acquisitionheader();
+    h5status = H5Tinsert(datatype, "head", 0, vartype);
+    H5Tclose(vartype);
+
+    if (h5status < 0) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed get acquisition header only data type");
+    }
+
+    return datatype;
+}
+
+/* Memory type for the headers of an array of ISMRMRD_Acquisition, the payload pointers are skipped */
+static hid_t get_hdf5type_acquisition_array_head(void) {
+    hid_t datatype;
+    herr_t h5status;
+
+    /* the header is the first member of ISMRMRD_Acquisition */
+    datatype = get_hdf5type_acquisitionheader();
+    h5status = H5Tset_size(datatype, sizeof(ISMRMRD_Acquisition));
+
+    if (h5status < 0) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed get acquisition array header data type");
+    }
+
+    return datatype;
+}
+
+static hid_t get_hdf5type_acquisition_index(void) {
+    hid_t datatype, vartype;
+    herr_t h5status;
+
+    datatype = H5Tcreate(H5T_COMPOUND, sizeof(HDF5_AcquisitionIndexEntry));
+    h5status = H5Tinsert(datatype, "flags", HOFFSET(HDF5_AcquisitionIndexEntry, flags), H5T_NATIVE_UINT64);
+    vartype = get_hdf5type_encoding();
+    h5status = H5Tinsert(datatype, "idx", HOFFSET(HDF5_AcquisitionIndexEntry, idx), vartype);
+    H5Tclose(vartype);
+
+    if (h5status < 0) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed get acquisition index data type");
+    }
+
+    return datatype;
+}
+
+/* Memory type selecting the flags and counters of the acquisition compound as an index entry */
+static hid_t get_hdf5type_acquisition_index_source(void) {
+    hid_t datatype, vartype;
+    herr_t h5status;
+
+    datatype = H5Tcreate(H5T_COMPOUND, sizeof(HDF5_AcquisitionIndexEntry));
+    vartype = get_hdf5type_acquisition_index();
+    h5status = H5Tinsert(datatype, "head", 0, vartype);
+    H5Tclose(vartype);
+
+    if (h5status < 0) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed get acquisition index source data type");
+    }
+
+    return datatype;
+}
+
 static hid_t get_hdf5type_imageheader(void) {
     hid_t datatype;
     herr_t h5status;
@@ -458,363 +554,1920 @@ static hid_t get_hdf5type_ndarray(uint16_t data_type) {
     return hdfdatatype;
 }
 
-static uint16_t get_ndarray_data_type(hid_t hdf5type) {
+/**********************************************/
+/* Private (Static) Functions for the Session */
+/**********************************************/
+
+/* An open HDF5 dataset together with its cached extent */
+typedef struct ISMRMRD_CachedVariable {
+    char *path;                                /* full path of the variable in the file */
+    hid_t dataset;                             /* open dataset handle */
+    int rank;                                  /* rank of the dataset, including the append dimension */
+    hsize_t dims[ISMRMRD_NDARRAY_MAXDIM + 1];  /* current extent, dims[0] is the number of elements */
+    hsize_t allocated;                         /* extent of the append dimension in the file, at least dims[0] */
+    hid_t count_attr;                          /* open count attribute, 0 while the extent is exact */
+    bool grown;                                /* this dataset grew the extent ahead of the rows */
+    uint16_t data_type;                        /* NDArray data type, 0 until looked up */
+} ISMRMRD_CachedVariable;
+
+/* Datatypes and open datasets kept for the lifetime of an open ISMRMRD_Dataset */
+struct ISMRMRD_DatasetCache {
+    hid_t acquisition_type;
+    hid_t acquisition_head_type;
+    hid_t acquisition_header_type;
+    hid_t acquisition_array_head_type;
+    hid_t acquisition_index_type;
+    hid_t acquisition_index_source_type;
+    hid_t image_header_type;
+    hid_t string_type;
+    hid_t attribute_string_type;
+    hid_t ndarray_types[ISMRMRD_CXDOUBLE + 1];
+    hid_t dataset_access;                      /* access properties with the chunk cache settings */
+    hid_t payload_transfer;                    /* transfer properties for reads into acquisition buffers */
+    ISMRMRD_CachedVariable **vars;
+    size_t num_vars;
+    size_t max_vars;
+    bool swmr_started;                         /* ISMRMRD_SWMR_WRITE mode is streaming */
+    uint32_t swmr_unflushed;                   /* acquisitions appended since the last flush to readers */
+    uint32_t swmr_committed;                   /* ISMRMRD_SWMR_READ mode, acquisitions safe to read */
+    int acquisition_layout;                    /* ISMRMRD_AcquisitionLayouts of the file, -1 until known */
+};
+
+static int create_cache(ISMRMRD_Dataset *dset) {
+    ISMRMRD_DatasetCache *cache;
+    herr_t h5status;
+    int n;
 
-    uint16_t dtype = 0;
-    hid_t t;
-    
-    t = get_hdf5type_uint16();
-    if (H5Tequal(hdf5type, t)) {
-        dtype = ISMRMRD_USHORT;
+    cache = (ISMRMRD_DatasetCache *) calloc(1, sizeof(*cache));
+    if (cache == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc dataset cache");
     }
-    H5Tclose(t);
 
-    t = get_hdf5type_int16();
-    if (H5Tequal(hdf5type, t)) {
-        dtype = ISMRMRD_SHORT;
+    cache->acquisition_type = get_hdf5type_acquisition();
+    cache->acquisition_head_type = get_hdf5type_acquisition_head_only();
+    cache->acquisition_header_type = get_hdf5type_acquisitionheader();
+    cache->acquisition_array_head_type = get_hdf5type_acquisition_array_head();
+    cache->acquisition_index_type = get_hdf5type_acquisition_index();
+    cache->acquisition_index_source_type = get_hdf5type_acquisition_index_source();
+    cache->image_header_type = get_hdf5type_imageheader();
+    cache->string_type = get_hdf5type_xmlheader();
+    cache->attribute_string_type = get_hdf5type_image_attribute_string();
+    cache->ndarray_types[0] = -1;
+    for (n = ISMRMRD_USHORT; n <= ISMRMRD_CXDOUBLE; n++) {
+        cache->ndarray_types[n] = get_hdf5type_ndarray(n);
     }
-    H5Tclose(t);
+    cache->vars = NULL;
+    cache->num_vars = 0;
+    cache->max_vars = 0;
+    cache->swmr_started = false;
+    cache->swmr_unflushed = 0;
+    cache->swmr_committed = UINT32_MAX;
+    cache->acquisition_layout = -1;
+
+    cache->payload_transfer = H5Pcreate(H5P_DATASET_XFER);
+
+    /* chunk cache used for every variable opened or created in this session */
+    cache->dataset_access = H5Pcreate(H5P_DATASET_ACCESS);
+    if (dset->options.chunk_cache_size > 0 || dset->options.chunk_cache_slots > 0) {
+        h5status = H5Pset_chunk_cache(cache->dataset_access,
+                dset->options.chunk_cache_slots > 0 ? dset->options.chunk_cache_slots : H5D_CHUNK_CACHE_NSLOTS_DEFAULT,
+                dset->options.chunk_cache_size > 0 ? dset->options.chunk_cache_size : H5D_CHUNK_CACHE_NBYTES_DEFAULT,
+                H5D_CHUNK_CACHE_W0_DEFAULT);
+        if (h5status < 0) {
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to set chunk cache.");
+        }
+    }
+
+    dset->cache = cache;
+    return ISMRMRD_NOERROR;
+}
+
+/* Closes every open variable */
+static int close_variables(ISMRMRD_DatasetCache *cache) {
+    int status = ISMRMRD_NOERROR;
+    size_t i;
 
-    t = get_hdf5type_uint32();
-    if (H5Tequal(hdf5type, t)) {
-        dtype = ISMRMRD_UINT;
+    for (i = 0; i < cache->num_vars; i++) {
+        if (cache->vars[i]->count_attr > 0) {
+            H5Aclose(cache->vars[i]->count_attr);
+        }
+        if (H5Dclose(cache->vars[i]->dataset) < 0) {
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            status = ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close dataset.");
+        }
+        free(cache->vars[i]->path);
+        free(cache->vars[i]);
     }
-    H5Tclose(t);
+    cache->num_vars = 0;
+    return status;
+}
+
+static int destroy_cache(ISMRMRD_Dataset *dset) {
+    ISMRMRD_DatasetCache *cache = dset->cache;
+    int status;
+    int n;
 
-    t = get_hdf5type_int32();
-    if (H5Tequal(hdf5type, t)) {
-        dtype = ISMRMRD_INT;
+    if (cache == NULL) {
+        return ISMRMRD_NOERROR;
     }
-    H5Tclose(t);
 
-    t = get_hdf5type_float();
-    if (H5Tequal(hdf5type, t)) {
-        dtype = ISMRMRD_FLOAT;
+    status = close_variables(cache);
+    free(cache->vars);
+
+    H5Tclose(cache->acquisition_type);
+    H5Tclose(cache->acquisition_head_type);
+    H5Tclose(cache->acquisition_header_type);
+    H5Tclose(cache->acquisition_array_head_type);
+    H5Tclose(cache->acquisition_index_type);
+    H5Tclose(cache->acquisition_index_source_type);
+    H5Tclose(cache->image_header_type);
+    H5Tclose(cache->string_type);
+    H5Tclose(cache->attribute_string_type);
+    for (n = ISMRMRD_USHORT; n <= ISMRMRD_CXDOUBLE; n++) {
+        H5Tclose(cache->ndarray_types[n]);
     }
-    H5Tclose(t);
+    H5Pclose(cache->dataset_access);
+    H5Pclose(cache->payload_transfer);
+
+    free(cache);
+    dset->cache = NULL;
+    return status;
+}
+
+/* Compares a cached path against groupname/var[/sub] without building the string */
+static bool path_matches(const char *path, const char *group, const char *var, const char *sub) {
+    size_t len;
 
-    t = get_hdf5type_double();
-    if (H5Tequal(hdf5type, t)) {
-        dtype = ISMRMRD_DOUBLE;
+    len = strlen(group);
+    if (strncmp(path, group, len) != 0 || path[len] != '/') {
+        return false;
     }
-    H5Tclose(t);
+    path += len + 1;
 
-    t = get_hdf5type_complexfloat();
-    if (H5Tequal(hdf5type, t)) {
-        dtype = ISMRMRD_CXFLOAT;
+    len = strlen(var);
+    if (strncmp(path, var, len) != 0) {
+        return false;
     }
-    H5Tclose(t);
+    path += len;
 
-    t = get_hdf5type_complexdouble();
-    if (H5Tequal(hdf5type, t)) {
-        dtype = ISMRMRD_CXDOUBLE;
+    if (sub == NULL) {
+        return *path == '\0';
     }
-    H5Tclose(t);
+    return *path == '/' && strcmp(path + 1, sub) == 0;
+}
 
-    if (dtype == 0) {
-        //ISMRMRD_PUSH_ERR(ISMRMRD_TYPEERROR, "Failed to get data type from HDF5 data type.");
+static char * make_var_path(const ISMRMRD_Dataset *dset, const char *var, const char *sub) {
+    char *path, *subpath;
+
+    path = make_path(dset, var);
+    if (path == NULL || sub == NULL) {
+        return path;
     }
-    
-    return dtype;
+    subpath = append_to_path(dset, path, sub);
+    free(path);
+    return subpath;
 }
 
-static uint32_t get_number_of_elements(const ISMRMRD_Dataset *dset, const char * path)
-{
-    herr_t h5status;
-    uint32_t num;
+static ISMRMRD_CachedVariable * find_variable(const ISMRMRD_Dataset *dset, const char *var, const char *sub) {
+    ISMRMRD_DatasetCache *cache = dset->cache;
+    size_t i;
 
-    if (NULL == dset) {
-        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
-        return 0;
+    if (cache == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < cache->num_vars; i++) {
+        if (path_matches(cache->vars[i]->path, dset->groupname, var, sub)) {
+            return cache->vars[i];
+        }
     }
+    return NULL;
+}
 
-    if (link_exists(dset, path)) {
-        hid_t dataset, dataspace;
-        hsize_t rank, *dims, *maxdims;
-        dataset = H5Dopen2(dset->fileid, path, H5P_DEFAULT);
-        dataspace = H5Dget_space(dataset);
-        rank = H5Sget_simple_extent_ndims(dataspace);
-        dims = (hsize_t *) malloc(rank*sizeof(hsize_t));
-        maxdims = (hsize_t *) malloc(rank*sizeof(hsize_t));
-        h5status = H5Sget_simple_extent_dims(dataspace, dims, maxdims);
-        num = dims[0];
-        free(dims);
-        free(maxdims);
-        h5status = H5Sclose(dataspace);
-        h5status= H5Dclose(dataset);
-        if (h5status < 0) {
-            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-            ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR,
-                    "Failed to get number of elements in vector.");
+/* Takes ownership of path and dataset */
+static ISMRMRD_CachedVariable * add_variable(const ISMRMRD_Dataset *dset, char *path, hid_t dataset,
+                                             int rank, const hsize_t *dims) {
+    ISMRMRD_DatasetCache *cache = dset->cache;
+    ISMRMRD_CachedVariable *v, **vars;
+    int n;
+
+    v = (ISMRMRD_CachedVariable *) calloc(1, sizeof(*v));
+    if (v == NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc cached variable");
+        H5Dclose(dataset);
+        free(path);
+        return NULL;
+    }
+    if (cache->num_vars == cache->max_vars) {
+        cache->max_vars = cache->max_vars > 0 ? 2 * cache->max_vars : 8;
+        vars = (ISMRMRD_CachedVariable **) realloc(cache->vars, cache->max_vars * sizeof(*vars));
+        if (vars == NULL) {
+            ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to realloc dataset cache");
+            H5Dclose(dataset);
+            free(path);
+            free(v);
+            return NULL;
         }
+        cache->vars = vars;
     }
-    else {
-        /* none */
-        num = 0;
+
+    v->path = path;
+    v->dataset = dataset;
+    v->rank = rank;
+    for (n = 0; n < rank; n++) {
+        v->dims[n] = dims[n];
     }
-    
-    return num;
+    v->allocated = dims[0];
+    v->count_attr = 0;
+    v->grown = false;
+    v->data_type = 0;
+
+    cache->vars[cache->num_vars++] = v;
+    return v;
 }
 
-static int append_element(const ISMRMRD_Dataset * dset, const char * path,
-        void * elem, const hid_t datatype,
-        const uint16_t ndim, const size_t *dims)
-{
-    hid_t dataset, dataspace, props, filespace, memspace;
-    herr_t h5status = 0;
-    hsize_t *hdfdims = NULL, *ext_dims = NULL, *offset = NULL, *maxdims = NULL, *chunk_dims = NULL;
-    int n = 0, rank = 0;
-    
-    if (NULL == dset) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
-    }
+static void forget_variable(const ISMRMRD_Dataset *dset, const char *var, const char *sub) {
+    ISMRMRD_DatasetCache *cache = dset->cache;
+    size_t i;
 
-    /* Check the path and find rank */
-    if (link_exists(dset, path)) {
-        /* open dataset */
-        dataset = H5Dopen2(dset->fileid, path, H5P_DEFAULT);
-        /* TODO check that the header dataset's datatype is correct */
-        dataspace = H5Dget_space(dataset);
-        rank = H5Sget_simple_extent_ndims(dataspace);
-        if (rank != ndim + 1) {
-            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dimensions are incorrect.");
+    if (cache == NULL) {
+        return;
+    }
+    for (i = 0; i < cache->num_vars; i++) {
+        if (path_matches(cache->vars[i]->path, dset->groupname, var, sub)) {
+            if (cache->vars[i]->count_attr > 0) {
+                H5Aclose(cache->vars[i]->count_attr);
+            }
+            H5Dclose(cache->vars[i]->dataset);
+            free(cache->vars[i]->path);
+            free(cache->vars[i]);
+            cache->vars[i] = cache->vars[--cache->num_vars];
+            return;
         }
-    } else {
-        dataset   = -1; /* will be initialized below */
-        dataspace = -1; /* will be initialized below */
-        rank = ndim + 1;
     }
+}
 
-    hdfdims = (hsize_t *) malloc(rank * sizeof(hsize_t));
-    maxdims = (hsize_t *) malloc(rank * sizeof(hsize_t));
-    offset = (hsize_t *) malloc(rank * sizeof(hsize_t));
-    ext_dims = (hsize_t *) malloc(rank * sizeof(hsize_t));
-    chunk_dims = (hsize_t *) malloc(rank * sizeof(hsize_t));
+/* Takes the number of rows from the count attribute of a variable grown ahead of them */
+static int load_row_count(ISMRMRD_CachedVariable *v) {
+    uint64_t rows;
+    htri_t exists;
 
-    /* extend or create if needed, and select the last block */
-    if (link_exists(dset, path)) {
-        h5status = H5Sget_simple_extent_dims(dataspace, hdfdims, maxdims);
-        for (n = 0; n<ndim; n++) {
-            if (dims[n] != hdfdims[n+1]) {
-                return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dimensions are incorrect.");
-            }
+    v->allocated = v->dims[0];
+    if (v->count_attr <= 0) {
+        exists = H5Aexists(v->dataset, ISMRMRD_COUNT_ATTRIBUTE);
+        if (exists == 0) {
+            return ISMRMRD_NOERROR;
         }
-        /* extend it by one */
-        hdfdims[0] += 1;
-        h5status = H5Dset_extent(dataset, hdfdims);
-        /* Select the last block */
-        ext_dims[0] = 1;
-        for (n = 0; n < ndim; n++) {
-            offset[n + 1] = 0;
-            ext_dims[n + 1] = dims[n];
+        v->count_attr = exists > 0 ? H5Aopen(v->dataset, ISMRMRD_COUNT_ATTRIBUTE, H5P_DEFAULT) : -1;
+    }
+    if (v->count_attr < 0 || H5Aread(v->count_attr, H5T_NATIVE_UINT64, &rows) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        if (v->count_attr > 0) {
+            H5Aclose(v->count_attr);
         }
-    } else {
-        hdfdims[0] = 1;
-        maxdims[0] = H5S_UNLIMITED;
-        ext_dims[0] = 1;
-        chunk_dims[0] = 1;
-        for (n = 0; n < ndim; n++) {
-            hdfdims[n + 1] = dims[n];
-            maxdims[n + 1] = dims[n];
-            offset[n + 1] = 0;
-            ext_dims[n + 1] = dims[n];
-            chunk_dims[n + 1] = dims[n];
-        }
-        dataspace = H5Screate_simple(rank, hdfdims, maxdims);
-        props = H5Pcreate(H5P_DATASET_CREATE);
-        /* enable chunking so that the dataset is extensible */
-        h5status = H5Pset_chunk (props, rank, chunk_dims);
-        /* create */
-        dataset = H5Dcreate2(dset->fileid, path, datatype, dataspace, H5P_DEFAULT, props,  H5P_DEFAULT);
-        if (dataset < 0) {
+        v->count_attr = 0;
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to read the row count of a variable.");
+    }
+    if (rows < v->dims[0]) {
+        v->dims[0] = rows;
+    }
+    return ISMRMRD_NOERROR;
+}
+
+/* Records the number of rows of a variable grown ahead of them, drops it once they fill the extent */
+static int store_row_count(ISMRMRD_CachedVariable *v) {
+    uint64_t rows = v->dims[0];
+    hid_t dataspace;
+
+    if (v->allocated == v->dims[0]) {
+        if (v->count_attr <= 0) {
+            return ISMRMRD_NOERROR;
+        }
+        H5Aclose(v->count_attr);
+        v->count_attr = 0;
+        if (H5Adelete(v->dataset, ISMRMRD_COUNT_ATTRIBUTE) < 0) {
             H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to create dataset");
+            return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to delete the row count of a variable.");
         }
-        h5status = H5Pclose(props);
-        if (h5status < 0) {
+        return ISMRMRD_NOERROR;
+    }
+    if (v->count_attr <= 0) {
+        dataspace = H5Screate(H5S_SCALAR);
+        v->count_attr = H5Acreate2(v->dataset, ISMRMRD_COUNT_ATTRIBUTE, H5T_STD_U64LE, dataspace,
+                                   H5P_DEFAULT, H5P_DEFAULT);
+        H5Sclose(dataspace);
+        if (v->count_attr < 0) {
             H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to close property list");
+            v->count_attr = 0;
+            return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to create the row count of a variable.");
         }
     }
+    if (H5Awrite(v->count_attr, H5T_NATIVE_UINT64, &rows) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to write the row count of a variable.");
+    }
+    return ISMRMRD_NOERROR;
+}
 
-    /* Select the last block */
-    offset[0] = hdfdims[0]-1;
-    filespace = H5Dget_space(dataset);
-    h5status  = H5Sselect_hyperslab (filespace, H5S_SELECT_SET, offset, NULL, ext_dims, NULL);
-    memspace = H5Screate_simple(rank, ext_dims, NULL);
-
-    free(hdfdims);
-    free(ext_dims);
-    free(offset);
-    free(maxdims);
-    free(chunk_dims);
+/* Re-reads the extent and row count of a variable another dataset on the file may have changed */
+static int refresh_variable(ISMRMRD_CachedVariable *v) {
+    hid_t dataspace;
 
-    /* Write it */
-    /* since this is a 1 element array we can just pass the pointer to the header */
-    h5status = H5Dwrite(dataset, datatype, memspace, filespace, H5P_DEFAULT, elem);
-    if (h5status < 0) {
+    dataspace = H5Dget_space(v->dataset);
+    if (dataspace < 0) {
         H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to write dataset");
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to get the extent of a variable.");
     }
-    
-    /* Clean up */
-    h5status = H5Sclose(dataspace);
-    if (h5status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close dataspace");
+    H5Sget_simple_extent_dims(dataspace, v->dims, NULL);
+    H5Sclose(dataspace);
+    if (v->count_attr > 0) {
+        H5Aclose(v->count_attr);
+        v->count_attr = 0;
     }
-    h5status = H5Sclose(filespace);
-    if (h5status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close filespace");
+    return load_row_count(v);
+}
+
+/* Shrinks a variable grown ahead of its rows to them and drops its count attribute */
+static int trim_dataset(hid_t dataset) {
+    hsize_t dims[ISMRMRD_NDARRAY_MAXDIM + 1];
+    hid_t dataspace, attr;
+    uint64_t rows;
+    htri_t exists;
+
+    exists = H5Aexists(dataset, ISMRMRD_COUNT_ATTRIBUTE);
+    if (exists == 0) {
+        /* exact already */
+        return ISMRMRD_NOERROR;
     }
-    h5status = H5Sclose(memspace);
-    if (h5status < 0) {
+    attr = exists > 0 ? H5Aopen(dataset, ISMRMRD_COUNT_ATTRIBUTE, H5P_DEFAULT) : -1;
+    if (attr < 0 || H5Aread(attr, H5T_NATIVE_UINT64, &rows) < 0) {
         H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close memspace");
+        if (attr > 0) {
+            H5Aclose(attr);
+        }
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to read the row count of a variable.");
     }
-    h5status = H5Dclose(dataset);
-    if (h5status < 0) {
+    H5Aclose(attr);
+    dataspace = H5Dget_space(dataset);
+    H5Sget_simple_extent_dims(dataspace, dims, NULL);
+    H5Sclose(dataspace);
+    if (rows < dims[0]) {
+        dims[0] = rows;
+        if (H5Dset_extent(dataset, dims) < 0) {
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to trim dataset.");
+        }
+    }
+    if (H5Adelete(dataset, ISMRMRD_COUNT_ATTRIBUTE) < 0) {
         H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close dataset");
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to delete the row count of a variable.");
     }
-
     return ISMRMRD_NOERROR;
 }
 
-static int get_array_properties(const ISMRMRD_Dataset *dset, const char *path,
-                         uint16_t *ndim, size_t dims[ISMRMRD_NDARRAY_MAXDIM],
-                         uint16_t *data_type)
-{
-    hid_t dataset, filespace, hdf5type;
-    hsize_t *hdfdims = NULL;
-    herr_t h5status = 0;
-    int rank, n;
-    
-    if (NULL == dset) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+/* Trims the open variables this dataset grew ahead of their rows */
+static int trim_variables(const ISMRMRD_Dataset *dset) {
+    ISMRMRD_CachedVariable *v;
+    int status = ISMRMRD_NOERROR;
+    size_t i;
+
+    for (i = 0; i < dset->cache->num_vars; i++) {
+        v = dset->cache->vars[i];
+        if (!v->grown) {
+            continue;
+        }
+        if (v->count_attr > 0) {
+            H5Aclose(v->count_attr);
+            v->count_attr = 0;
+        }
+        if (trim_dataset(v->dataset) != ISMRMRD_NOERROR || refresh_variable(v) != ISMRMRD_NOERROR) {
+            status = ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to trim a variable.");
+            continue;
+        }
+        v->grown = false;
     }
+    return status;
+}
 
-    /* Check path existence */
+/* Returns the cached variable, opening it if it exists in the file, or NULL if it does not */
+static ISMRMRD_CachedVariable * open_variable(const ISMRMRD_Dataset *dset, const char *var, const char *sub) {
+    ISMRMRD_CachedVariable *v;
+    hid_t dataset, dataspace;
+    hsize_t dims[ISMRMRD_NDARRAY_MAXDIM + 1];
+    int rank;
+    char *path;
+
+    if (dset->cache == NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open.");
+        return NULL;
+    }
+
+    v = find_variable(dset, var, sub);
+    if (v != NULL) {
+        return v;
+    }
+
+    path = make_var_path(dset, var, sub);
+    if (path == NULL) {
+        return NULL;
+    }
     if (!link_exists(dset, path)) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Path to element not found.");
+        free(path);
+        return NULL;
     }
 
-    /* open dataset */
-    dataset = H5Dopen2(dset->fileid, path, H5P_DEFAULT);
+    dataset = H5Dopen2(dset->fileid, path, dset->cache->dataset_access);
+    if (dataset < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open dataset.");
+        free(path);
+        return NULL;
+    }
+    dataspace = H5Dget_space(dataset);
+    rank = H5Sget_simple_extent_ndims(dataspace);
+    if (rank < 1 || rank > ISMRMRD_NDARRAY_MAXDIM + 1) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Unsupported dataset rank.");
+        H5Sclose(dataspace);
+        H5Dclose(dataset);
+        free(path);
+        return NULL;
+    }
+    H5Sget_simple_extent_dims(dataspace, dims, NULL);
+    H5Sclose(dataspace);
 
-    /* get the data type */
-    hdf5type = H5Dget_type(dataset);
+    v = add_variable(dset, path, dataset, rank, dims);
+    if (v != NULL && load_row_count(v) != ISMRMRD_NOERROR) {
+        forget_variable(dset, var, sub);
+        return NULL;
+    }
+    return v;
+}
 
-    /* get the file space */
-    filespace = H5Dget_space(dataset);
 
-    /* get the rank */
-    rank = H5Sget_simple_extent_ndims(filespace);
+/* Sets the file format, metadata blocks, alignment and sieve buffer on a file access property list */
+static int set_file_access(const ISMRMRD_Dataset *dset, hid_t fapl) {
+    H5F_libver_t low = H5F_LIBVER_EARLIEST;
+    herr_t h5status = 0;
 
-    /* get the dimensions */
-    hdfdims = (hsize_t *)malloc(rank * sizeof(*hdfdims));
-    h5status = H5Sget_simple_extent_dims(filespace, hdfdims, NULL);
-    
-    /* set the return values - permute dimensions */
-    *data_type = get_ndarray_data_type(hdf5type);
-    *ndim = rank;
-    for (n=0; n<rank; n++) {
-        dims[n] = hdfdims[rank-n-1];
+    if (dset->options.file_format == ISMRMRD_FORMAT_V18) {
+#if H5_VERSION_GE(1, 10, 2)
+        low = H5F_LIBVER_V18;
+#else
+        /* the 1.8 format is the latest one of HDF5 1.8 */
+        low = H5F_LIBVER_LATEST;
+#endif
     }
-    
-    /* clean up */
-    h5status = H5Tclose(hdf5type);
-    if (h5status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to close datatype.");
+    else if (dset->options.file_format == ISMRMRD_FORMAT_LATEST) {
+        low = H5F_LIBVER_LATEST;
     }
-    h5status = H5Sclose(filespace);
-    if (h5status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close filespace");
+    if (low != H5F_LIBVER_EARLIEST) {
+        h5status = H5Pset_libver_bounds(fapl, low, H5F_LIBVER_LATEST);
+    }
+    if (h5status >= 0 && dset->options.meta_block_size > 0) {
+        h5status = H5Pset_meta_block_size(fapl, dset->options.meta_block_size);
+    }
+    if (h5status >= 0 && dset->options.alignment > 0) {
+        h5status = H5Pset_alignment(fapl, dset->options.alignment_threshold, dset->options.alignment);
+    }
+    if (h5status >= 0 && dset->options.sieve_buf_size > 0) {
+        h5status = H5Pset_sieve_buf_size(fapl, dset->options.sieve_buf_size);
     }
-    h5status = H5Dclose(dataset);
     if (h5status < 0) {
         H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close dataset.");
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to set file access properties.");
     }
-
     return ISMRMRD_NOERROR;
+}
 
+#ifdef ISMRMRD_HAVE_PAGED_FILE_SPACE
+/* HDF5 does not combine the page buffer with SWMR access */
+static bool use_page_buffer(const ISMRMRD_Dataset *dset) {
+    return dset->options.page_buffer_size > 0 && dset->options.swmr == ISMRMRD_SWMR_OFF;
 }
-    
-int read_element(const ISMRMRD_Dataset *dset, const char *path, void *elem,
-                 const hid_t datatype, const uint32_t index)
+#endif
+
+/* Opens an existing file, with the page buffer if its file space is paged */
+static hid_t open_file(const ISMRMRD_Dataset *dset, unsigned flags, hid_t fapl) {
+#ifdef ISMRMRD_HAVE_PAGED_FILE_SPACE
+    hid_t fileid;
+
+    if (use_page_buffer(dset) && H5Pset_page_buffer_size(fapl, dset->options.page_buffer_size, 0, 0) >= 0) {
+        fileid = H5Fopen(dset->filename, flags, fapl);
+        H5Pset_page_buffer_size(fapl, 0, 0, 0);
+        if (fileid >= 0) {
+            return fileid;
+        }
+        /* HDF5 refuses a page buffer for files without paged file space */
+    }
+#endif
+    return H5Fopen(dset->filename, flags, fapl);
+}
+
+/* Creates a new file, with paged file space and the page buffer if the options ask for them */
+static hid_t create_file(const ISMRMRD_Dataset *dset, hid_t fapl) {
+    hid_t fileid, fcpl = H5P_DEFAULT;
+
+#ifdef ISMRMRD_HAVE_PAGED_FILE_SPACE
+    if (dset->options.file_space_page_size > 0) {
+        fcpl = H5Pcreate(H5P_FILE_CREATE);
+        if (H5Pset_file_space_strategy(fcpl, H5F_FSPACE_STRATEGY_PAGE, 0, 1) < 0 ||
+            H5Pset_file_space_page_size(fcpl, dset->options.file_space_page_size) < 0 ||
+            (use_page_buffer(dset) && H5Pset_page_buffer_size(fapl, dset->options.page_buffer_size, 0, 0) < 0)) {
+            H5Pclose(fcpl);
+            return -1;
+        }
+    }
+#endif
+    fileid = H5Fcreate(dset->filename, H5F_ACC_TRUNC, fcpl, fapl);
+    if (fcpl != H5P_DEFAULT) {
+        H5Pclose(fcpl);
+    }
+    return fileid;
+}
+
+/* Selects the core driver on a file access property list */
+static int set_core_driver(const ISMRMRD_Dataset *dset, hid_t fapl) {
+    size_t increment = dset->options.core_increment > 0 ? dset->options.core_increment : ISMRMRD_DEFAULT_CORE_INCREMENT;
+
+    if (H5Pset_fapl_core(fapl, increment, dset->options.core_backing_store != 0) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to set the core file driver.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+/* File access properties with the driver and file access tuning of a dataset, -1 on failure */
+static hid_t create_file_access(const ISMRMRD_Dataset *dset) {
+    hid_t fapl;
+
+    fapl = H5Pcreate(H5P_FILE_ACCESS);
+    if (fapl < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to create file access properties.");
+        return -1;
+    }
+    if ((dset->options.driver == ISMRMRD_DRIVER_CORE && set_core_driver(dset, fapl) != ISMRMRD_NOERROR) ||
+        (dset->options.driver == ISMRMRD_DRIVER_IO_URING &&
+         ismrmrd_set_fapl_io_uring(fapl, dset->options.uring_queue_depth, dset->options.direct_io_size) != ISMRMRD_NOERROR) ||
+        set_file_access(dset, fapl) != ISMRMRD_NOERROR) {
+        H5Pclose(fapl);
+        ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to set file access properties.");
+        return -1;
+    }
+    return fapl;
+}
+
+#ifdef ISMRMRD_HAVE_SWMR
+/*
+ * Reopens a file in ISMRMRD_SWMR_READ mode, with the access properties it was opened with.
+ *
+ * Refreshing a variable leaves stale global heap blocks and a stale end of
+ * file in the metadata cache, reopening the file drops them.
+ */
+static int reopen_swmr_read(ISMRMRD_Dataset *dset) {
+    hid_t fileid, fapl;
+
+    fapl = create_file_access(dset);
+    if (fapl < 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to reopen file for SWMR reading.");
+    }
+    close_variables(dset->cache);
+    H5Fclose(dset->fileid);
+    fileid = open_file(dset, H5F_ACC_RDONLY | H5F_ACC_SWMR_READ, fapl);
+    H5Pclose(fapl);
+    if (fileid < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        dset->fileid = 0;
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to reopen file for SWMR reading.");
+    }
+    dset->fileid = fileid;
+    return ISMRMRD_NOERROR;
+}
+
+/* Reads the committed acquisition count, false if the writer did not record one */
+static bool read_swmr_committed(const ISMRMRD_Dataset *dset, uint32_t *rows)
+{
+    ISMRMRD_CachedVariable *v;
+
+    v = open_variable(dset, "data_committed", NULL);
+    if (v == NULL) {
+        return false;
+    }
+    if (H5Drefresh(v->dataset) < 0 ||
+        H5Dread(v->dataset, H5T_NATIVE_UINT32, H5S_ALL, H5S_ALL, H5P_DEFAULT, rows) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to read committed acquisition count.");
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Catches a SWMR reader up with the writer.
+ *
+ * reopen also reopens the file if no rows were committed since the last
+ * refresh, for reads of committed rows that ran into a stale end of file.
+ */
+static int refresh_swmr_read(ISMRMRD_Dataset *dset, const bool reopen)
+{
+    ISMRMRD_CachedVariable *v;
+    hid_t dataspace;
+    uint32_t rows;
+    size_t i;
+    int status;
+
+    if (!read_swmr_committed(dset, &rows)) {
+        if (reopen) {
+            return reopen_swmr_read(dset);
+        }
+        /* Not streamed by this library, refreshing the extents is the best we can do */
+        for (i = 0; i < dset->cache->num_vars; i++) {
+            v = dset->cache->vars[i];
+            if (H5Drefresh(v->dataset) < 0) {
+                H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+                return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to refresh dataset.");
+            }
+            dataspace = H5Dget_space(v->dataset);
+            H5Sget_simple_extent_dims(dataspace, v->dims, NULL);
+            H5Sclose(dataspace);
+            status = load_row_count(v);
+            if (status != ISMRMRD_NOERROR) {
+                return status;
+            }
+        }
+        return ISMRMRD_NOERROR;
+    }
+    if (rows == dset->cache->swmr_committed && !reopen) {
+        return ISMRMRD_NOERROR;
+    }
+
+    status = reopen_swmr_read(dset);
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to refresh dataset.");
+    }
+    dset->cache->swmr_committed = rows;
+    return ISMRMRD_NOERROR;
+}
+#endif
+
+static int delete_var(const ISMRMRD_Dataset *dset, const char *var) {
+    int status = ISMRMRD_NOERROR;
+    herr_t h5status;
+    char *path = NULL;
+
+    if (NULL == dset) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
+    }
+
+    forget_variable(dset, var, NULL);
+
+    path = make_path(dset, var);
+    if (link_exists(dset, path)) {
+        h5status = H5Ldelete(dset->fileid, path, H5P_DEFAULT);
+        if (h5status < 0) {
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            status = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to delete H5 path");
+        }
+    }
+    free(path);
+    return status;
+}
+
+static uint16_t get_ndarray_data_type(const ISMRMRD_Dataset *dset, hid_t hdf5type) {
+
+    uint16_t dtype = 0;
+    int n;
+
+    for (n = ISMRMRD_USHORT; n <= ISMRMRD_CXDOUBLE; n++) {
+        if (H5Tequal(hdf5type, dset->cache->ndarray_types[n]) > 0) {
+            dtype = (uint16_t) n;
+            break;
+        }
+    }
+
+    if (dtype == 0) {
+        //ISMRMRD_PUSH_ERR(ISMRMRD_TYPEERROR, "Failed to get data type from HDF5 data type.");
+    }
+
+    return dtype;
+}
+
+static uint32_t get_number_of_elements(const ISMRMRD_Dataset *dset, const char *var, const char *sub)
+{
+    ISMRMRD_CachedVariable *v;
+
+    if (NULL == dset) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
+        return 0;
+    }
+
+    v = open_variable(dset, var, sub);
+    if (v == NULL) {
+        /* none */
+        return 0;
+    }
+    return (uint32_t) v->dims[0];
+}
+
+/* Extent of the append dimension for a variable that needs rows rows, see ISMRMRD_ExtentGrowth */
+static hsize_t grow_extent(const ISMRMRD_Dataset *dset, hsize_t allocated, hsize_t rows)
+{
+    hsize_t block;
+
+    if (dset->options.swmr != ISMRMRD_SWMR_OFF) {
+        /* SWMR readers take the extent as the number of rows */
+        return rows;
+    }
+    switch (dset->options.extent_growth) {
+    case ISMRMRD_GROWTH_GEOMETRIC:
+        return 2 * allocated > rows ? 2 * allocated : rows;
+    case ISMRMRD_GROWTH_BLOCKS:
+        block = dset->options.extent_block_rows > 0 ? dset->options.extent_block_rows : ISMRMRD_DEFAULT_EXTENT_BLOCK_ROWS;
+        return (rows + block - 1) / block * block;
+    default:
+        return rows;
+    }
+}
+
+/* Rows per chunk for a new variable, 0 rows sizes the chunk from the element size */
+static hsize_t get_chunk_rows(const ISMRMRD_Dataset *dset, uint32_t rows, const hid_t datatype,
+                              const uint16_t ndim, const size_t *dims)
+{
+    /* HDF5 limits a chunk to 4 GB */
+    const size_t max_chunk_size = 0xFFFFFFFFu;
+    size_t element_size;
+    int n;
+
+    element_size = H5Tget_size(datatype);
+    for (n = 0; n < ndim; n++) {
+        element_size *= dims[n];
+    }
+    if (element_size == 0) {
+        return 1;
+    }
+    if (rows == 0) {
+        rows = (uint32_t) (dset->options.chunk_size / element_size);
+    }
+    if (rows > max_chunk_size / element_size) {
+        rows = (uint32_t) (max_chunk_size / element_size);
+    }
+    return rows > 0 ? rows : 1;
+}
+
+/* Adds the filters of compression to the creation properties of a variable of datatype */
+static int set_compression(hid_t props, const hid_t datatype, const ISMRMRD_CompressionOptions *compression)
+{
+    htri_t vlen;
+
+    if (compression == NULL) {
+        return ISMRMRD_NOERROR;
+    }
+    if (compression->filter_num_params > ISMRMRD_MAX_FILTER_PARAMS) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Too many compression filter parameters.");
+    }
+    if (compression->deflate_level < 0 || compression->deflate_level > 9) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Deflate level should be between 0 and 9.");
+    }
+    /* variable length members live in the global heap, only the references would be compressed */
+    vlen = H5Tdetect_class(datatype, H5T_VLEN);
+    if (vlen != 0 || (H5Tget_class(datatype) == H5T_STRING && H5Tis_variable_str(datatype) > 0)) {
+        return ISMRMRD_NOERROR;
+    }
+
+    if (compression->shuffle && H5Pset_shuffle(props) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to set shuffle filter.");
+    }
+    if (compression->filter_id != 0) {
+        if (H5Zfilter_avail((H5Z_filter_t) compression->filter_id) <= 0) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Compression filter is not registered.");
+        }
+        if (H5Pset_filter(props, (H5Z_filter_t) compression->filter_id, H5Z_FLAG_OPTIONAL,
+                          compression->filter_num_params, compression->filter_params) < 0) {
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to set compression filter.");
+        }
+    }
+    if (compression->deflate_level > 0 && H5Pset_deflate(props, (unsigned) compression->deflate_level) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to set deflate filter.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+/* Creates an empty extensible variable with elements of shape dims, compression may be NULL */
+static ISMRMRD_CachedVariable * create_variable(const ISMRMRD_Dataset * dset, const char *var, const char *sub,
+        const hid_t datatype, const uint16_t ndim, const size_t *dims, const uint32_t chunk_rows,
+        const ISMRMRD_CompressionOptions *compression)
+{
+    hid_t dataset, dataspace, props;
+    hsize_t hdfdims[ISMRMRD_NDARRAY_MAXDIM + 1], maxdims[ISMRMRD_NDARRAY_MAXDIM + 1];
+    hsize_t chunk_dims[ISMRMRD_NDARRAY_MAXDIM + 1];
+    int n = 0, rank = ndim + 1;
+    char *path;
+
+    hdfdims[0] = 0;
+    maxdims[0] = H5S_UNLIMITED;
+    chunk_dims[0] = get_chunk_rows(dset, chunk_rows, datatype, ndim, dims);
+    for (n = 0; n < ndim; n++) {
+        hdfdims[n + 1] = dims[n];
+        maxdims[n + 1] = dims[n];
+        chunk_dims[n + 1] = dims[n];
+    }
+    props = H5Pcreate(H5P_DATASET_CREATE);
+    /* enable chunking so that the dataset is extensible */
+    H5Pset_chunk (props, rank, chunk_dims);
+    if (set_compression(props, datatype, compression) != ISMRMRD_NOERROR) {
+        H5Pclose(props);
+        return NULL;
+    }
+    path = make_var_path(dset, var, sub);
+    if (path == NULL) {
+        H5Pclose(props);
+        ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to make variable path");
+        return NULL;
+    }
+    dataspace = H5Screate_simple(rank, hdfdims, maxdims);
+    /* create */
+    dataset = H5Dcreate2(dset->fileid, path, datatype, dataspace, H5P_DEFAULT, props, dset->cache->dataset_access);
+    H5Sclose(dataspace);
+    H5Pclose(props);
+    if (dataset < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        free(path);
+        ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to create dataset");
+        return NULL;
+    }
+    return add_variable(dset, path, dataset, rank, hdfdims);
+}
+
+/*
+ * Files opened by datasets, keyed by canonical path.
+ *
+ * Datasets on the same file, e.g. the groups of a multi-measurement file,
+ * share one HDF5 file handle and with it one metadata cache. The last dataset
+ * to close the file trims the variables grown ahead of their rows by any of
+ * them and closes the handle. A dataset asking for other file access options
+ * than the dataset that opened the file fails to open. The lock guards the
+ * list and its entries and is never held while HDF5 opens or creates a file.
+ */
+typedef struct ISMRMRD_OpenFile {
+    char *path;
+    hid_t fileid;
+    ISMRMRD_DatasetOptions options;    /* options of the dataset that opened the file */
+    unsigned int refs;                 /* datasets using the handle */
+    bool shared;                       /* another dataset used the handle, the variable caches can be stale */
+    char **grown;                      /* variables grown by datasets that closed the file before the last */
+    size_t num_grown;
+    struct ISMRMRD_OpenFile *next;
+} ISMRMRD_OpenFile;
+
+static ISMRMRD_OpenFile *open_files = NULL;
+static ISMRMRD_Lock open_files_lock = ISMRMRD_LOCK_INITIALIZER;
+
+/* Whether other datasets used the file handle of a dataset since it was opened */
+static bool file_is_shared(const ISMRMRD_Dataset *dset) {
+    ISMRMRD_OpenFile *f;
+    bool shared;
+
+    ISMRMRD_LOCK(&open_files_lock);
+    for (f = open_files; f != NULL && f->fileid != dset->fileid; f = f->next) {
+    }
+    shared = f != NULL && f->shared;
+    ISMRMRD_UNLOCK(&open_files_lock);
+    return shared;
+}
+
+static int append_elements(const ISMRMRD_Dataset * dset, const char *var, const char *sub,
+        void * elems, const hid_t datatype,
+        const uint16_t ndim, const size_t *dims, const uint32_t count, const uint32_t chunk_rows,
+        const ISMRMRD_CompressionOptions *compression)
+{
+    ISMRMRD_CachedVariable *v;
+    hid_t filespace, memspace;
+    herr_t h5status = 0;
+    hsize_t hdfdims[ISMRMRD_NDARRAY_MAXDIM + 1], ext_dims[ISMRMRD_NDARRAY_MAXDIM + 1];
+    hsize_t offset[ISMRMRD_NDARRAY_MAXDIM + 1];
+    int n = 0, rank = ndim + 1;
+
+    if (NULL == dset) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
+    }
+    if (ndim > ISMRMRD_NDARRAY_MAXDIM) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Too many dimensions.");
+    }
+    if (count == 0) {
+        return ISMRMRD_NOERROR;
+    }
+
+    /* Open the existing dataset or create it */
+    v = open_variable(dset, var, sub);
+    if (v == NULL) {
+        v = create_variable(dset, var, sub, datatype, ndim, dims, chunk_rows, compression);
+        if (v == NULL) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to create dataset");
+        }
+    }
+    if (v->rank != rank) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dimensions are incorrect.");
+    }
+    for (n = 0; n<ndim; n++) {
+        if (dims[n] != v->dims[n+1]) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Dimensions are incorrect.");
+        }
+    }
+
+    /* another dataset on the file may have appended or trimmed since the last append */
+    if (file_is_shared(dset) && refresh_variable(v) != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read the extent of a variable.");
+    }
+
+    /* extend it unless it was grown ahead of count rows */
+    if (v->dims[0] + count > v->allocated) {
+        for (n = 0; n < rank; n++) {
+            hdfdims[n] = v->dims[n];
+        }
+        hdfdims[0] = grow_extent(dset, v->allocated, v->dims[0] + count);
+        h5status = H5Dset_extent(v->dataset, hdfdims);
+        if (h5status < 0) {
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to extend dataset");
+        }
+        v->allocated = hdfdims[0];
+        if (v->allocated > v->dims[0] + count) {
+            v->grown = true;
+        }
+    }
+
+    /* Select the block after the last row */
+    offset[0] = v->dims[0];
+    ext_dims[0] = count;
+    for (n = 0; n < ndim; n++) {
+        offset[n + 1] = 0;
+        ext_dims[n + 1] = dims[n];
+    }
+    filespace = H5Dget_space(v->dataset);
+    h5status  = H5Sselect_hyperslab (filespace, H5S_SELECT_SET, offset, NULL, ext_dims, NULL);
+    memspace = H5Screate_simple(rank, ext_dims, NULL);
+
+    /* Write it */
+    /* the elements are contiguous in memory so the whole block goes in one write */
+    h5status = H5Dwrite(v->dataset, datatype, memspace, filespace, H5P_DEFAULT, elems);
+    if (h5status < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        H5Sclose(filespace);
+        H5Sclose(memspace);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to write dataset");
+    }
+    v->dims[0] += count;
+
+    /* Clean up */
+    h5status = H5Sclose(filespace);
+    if (h5status < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close filespace");
+    }
+    h5status = H5Sclose(memspace);
+    if (h5status < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close memspace");
+    }
+
+    /* written after the rows, so it never covers unwritten rows */
+    return store_row_count(v);
+}
+
+static int append_element(const ISMRMRD_Dataset * dset, const char *var, const char *sub,
+        void * elem, const hid_t datatype,
+        const uint16_t ndim, const size_t *dims, const uint32_t chunk_rows,
+        const ISMRMRD_CompressionOptions *compression)
+{
+    return append_elements(dset, var, sub, elem, datatype, ndim, dims, 1, chunk_rows, compression);
+}
+
+static int get_array_properties(const ISMRMRD_Dataset *dset, const char *var, const char *sub,
+                         uint16_t *ndim, size_t dims[ISMRMRD_NDARRAY_MAXDIM],
+                         uint16_t *data_type)
+{
+    ISMRMRD_CachedVariable *v;
+    hid_t hdf5type;
+    int n;
+
+    if (NULL == dset) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+
+    /* Check path existence */
+    v = open_variable(dset, var, sub);
+    if (v == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Path to element not found.");
+    }
+
+    /* look up the data type once per session */
+    if (v->data_type == 0) {
+        hdf5type = H5Dget_type(v->dataset);
+        v->data_type = get_ndarray_data_type(dset, hdf5type);
+        if (H5Tclose(hdf5type) < 0) {
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to close datatype.");
+        }
+    }
+
+    /* set the return values - permute dimensions, leaving out the append dimension */
+    *data_type = v->data_type;
+    *ndim = v->rank - 1;
+    for (n=0; n<v->rank-1; n++) {
+        dims[n] = v->dims[v->rank-n-1];
+    }
+
+    return ISMRMRD_NOERROR;
+}
+
+/*
+ * Lends the payload buffers of the acquisitions being read to HDF5 as the
+ * memory of the variable length traj and data sequences. A sequence takes the
+ * next traj or data buffer of the same size, in whichever order HDF5 converts
+ * the members, or a new buffer if none fits. The caller then gives every
+ * acquisition the buffers its sequences were read into.
+ */
+typedef struct ISMRMRD_PayloadTarget {
+    ISMRMRD_Acquisition *acqs;
+    uint32_t count;
+    uint32_t next_traj;         /* next acquisition whose traj buffer may be lent */
+    uint32_t next_data;         /* next acquisition whose data buffer may be lent */
+} ISMRMRD_PayloadTarget;
+
+/* Skips the acquisitions without a buffer to lend, returns the size of the next one or 0 */
+static size_t next_payload_buffer(const ISMRMRD_PayloadTarget *target, bool data, uint32_t *next)
+{
+    size_t size;
+
+    for (; *next < target->count; (*next)++) {
+        if (data) {
+            size = ismrmrd_size_of_acquisition_data(&target->acqs[*next]);
+            if (size > 0 && target->acqs[*next].data != NULL) {
+                return size;
+            }
+        } else {
+            size = ismrmrd_size_of_acquisition_traj(&target->acqs[*next]);
+            if (size > 0 && target->acqs[*next].traj != NULL) {
+                return size;
+            }
+        }
+    }
+    return 0;
+}
+
+static void * payload_target_alloc(size_t size, void *info)
+{
+    ISMRMRD_PayloadTarget *target = (ISMRMRD_PayloadTarget *) info;
+
+    if (size > 0 && next_payload_buffer(target, false, &target->next_traj) == size) {
+        return target->acqs[target->next_traj++].traj;
+    }
+    if (size > 0 && next_payload_buffer(target, true, &target->next_data) == size) {
+        return target->acqs[target->next_data++].data;
+    }
+    return ismrmrd_malloc(size);
+}
+
+static void payload_target_free(void *p, void *info)
+{
+    ISMRMRD_PayloadTarget *target = (ISMRMRD_PayloadTarget *) info;
+    uint32_t n;
+
+    /* only called if the read fails, the acquisitions keep their buffers */
+    for (n = 0; n < target->count; n++) {
+        if (p == target->acqs[n].traj || p == target->acqs[n].data) {
+            return;
+        }
+    }
+    ismrmrd_free(p);
+}
+
+#ifdef ISMRMRD_HAVE_SWMR
+static herr_t walk_end_of_file_errors(unsigned int n, const H5E_error2_t *desc, void *client_data)
+{
+    unsigned int *found = (unsigned int *) client_data;
+
+    (void)n;
+    if (desc->maj_num == H5E_HEAP && desc->min_num == H5E_CANTPROTECT) {
+        *found |= 1;
+    }
+    else if (desc->maj_num == H5E_CACHE && desc->min_num == H5E_BADVALUE) {
+        *found |= 2;
+    }
+    return 0;
+}
+
+/* True if a failed read loaded a global heap block ending past the end of file known to the reader */
+static bool read_past_end_of_file(void)
+{
+    unsigned int found = 0;
+
+    H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_end_of_file_errors, &found);
+    return found == 3;
+}
+#endif
+
+/* Reads count elements from start, target may be NULL or receives the variable length payloads */
+static int read_elements_into(const ISMRMRD_Dataset *dset, const char *var, const char *sub, void *elems,
+                              const hid_t datatype, const uint32_t start, const uint32_t count,
+                              ISMRMRD_PayloadTarget *target)
+{
+    ISMRMRD_CachedVariable *v;
+    hid_t filespace, memspace, xfer = H5P_DEFAULT;
+    hsize_t offset[ISMRMRD_NDARRAY_MAXDIM + 1], hdfcount[ISMRMRD_NDARRAY_MAXDIM + 1];
+    herr_t h5status = 0;
+    int n;
+
+    if (NULL == dset) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+
+    /* Check path existence */
+    v = open_variable(dset, var, sub);
+    if (v == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Path to element not found.");
+    }
+
+    if ((hsize_t)start + count > v->dims[0]) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Index out of range.");
+    }
+
+    offset[0] = start;
+    hdfcount[0] = count;
+    for (n=1; n< v->rank; n++) {
+        offset[n] = 0;
+        hdfcount[n] = v->dims[n];
+    }
+
+    /* TODO check that the dataset's datatype is correct */
+    filespace = H5Dget_space(v->dataset);
+    h5status = H5Sselect_hyperslab(filespace, H5S_SELECT_SET, offset, NULL, hdfcount, NULL);
+
+    /* create space for the whole block */
+    memspace = H5Screate_simple(v->rank, hdfcount, NULL);
+
+    if (target != NULL) {
+        xfer = dset->cache->payload_transfer;
+        H5Pset_vlen_mem_manager(xfer, payload_target_alloc, target, payload_target_free, target);
+        target->next_traj = 0;
+        target->next_data = 0;
+    }
+    h5status = H5Dread(v->dataset, datatype, memspace, filespace, xfer, elems);
+#ifdef ISMRMRD_HAVE_SWMR
+    /* The writer can grow a heap block holding committed payloads after the
+       reader opened the file, the block then ends past the end of file known
+       to the reader until it reopens the file */
+    if (h5status < 0 && dset->options.swmr == ISMRMRD_SWMR_READ && read_past_end_of_file()) {
+        H5Eclear2(H5E_DEFAULT);
+        H5Sclose(filespace);
+        /* the file handle is session state like the cache */
+        if (refresh_swmr_read((ISMRMRD_Dataset *) dset, true) != ISMRMRD_NOERROR ||
+            (v = open_variable(dset, var, sub)) == NULL) {
+            H5Sclose(memspace);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to reopen file for SWMR reading.");
+        }
+        filespace = H5Dget_space(v->dataset);
+        H5Sselect_hyperslab(filespace, H5S_SELECT_SET, offset, NULL, hdfcount, NULL);
+        if (target != NULL) {
+            target->next_traj = 0;
+            target->next_data = 0;
+        }
+        h5status = H5Dread(v->dataset, datatype, memspace, filespace, xfer, elems);
+    }
+#endif
+    if (h5status < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        H5Sclose(filespace);
+        H5Sclose(memspace);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to read from dataset.");
+    }
+
+    h5status = H5Sclose(filespace);
+    if (h5status < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close filespace.");
+    }
+    h5status = H5Sclose(memspace);
+    if (h5status < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close memspace.");
+    }
+
+    return ISMRMRD_NOERROR;
+}
+
+static int read_elements(const ISMRMRD_Dataset *dset, const char *var, const char *sub, void *elems,
+                         const hid_t datatype, const uint32_t start, const uint32_t count)
+{
+    return read_elements_into(dset, var, sub, elems, datatype, start, count, NULL);
+}
+
+static int read_element(const ISMRMRD_Dataset *dset, const char *var, const char *sub, void *elem,
+                        const hid_t datatype, const uint32_t index)
+{
+    return read_elements(dset, var, sub, elem, datatype, index, 1);
+}
+
+/* Acquisition storage layouts, see ISMRMRD_AcquisitionLayouts */
+
+/* The layout of the acquisitions in the file, -1 if there are none yet */
+static int get_acquisition_layout(const ISMRMRD_Dataset *dset)
+{
+    char *path;
+    int layout = -1;
+
+    if (dset->cache->acquisition_layout >= 0) {
+        return dset->cache->acquisition_layout;
+    }
+    path = make_var_path(dset, "acquisitions", "header");
+    if (path != NULL && link_exists(dset, path)) {
+        layout = ISMRMRD_LAYOUT_FLAT;
+    }
+    free(path);
+    if (layout < 0) {
+        path = make_path(dset, "data");
+        if (path != NULL && link_exists(dset, path)) {
+            layout = ISMRMRD_LAYOUT_VLEN;
+        }
+        free(path);
+    }
+    dset->cache->acquisition_layout = layout;
+    return layout;
+}
+
+static uint32_t get_number_of_stored_acquisitions(const ISMRMRD_Dataset *dset)
+{
+    if (get_acquisition_layout(dset) == ISMRMRD_LAYOUT_FLAT) {
+        return get_number_of_elements(dset, "acquisitions", "header");
+    }
+    return get_number_of_elements(dset, "data", NULL);
+}
+
+/* Reads the flags and counters of count acquisitions */
+static int read_acquisition_index_entries(const ISMRMRD_Dataset *dset, HDF5_AcquisitionIndexEntry *entries,
+                                          uint32_t start, uint32_t count)
+{
+    if (get_acquisition_layout(dset) == ISMRMRD_LAYOUT_FLAT) {
+        /* the members are picked from the header table by name */
+        return read_elements(dset, "acquisitions", "header", entries, dset->cache->acquisition_index_type,
+                             start, count);
+    }
+    return read_elements(dset, "data", NULL, entries, dset->cache->acquisition_index_source_type, start, count);
+}
+
+/* Whether acquisitions with this header can be stored in the flat layout */
+static bool is_flat_shape(const ISMRMRD_AcquisitionHeader *head)
+{
+    return head->number_of_samples > 0 && head->active_channels > 0;
+}
+
+static bool is_same_shape(const ISMRMRD_AcquisitionHeader *a, const ISMRMRD_AcquisitionHeader *b)
+{
+    return a->number_of_samples == b->number_of_samples && a->active_channels == b->active_channels &&
+           a->trajectory_dimensions == b->trajectory_dimensions;
+}
+
+/* Whether n acquisitions can be appended to the flat layout, or start it if there is none */
+static bool fits_flat_layout(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acqs, uint32_t n)
+{
+    ISMRMRD_AcquisitionHeader shape;
+    ISMRMRD_CachedVariable *v;
+    uint32_t i;
+
+    shape = acqs[0].head;
+    v = open_variable(dset, "acquisitions", "data");
+    if (v != NULL) {
+        shape.active_channels = (uint16_t) v->dims[1];
+        shape.number_of_samples = (uint16_t) v->dims[2];
+        v = open_variable(dset, "acquisitions", "traj");
+        shape.trajectory_dimensions = v != NULL ? (uint16_t) v->dims[2] : 0;
+    }
+    if (!is_flat_shape(&shape)) {
+        return false;
+    }
+    for (i = 0; i < n; i++) {
+        if (!is_same_shape(&acqs[i].head, &shape)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Creates the empty flat layout variables for acquisitions shaped like head */
+static int create_flat_acquisitions(const ISMRMRD_Dataset *dset, const ISMRMRD_AcquisitionHeader *head)
+{
+    size_t dims[2];
+    char *path;
+
+    path = make_path(dset, "acquisitions");
+    if (path == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to make variable path");
+    }
+    create_link(dset, path);
+    free(path);
+
+    if (create_variable(dset, "acquisitions", "header", dset->cache->acquisition_header_type, 0, NULL,
+                        dset->options.acquisition_chunk_rows, &dset->options.acquisition_compression) == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to create acquisition header table.");
+    }
+    /* the payload chunks are sized by chunk_size, a row can be large */
+    dims[0] = head->active_channels;
+    dims[1] = head->number_of_samples;
+    if (create_variable(dset, "acquisitions", "data", dset->cache->ndarray_types[ISMRMRD_CXFLOAT], 2, dims,
+                        0, &dset->options.acquisition_compression) == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to create acquisition data array.");
+    }
+    if (head->trajectory_dimensions > 0) {
+        dims[0] = head->number_of_samples;
+        dims[1] = head->trajectory_dimensions;
+        if (create_variable(dset, "acquisitions", "traj", dset->cache->ndarray_types[ISMRMRD_FLOAT], 2, dims,
+                            0, &dset->options.acquisition_compression) == NULL) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to create acquisition trajectory array.");
+        }
+    }
+    dset->cache->acquisition_layout = ISMRMRD_LAYOUT_FLAT;
+    return ISMRMRD_NOERROR;
+}
+
+/* Appends one payload array of n acquisitions, elem_size bytes each, gathered into one block */
+static int append_flat_payload(const ISMRMRD_Dataset *dset, const char *sub, const ISMRMRD_Acquisition *acqs,
+                               uint32_t n, size_t elem_size, hid_t datatype, const size_t *dims)
+{
+    char *block;
+    void *p;
+    uint32_t i;
+    int status;
+
+    if (n == 1) {
+        p = strcmp(sub, "data") == 0 ? (void *) acqs[0].data : (void *) acqs[0].traj;
+        return append_elements(dset, "acquisitions", sub, p, datatype, 2, dims, 1, 0, &dset->options.acquisition_compression);
+    }
+    block = (char *) malloc(n * elem_size);
+    if (block == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc acquisition write buffer.");
+    }
+    for (i = 0; i < n; i++) {
+        p = strcmp(sub, "data") == 0 ? (void *) acqs[i].data : (void *) acqs[i].traj;
+        memcpy(block + i * elem_size, p, elem_size);
+    }
+    status = append_elements(dset, "acquisitions", sub, block, datatype, 2, dims, n, 0, &dset->options.acquisition_compression);
+    free(block);
+    return status;
+}
+
+static int append_flat_acquisitions(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acqs, uint32_t n)
+{
+    const ISMRMRD_AcquisitionHeader *head = &acqs[0].head;
+    size_t dims[2];
+    int status;
+
+    if (open_variable(dset, "acquisitions", "header") == NULL) {
+        status = create_flat_acquisitions(dset, head);
+        if (status != ISMRMRD_NOERROR) {
+            return status;
+        }
+    }
+
+    /* The payloads go first so that the header table never has rows without payloads */
+    dims[0] = head->active_channels;
+    dims[1] = head->number_of_samples;
+    status = append_flat_payload(dset, "data", acqs, n, ismrmrd_size_of_acquisition_data(&acqs[0]),
+                                 dset->cache->ndarray_types[ISMRMRD_CXFLOAT], dims);
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append acquisition data.");
+    }
+    if (head->trajectory_dimensions > 0) {
+        dims[0] = head->number_of_samples;
+        dims[1] = head->trajectory_dimensions;
+        status = append_flat_payload(dset, "traj", acqs, n, ismrmrd_size_of_acquisition_traj(&acqs[0]),
+                                     dset->cache->ndarray_types[ISMRMRD_FLOAT], dims);
+        if (status != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append acquisition trajectory.");
+        }
+    }
+
+    /* The headers are written straight from the acquisition array */
+    status = append_elements(dset, "acquisitions", "header", (void *) acqs, dset->cache->acquisition_array_head_type,
+                             0, NULL, n, dset->options.acquisition_chunk_rows, &dset->options.acquisition_compression);
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append acquisition headers.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+/* Sets the header of an acquisition read from the file, the payload buffers are kept if the size is unchanged */
+static int reshape_acquisition(ISMRMRD_Acquisition *acq, const ISMRMRD_AcquisitionHeader *head)
+{
+    size_t traj_size, data_size;
+
+    traj_size = ismrmrd_size_of_acquisition_traj(acq);
+    data_size = ismrmrd_size_of_acquisition_data(acq);
+    acq->head = *head;
+    if ((traj_size == ismrmrd_size_of_acquisition_traj(acq) && (traj_size == 0 || acq->traj != NULL)) &&
+        (data_size == ismrmrd_size_of_acquisition_data(acq) && (data_size == 0 || acq->data != NULL))) {
+        if (acq->head.available_channels < acq->head.active_channels) {
+            acq->head.available_channels = acq->head.active_channels;
+        }
+        return ISMRMRD_NOERROR;
+    }
+    return ismrmrd_make_consistent_acquisition(acq);
+}
+
+/* Reads one payload array of count acquisitions and scatters it into the acquisitions */
+static int read_flat_payload(const ISMRMRD_Dataset *dset, const char *sub, ISMRMRD_Acquisition *acqs,
+                             uint32_t start, uint32_t count, size_t elem_size, hid_t datatype)
+{
+    char *block;
+    void *p;
+    uint32_t i;
+    int status;
+
+    if (count == 1) {
+        p = strcmp(sub, "data") == 0 ? (void *) acqs[0].data : (void *) acqs[0].traj;
+        return read_elements(dset, "acquisitions", sub, p, datatype, start, 1);
+    }
+    block = (char *) malloc(count * elem_size);
+    if (block == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc acquisition read buffer.");
+    }
+    status = read_elements(dset, "acquisitions", sub, block, datatype, start, count);
+    if (status == ISMRMRD_NOERROR) {
+        for (i = 0; i < count; i++) {
+            p = strcmp(sub, "data") == 0 ? (void *) acqs[i].data : (void *) acqs[i].traj;
+            memcpy(p, block + i * elem_size, elem_size);
+        }
+    }
+    free(block);
+    return status;
+}
+
+static int read_flat_acquisitions(const ISMRMRD_Dataset *dset, uint32_t start, uint32_t count,
+                                  ISMRMRD_Acquisition *acqs)
+{
+    ISMRMRD_AcquisitionHeader head[1], *heads;
+    uint32_t n;
+    int status;
+
+    /* Reading into the acquisition array directly would overwrite the payload pointers */
+    if (count == 1) {
+        heads = head;
+    } else {
+        heads = (ISMRMRD_AcquisitionHeader *) malloc(count * sizeof(ISMRMRD_AcquisitionHeader));
+        if (heads == NULL) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc acquisition header buffer.");
+        }
+    }
+    status = read_elements(dset, "acquisitions", "header", heads, dset->cache->acquisition_header_type,
+                           start, count);
+    for (n = 0; n < count && status == ISMRMRD_NOERROR; n++) {
+        if (!is_same_shape(&heads[n], &heads[0])) {
+            status = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Acquisition header does not match the flat layout.");
+            break;
+        }
+        status = reshape_acquisition(&acqs[n], &heads[n]);
+    }
+    if (heads != head) {
+        free(heads);
+    }
+    if (status != ISMRMRD_NOERROR) {
+        return status;
+    }
+
+    status = read_flat_payload(dset, "data", acqs, start, count, ismrmrd_size_of_acquisition_data(&acqs[0]),
+                               dset->cache->ndarray_types[ISMRMRD_CXFLOAT]);
+    if (status == ISMRMRD_NOERROR && acqs[0].head.trajectory_dimensions > 0) {
+        status = read_flat_payload(dset, "traj", acqs, start, count, ismrmrd_size_of_acquisition_traj(&acqs[0]),
+                                   dset->cache->ndarray_types[ISMRMRD_FLOAT]);
+    }
+    return status;
+}
+
+static int append_vlen_acquisitions(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acqs, uint32_t n)
+{
+    HDF5_Acquisition hdf5acq[1], *hdf5acqs;
+    uint32_t i;
+    int status;
+
+    /* A single acquisition does not need a heap buffer */
+    if (n == 1) {
+        hdf5acqs = hdf5acq;
+    } else {
+        hdf5acqs = (HDF5_Acquisition *) malloc(n * sizeof(HDF5_Acquisition));
+        if (hdf5acqs == NULL) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc acquisition write buffer.");
+        }
+    }
+
+    /* Create the HDF5 version of the acquisitions, the payloads are not copied */
+    for (i = 0; i < n; i++) {
+        hdf5acqs[i].head = acqs[i].head;
+        hdf5acqs[i].traj.len = acqs[i].head.number_of_samples * acqs[i].head.trajectory_dimensions;
+        hdf5acqs[i].traj.p = acqs[i].traj;
+        hdf5acqs[i].data.len = 2 * acqs[i].head.number_of_samples * acqs[i].head.active_channels;
+        hdf5acqs[i].data.p = acqs[i].data;
+    }
+
+    /* Grow the extent once and write the whole block */
+    status = append_elements(dset, "data", NULL, hdf5acqs, dset->cache->acquisition_type, 0, NULL, n,
+                             dset->options.acquisition_chunk_rows, NULL);
+    if (hdf5acqs != hdf5acq) {
+        free(hdf5acqs);
+    }
+    if (status == ISMRMRD_NOERROR) {
+        dset->cache->acquisition_layout = ISMRMRD_LAYOUT_VLEN;
+    }
+    return status;
+}
+
+/* Gives an acquisition the buffer a sequence was read into, old is freed unless it was lent */
+static void * adopt_payload_buffer(void *old, bool lent, const hvl_t *seq, size_t size)
+{
+    size_t len = seq->len * sizeof(float);
+    void *p = seq->p;
+
+    if (old != NULL && !lent) {
+        ismrmrd_free(old);
+    }
+    /* a header that does not match its payload still gets a buffer of the header's size */
+    if (size == 0) {
+        ismrmrd_free(p);
+        return NULL;
+    }
+    if (len != size) {
+        p = ismrmrd_realloc(p, size);
+        if (p != NULL && len < size) {
+            memset((char *) p + len, 0, size - len);
+        }
+    }
+    return p;
+}
+
+static int read_vlen_acquisitions(const ISMRMRD_Dataset *dset, uint32_t start, uint32_t count,
+                                  ISMRMRD_Acquisition *acqs)
+{
+    HDF5_Acquisition hdf5acq[1], *hdf5acqs;
+    ISMRMRD_PayloadTarget target;
+    bool traj_lent, data_lent;
+    uint32_t n;
+    int status;
+
+    /* A single acquisition does not need a heap buffer */
+    if (count == 1) {
+        hdf5acqs = hdf5acq;
+    } else {
+        hdf5acqs = (HDF5_Acquisition *) malloc(count * sizeof(HDF5_Acquisition));
+        if (hdf5acqs == NULL) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc acquisition read buffer.");
+        }
+    }
+
+    /* One hyperslab read for the whole range, the payloads go straight into the acquisitions' buffers */
+    target.acqs = acqs;
+    target.count = count;
+    status = read_elements_into(dset, "data", NULL, hdf5acqs, dset->cache->acquisition_type, start, count, &target);
+    if (status != ISMRMRD_NOERROR) {
+        if (hdf5acqs != hdf5acq) {
+            free(hdf5acqs);
+        }
+        return status;
+    }
+
+    /* The buffers lent before the cursors moved past them now hold other sequences */
+    for (n = 0; n < count; n++) {
+        traj_lent = n < target.next_traj && ismrmrd_size_of_acquisition_traj(&acqs[n]) > 0;
+        data_lent = n < target.next_data && ismrmrd_size_of_acquisition_data(&acqs[n]) > 0;
+        memcpy(&acqs[n].head, &hdf5acqs[n].head, sizeof(ISMRMRD_AcquisitionHeader));
+        if (acqs[n].head.available_channels < acqs[n].head.active_channels) {
+            acqs[n].head.available_channels = acqs[n].head.active_channels;
+        }
+        hdf5acqs[n].traj.p = adopt_payload_buffer(acqs[n].traj, traj_lent, &hdf5acqs[n].traj,
+                                                  ismrmrd_size_of_acquisition_traj(&acqs[n]));
+        hdf5acqs[n].data.p = adopt_payload_buffer(acqs[n].data, data_lent, &hdf5acqs[n].data,
+                                                  ismrmrd_size_of_acquisition_data(&acqs[n]));
+    }
+    /* a lent buffer may belong to a later acquisition, swap them in once all old buffers are accounted for */
+    for (n = 0; n < count; n++) {
+        acqs[n].traj = (float *) hdf5acqs[n].traj.p;
+        acqs[n].data = (complex_float_t *) hdf5acqs[n].data.p;
+        if ((acqs[n].traj == NULL && ismrmrd_size_of_acquisition_traj(&acqs[n]) > 0) ||
+            (acqs[n].data == NULL && ismrmrd_size_of_acquisition_data(&acqs[n]) > 0)) {
+            status = ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to realloc acquisition payload.");
+        }
+    }
+    if (hdf5acqs != hdf5acq) {
+        free(hdf5acqs);
+    }
+    return status;
+}
+
+/* Number of acquisitions moved at a time from the flat to the vlen layout */
+#define ISMRMRD_MIGRATE_BLOCK_ROWS 256
+
+/* Moves the acquisitions from the flat layout to the vlen layout, the file space is not reclaimed */
+static int migrate_to_vlen_layout(const ISMRMRD_Dataset *dset)
+{
+    ISMRMRD_Acquisition acqs[ISMRMRD_MIGRATE_BLOCK_ROWS];
+    uint32_t num_acqs, start, n, i;
+    int status = ISMRMRD_NOERROR;
+    char *path;
+
+    for (i = 0; i < ISMRMRD_MIGRATE_BLOCK_ROWS; i++) {
+        ismrmrd_init_acquisition(&acqs[i]);
+    }
+    num_acqs = get_number_of_elements(dset, "acquisitions", "header");
+    for (start = 0; start < num_acqs && status == ISMRMRD_NOERROR; start += n) {
+        n = num_acqs - start;
+        if (n > ISMRMRD_MIGRATE_BLOCK_ROWS) {
+            n = ISMRMRD_MIGRATE_BLOCK_ROWS;
+        }
+        status = read_flat_acquisitions(dset, start, n, acqs);
+        if (status == ISMRMRD_NOERROR) {
+            status = append_vlen_acquisitions(dset, acqs, n);
+        }
+    }
+    for (i = 0; i < ISMRMRD_MIGRATE_BLOCK_ROWS; i++) {
+        ismrmrd_cleanup_acquisition(&acqs[i]);
+    }
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to move acquisitions to the vlen layout.");
+    }
+
+    forget_variable(dset, "acquisitions", "header");
+    forget_variable(dset, "acquisitions", "data");
+    forget_variable(dset, "acquisitions", "traj");
+    path = make_path(dset, "acquisitions");
+    if (path == NULL || H5Ldelete(dset->fileid, path, H5P_DEFAULT) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        free(path);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to delete flat acquisitions.");
+    }
+    free(path);
+    dset->cache->acquisition_layout = ISMRMRD_LAYOUT_VLEN;
+    return ISMRMRD_NOERROR;
+}
+
+/* Picks the layout for appending n acquisitions, moving the file to the vlen layout if needed */
+static int prepare_acquisition_layout(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acqs, uint32_t n,
+                                      int *layout)
+{
+    int status;
+
+    *layout = get_acquisition_layout(dset);
+    if (*layout < 0) {
+        /* no acquisitions yet, the option decides */
+        *layout = dset->options.acquisition_layout;
+        if (*layout == ISMRMRD_LAYOUT_AUTO) {
+            *layout = fits_flat_layout(dset, acqs, n) ? ISMRMRD_LAYOUT_FLAT : ISMRMRD_LAYOUT_VLEN;
+        }
+    }
+    if (*layout != ISMRMRD_LAYOUT_FLAT || fits_flat_layout(dset, acqs, n)) {
+        return ISMRMRD_NOERROR;
+    }
+    if (dset->options.acquisition_layout != ISMRMRD_LAYOUT_AUTO) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Acquisition shape does not fit the flat layout.");
+    }
+    if (dset->cache->swmr_started) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Cannot change the acquisition layout while streaming.");
+    }
+    status = migrate_to_vlen_layout(dset);
+    *layout = ISMRMRD_LAYOUT_VLEN;
+    return status;
+}
+
+/* Number of index entries held in memory while building or querying the index */
+#define ISMRMRD_INDEX_BLOCK_ROWS 65536
+
+/* Variable of the acquisition index, reserved like data and data_committed */
+#define ISMRMRD_ACQUISITION_INDEX "acquisition_index"
+
+/* Whether this handle may create, extend or replace the acquisition index */
+static bool can_write_acquisition_index(const ISMRMRD_Dataset *dset)
+{
+    unsigned intent;
+
+    if (dset->options.swmr == ISMRMRD_SWMR_READ) {
+        return false;
+    }
+    if (H5Fget_intent(dset->fileid, &intent) < 0) {
+        H5Eclear2(H5E_DEFAULT);
+        return false;
+    }
+    if (!(intent & H5F_ACC_RDWR)) {
+        return false;
+    }
+    /* while streaming only an index created before streaming started can grow */
+    return !dset->cache->swmr_started || open_variable(dset, ISMRMRD_ACQUISITION_INDEX, NULL) != NULL;
+}
+
+/* Appends index entries for the acquisitions in the file that are not indexed yet */
+static int update_acquisition_index(const ISMRMRD_Dataset *dset)
 {
-    hid_t dataset, filespace, memspace;
-    hsize_t *hdfdims = NULL, *offset = NULL, *count = NULL;
-    herr_t h5status = 0;
-    int rank = 0;
-    int n;
+    HDF5_AcquisitionIndexEntry *entries;
+    uint32_t num_acqs, num_indexed, start, n;
+    int status = ISMRMRD_NOERROR;
 
-    if (NULL == dset) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    num_acqs = get_number_of_stored_acquisitions(dset);
+    num_indexed = get_number_of_elements(dset, ISMRMRD_ACQUISITION_INDEX, NULL);
+    if (num_indexed > num_acqs) {
+        /* stale index, e.g. the acquisitions were rewritten */
+        status = delete_var(dset, ISMRMRD_ACQUISITION_INDEX);
+        if (status != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to delete stale acquisition index.");
+        }
+        num_indexed = 0;
     }
-
-    /* Check path existence */
-    if (!link_exists(dset, path)) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Path to element not found.");
+    if (num_indexed == num_acqs) {
+        return ISMRMRD_NOERROR;
     }
 
-    /* open dataset */
-    dataset = H5Dopen2(dset->fileid, path, H5P_DEFAULT);
-
-    /* TODO check that the dataset's datatype is correct */
-    filespace = H5Dget_space(dataset);
+    n = num_acqs - num_indexed;
+    if (n > ISMRMRD_INDEX_BLOCK_ROWS) {
+        n = ISMRMRD_INDEX_BLOCK_ROWS;
+    }
+    entries = (HDF5_AcquisitionIndexEntry *) malloc(n * sizeof(HDF5_AcquisitionIndexEntry));
+    if (entries == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc acquisition index buffer.");
+    }
 
-    rank = H5Sget_simple_extent_ndims(filespace);
+    /* Only the flags and counters are read from the acquisitions */
+    for (start = num_indexed; start < num_acqs; start += n) {
+        if (n > num_acqs - start) {
+            n = num_acqs - start;
+        }
+        status = read_acquisition_index_entries(dset, entries, start, n);
+        if (status != ISMRMRD_NOERROR) {
+            break;
+        }
+        status = append_elements(dset, ISMRMRD_ACQUISITION_INDEX, NULL, entries, dset->cache->acquisition_index_type, 0, NULL, n, 0, NULL);
+        if (status != ISMRMRD_NOERROR) {
+            break;
+        }
+    }
+    free(entries);
 
-    hdfdims = (hsize_t *)malloc(rank * sizeof(*hdfdims));
-    offset = (hsize_t *)malloc(rank * sizeof(*offset));
-    count = (hsize_t *)malloc(rank * sizeof(*count));
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to update acquisition index.");
+    }
+    return ISMRMRD_NOERROR;
+}
 
-    h5status = H5Sget_simple_extent_dims(filespace, hdfdims, NULL);
+/* Indexes acquisitions that were just appended to the file */
+static int index_appended_acquisitions(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acqs, uint32_t n)
+{
+    HDF5_AcquisitionIndexEntry *entries;
+    uint32_t i;
+    int status;
 
-    if (index >= hdfdims[0]) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Index out of range.");
+    /* An index that was behind before this append is caught up from the file */
+    if (get_number_of_elements(dset, ISMRMRD_ACQUISITION_INDEX, NULL) + n != get_number_of_stored_acquisitions(dset)) {
+        return update_acquisition_index(dset);
     }
 
-    offset[0] = index;
-    count[0] = 1;
-    for (n=1; n< rank; n++) {
-        offset[n] = 0;
-        count[n] = hdfdims[n];
+    entries = (HDF5_AcquisitionIndexEntry *) malloc(n * sizeof(HDF5_AcquisitionIndexEntry));
+    if (entries == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc acquisition index buffer.");
     }
-    
-    h5status = H5Sselect_hyperslab(filespace, H5S_SELECT_SET, offset, NULL, count, NULL);
-
-    /* create space for one */
-    memspace = H5Screate_simple(rank, count, NULL);
-    
-    h5status = H5Dread(dataset, datatype, memspace, filespace, H5P_DEFAULT, elem);
-    if (h5status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to read from dataset.");
+    for (i = 0; i < n; i++) {
+        entries[i].flags = acqs[i].head.flags;
+        entries[i].idx = acqs[i].head.idx;
+    }
+    status = append_elements(dset, ISMRMRD_ACQUISITION_INDEX, NULL, entries, dset->cache->acquisition_index_type, 0, NULL, n, 0, NULL);
+    free(entries);
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append to acquisition index.");
     }
+    return ISMRMRD_NOERROR;
+}
 
-    h5status = H5Sclose(filespace);
-    if (h5status < 0) {
+#ifdef ISMRMRD_HAVE_SWMR
+/*
+ * Streaming protocol
+ *
+ * HDF5 keeps the variable length acquisition payloads in the global heap,
+ * which is not covered by the SWMR flush ordering: a reader can see a new
+ * row before its payload reaches the file. The writer therefore records the
+ * number of acquisitions that are completely on disk in groupname/data_committed
+ * after each flush, and readers never read past it.
+ */
+
+/* Publishes the number of acquisitions in the file to readers */
+static int commit_swmr_rows(const ISMRMRD_Dataset *dset)
+{
+    ISMRMRD_CachedVariable *v;
+    uint32_t rows;
+
+    /* the payloads must be on disk before readers are told about them */
+    if (H5Fflush(dset->fileid, H5F_SCOPE_LOCAL) < 0) {
         H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close filespace.");
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to flush acquisitions.");
     }
-    h5status = H5Sclose(memspace);
-    if (h5status < 0) {
+    rows = get_number_of_stored_acquisitions(dset);
+    v = open_variable(dset, "data_committed", NULL);
+    if (v == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Missing committed acquisition count.");
+    }
+    if (H5Dwrite(v->dataset, H5T_NATIVE_UINT32, H5S_ALL, H5S_ALL, H5P_DEFAULT, &rows) < 0 ||
+        H5Dflush(v->dataset) < 0) {
         H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close memspace.");
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to write committed acquisition count.");
     }
-    h5status = H5Dclose(dataset);
-    if (h5status < 0) {
+    dset->cache->swmr_unflushed = 0;
+    return ISMRMRD_NOERROR;
+}
+
+/* Creates the variables streamed to readers and switches the file to SWMR writing */
+static int start_swmr_write(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acqs, uint32_t n)
+{
+    uint32_t rows = 0;
+    int status, layout;
+
+    /* No variables can be created once readers may be attached */
+    status = prepare_acquisition_layout(dset, acqs, n, &layout);
+    if (status != ISMRMRD_NOERROR) {
+        return status;
+    }
+    if (layout == ISMRMRD_LAYOUT_FLAT) {
+        if (open_variable(dset, "acquisitions", "header") == NULL) {
+            status = create_flat_acquisitions(dset, &acqs[0].head);
+            if (status != ISMRMRD_NOERROR) {
+                return status;
+            }
+        }
+    }
+    else if (open_variable(dset, "data", NULL) == NULL) {
+        if (create_variable(dset, "data", NULL, dset->cache->acquisition_type, 0, NULL,
+                            dset->options.acquisition_chunk_rows, NULL) == NULL) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to create acquisition dataset.");
+        }
+        dset->cache->acquisition_layout = ISMRMRD_LAYOUT_VLEN;
+    }
+    if (dset->options.index_acquisitions) {
+        status = update_acquisition_index(dset);
+        if (status != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to update acquisition index.");
+        }
+        if (open_variable(dset, ISMRMRD_ACQUISITION_INDEX, NULL) == NULL &&
+            create_variable(dset, ISMRMRD_ACQUISITION_INDEX, NULL, dset->cache->acquisition_index_type, 0, NULL, 0, NULL) == NULL) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to create acquisition index.");
+        }
+    }
+    if (open_variable(dset, "data_committed", NULL) == NULL) {
+        status = append_elements(dset, "data_committed", NULL, &rows, H5T_NATIVE_UINT32, 0, NULL, 1, 1, NULL);
+        if (status != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to create committed acquisition count.");
+        }
+    }
+
+    /* readers take the extents as the numbers of rows */
+    status = trim_variables(dset);
+    if (status != ISMRMRD_NOERROR) {
+        return status;
+    }
+    if (H5Fstart_swmr_write(dset->fileid) < 0) {
         H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close dataset.");
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to start SWMR writing.");
     }
+    dset->cache->swmr_started = true;
+    return commit_swmr_rows(dset);
+}
 
-    return ISMRMRD_NOERROR;
+#endif
+
+static bool counter_in_range(uint16_t value, uint16_t min, uint16_t max) {
+    return value >= min && value <= max;
+}
+
+static bool acquisition_matches(const ISMRMRD_AcquisitionQuery *query, const HDF5_AcquisitionIndexEntry *entry)
+{
+    const ISMRMRD_EncodingCounters *idx = &entry->idx;
+    int n;
+
+    if ((entry->flags & query->flags_set) != query->flags_set) {
+        return false;
+    }
+    if ((entry->flags & query->flags_clear) != 0) {
+        return false;
+    }
+    if (!counter_in_range(idx->kspace_encode_step_1, query->idx_min.kspace_encode_step_1, query->idx_max.kspace_encode_step_1) ||
+        !counter_in_range(idx->kspace_encode_step_2, query->idx_min.kspace_encode_step_2, query->idx_max.kspace_encode_step_2) ||
+        !counter_in_range(idx->average, query->idx_min.average, query->idx_max.average) ||
+        !counter_in_range(idx->slice, query->idx_min.slice, query->idx_max.slice) ||
+        !counter_in_range(idx->contrast, query->idx_min.contrast, query->idx_max.contrast) ||
+        !counter_in_range(idx->phase, query->idx_min.phase, query->idx_max.phase) ||
+        !counter_in_range(idx->repetition, query->idx_min.repetition, query->idx_max.repetition) ||
+        !counter_in_range(idx->set, query->idx_min.set, query->idx_max.set) ||
+        !counter_in_range(idx->segment, query->idx_min.segment, query->idx_max.segment)) {
+        return false;
+    }
+    for (n = 0; n < ISMRMRD_USER_INTS; n++) {
+        if (!counter_in_range(idx->user[n], query->idx_min.user[n], query->idx_max.user[n])) {
+            return false;
+        }
+    }
+    return true;
 }
 
 /********************/
@@ -835,7 +2488,7 @@ int ismrmrd_init_dataset(ISMRMRD_Dataset *dset, const char *filename,
         return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc dataset groupname");
     }
     strcpy(dset->filename, filename);
-    
+
     dset->groupname = (char *) malloc(strlen(groupname) + 1);
     if (dset->groupname == NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc dataset groupname");
@@ -843,73 +2496,650 @@ int ismrmrd_init_dataset(ISMRMRD_Dataset *dset, const char *filename,
     strcpy(dset->groupname, groupname);
 
     dset->fileid = 0;
+    dset->cache = NULL;
+    return ismrmrd_init_dataset_options(&dset->options);
+}
+
+int ismrmrd_init_dataset_options(ISMRMRD_DatasetOptions *options)
+{
+    if (NULL == options) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Options parameter");
+    }
+
+    options->acquisition_chunk_rows = ISMRMRD_DEFAULT_ACQUISITION_CHUNK_ROWS;
+    options->image_chunk_rows = 0;
+    options->array_chunk_rows = 0;
+    options->chunk_size = ISMRMRD_DEFAULT_CHUNK_SIZE;
+    options->chunk_cache_size = 0;
+    options->chunk_cache_slots = 0;
+    options->meta_block_size = 0;
+    options->index_acquisitions = 0;
+    options->acquisition_layout = ISMRMRD_LAYOUT_VLEN;
+    options->swmr = ISMRMRD_SWMR_OFF;
+    options->swmr_flush_rows = 0;
+    options->driver = ISMRMRD_DRIVER_DEFAULT;
+    options->core_increment = 0;
+    options->core_backing_store = 0;
+    options->uring_queue_depth = 0;
+    options->direct_io_size = 0;
+    options->file_format = ISMRMRD_FORMAT_EARLIEST;
+    options->file_space_page_size = 0;
+    options->page_buffer_size = 0;
+    options->alignment = 0;
+    options->alignment_threshold = 0;
+    options->sieve_buf_size = 0;
+    options->extent_growth = ISMRMRD_GROWTH_EXACT;
+    options->extent_block_rows = 0;
+    memset(&options->acquisition_compression, 0, sizeof(options->acquisition_compression));
+    memset(&options->image_compression, 0, sizeof(options->image_compression));
+    memset(&options->array_compression, 0, sizeof(options->array_compression));
+    return ISMRMRD_NOERROR;
+}
+
+int ismrmrd_set_dataset_profile(ISMRMRD_DatasetOptions *options, const char *profile)
+{
+    ISMRMRD_DatasetOptions defaults, tuned;
+    ISMRMRD_CompressionOptions compression;
+
+    if (NULL == options || NULL == profile) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
+    }
+
+    ismrmrd_init_dataset_options(&defaults);
+    tuned = *options;
+    tuned.chunk_size = defaults.chunk_size;
+    tuned.chunk_cache_size = defaults.chunk_cache_size;
+    tuned.chunk_cache_slots = defaults.chunk_cache_slots;
+    tuned.meta_block_size = defaults.meta_block_size;
+    tuned.file_format = defaults.file_format;
+    tuned.file_space_page_size = defaults.file_space_page_size;
+    tuned.page_buffer_size = defaults.page_buffer_size;
+    tuned.alignment = defaults.alignment;
+    tuned.alignment_threshold = defaults.alignment_threshold;
+    tuned.sieve_buf_size = defaults.sieve_buf_size;
+    tuned.extent_growth = defaults.extent_growth;
+    tuned.extent_block_rows = defaults.extent_block_rows;
+    tuned.acquisition_layout = defaults.acquisition_layout;
+    tuned.acquisition_compression = defaults.acquisition_compression;
+    tuned.image_compression = defaults.image_compression;
+    tuned.array_compression = defaults.array_compression;
+
+    if (strcmp(profile, "default") == 0) {
+        /* nothing to change */
+    }
+    else if (strcmp(profile, "streaming-write") == 0) {
+        /* chunks of chunk_size start on stripe boundaries, small objects stay packed */
+        tuned.file_format = ISMRMRD_FORMAT_LATEST;
+        tuned.alignment = 1024 * 1024;
+        tuned.alignment_threshold = 512 * 1024;
+        tuned.meta_block_size = 1024 * 1024;
+        tuned.sieve_buf_size = 1024 * 1024;
+        tuned.extent_growth = ISMRMRD_GROWTH_GEOMETRIC;
+    }
+    else if (strcmp(profile, "random-read") == 0) {
+        /* metadata and small raw data share pages, each read fetches whole pages */
+        tuned.file_format = ISMRMRD_FORMAT_LATEST;
+        tuned.file_space_page_size = 64 * 1024;
+        tuned.page_buffer_size = 16 * 1024 * 1024;
+        tuned.chunk_cache_size = 16 * 1024 * 1024;
+        tuned.chunk_cache_slots = 12421;
+        tuned.sieve_buf_size = 64 * 1024;
+    }
+    else if (strcmp(profile, "archive") == 0) {
+        memset(&compression, 0, sizeof(compression));
+        compression.shuffle = 1;
+        compression.deflate_level = 6;
+        tuned.acquisition_layout = ISMRMRD_LAYOUT_AUTO;
+        tuned.acquisition_compression = compression;
+        tuned.image_compression = compression;
+        tuned.array_compression = compression;
+    }
+    else {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Unknown dataset profile.");
+    }
+
+    *options = tuned;
     return ISMRMRD_NOERROR;
 }
 
+/* Canonical path of an existing file, NULL if there is none */
+static char * canonical_path(const char *filename) {
+#ifdef _WIN32
+    return _fullpath(NULL, filename, 0);
+#else
+    return realpath(filename, NULL);
+#endif
+}
+
+/* Whether a file opened with the options of one dataset can serve another, the chunk caches are per dataset */
+static bool same_file_access(const ISMRMRD_DatasetOptions *a, const ISMRMRD_DatasetOptions *b) {
+    if (a->driver != b->driver || a->file_format != b->file_format ||
+        a->meta_block_size != b->meta_block_size || a->page_buffer_size != b->page_buffer_size ||
+        a->alignment != b->alignment || a->sieve_buf_size != b->sieve_buf_size) {
+        return false;
+    }
+    if (a->alignment > 0 && a->alignment_threshold != b->alignment_threshold) {
+        return false;
+    }
+    if (a->driver == ISMRMRD_DRIVER_IO_URING &&
+        (a->uring_queue_depth != b->uring_queue_depth || a->direct_io_size != b->direct_io_size)) {
+        return false;
+    }
+    /* file_space_page_size only applies to files being created */
+    return true;
+}
+
+/* Finds the entry of a canonical path, with the lock held */
+static ISMRMRD_OpenFile * find_open_file(const char *path) {
+    ISMRMRD_OpenFile *f;
+
+    for (f = open_files; f != NULL && strcmp(f->path, path) != 0; f = f->next) {
+    }
+    return f;
+}
+
+/* Takes a reference to a shared file handle, -1 if the options do not match those it was opened with */
+static hid_t share_open_file(ISMRMRD_OpenFile *f, const ISMRMRD_Dataset *dset) {
+    if (!same_file_access(&f->options, &dset->options)) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "The file is open in another dataset with other file access options.");
+        return -1;
+    }
+    f->refs++;
+    f->shared = true;
+    return f->fileid;
+}
+
+/* Takes a reference to the handle of a file open in another dataset, returns 0 if there is none */
+static hid_t acquire_open_file(const ISMRMRD_Dataset *dset) {
+    ISMRMRD_OpenFile *f;
+    char *path = canonical_path(dset->filename);
+    hid_t fileid = 0;
+
+    if (path == NULL) {
+        return 0;
+    }
+    ISMRMRD_LOCK(&open_files_lock);
+    f = find_open_file(path);
+    if (f != NULL) {
+        fileid = share_open_file(f, dset);
+    }
+    ISMRMRD_UNLOCK(&open_files_lock);
+    free(path);
+    return fileid;
+}
+
+/*
+ * Makes the handle of a file just opened available to other datasets. If another
+ * dataset registered the file meanwhile, the new handle is closed and the shared
+ * one returned, -1 if its options do not match.
+ */
+static hid_t register_open_file(const ISMRMRD_Dataset *dset, hid_t fileid) {
+    ISMRMRD_OpenFile *f, *other;
+    hid_t shared;
+
+    f = (ISMRMRD_OpenFile *) malloc(sizeof(*f));
+    if (f == NULL) {
+        /* the dataset keeps the handle to itself */
+        return fileid;
+    }
+    f->path = canonical_path(dset->filename);
+    if (f->path == NULL) {
+        free(f);
+        return fileid;
+    }
+    f->fileid = fileid;
+    f->options = dset->options;
+    f->refs = 1;
+    f->shared = false;
+    f->grown = NULL;
+    f->num_grown = 0;
+
+    ISMRMRD_LOCK(&open_files_lock);
+    other = find_open_file(f->path);
+    if (other == NULL) {
+        f->next = open_files;
+        open_files = f;
+        ISMRMRD_UNLOCK(&open_files_lock);
+        return fileid;
+    }
+    shared = share_open_file(other, dset);
+    ISMRMRD_UNLOCK(&open_files_lock);
+
+    free(f->path);
+    free(f);
+    H5Fclose(fileid);
+    return shared;
+}
+
+/*
+ * Leaves the variables this dataset grew to the last dataset on the file,
+ * false if no other dataset uses the file and this one has to trim them.
+ */
+static bool hand_over_grown_variables(const ISMRMRD_Dataset *dset) {
+    ISMRMRD_OpenFile *f;
+    ISMRMRD_CachedVariable *v;
+    char **grown;
+    size_t i, j;
+
+    ISMRMRD_LOCK(&open_files_lock);
+    for (f = open_files; f != NULL && f->fileid != dset->fileid; f = f->next) {
+    }
+    if (f == NULL || f->refs < 2) {
+        ISMRMRD_UNLOCK(&open_files_lock);
+        return false;
+    }
+    for (i = 0; i < dset->cache->num_vars; i++) {
+        v = dset->cache->vars[i];
+        if (!v->grown) {
+            continue;
+        }
+        for (j = 0; j < f->num_grown && strcmp(f->grown[j], v->path) != 0; j++) {
+        }
+        if (j < f->num_grown) {
+            continue;
+        }
+        grown = (char **) realloc(f->grown, (f->num_grown + 1) * sizeof(*grown));
+        if (grown == NULL) {
+            ISMRMRD_UNLOCK(&open_files_lock);
+            return false;
+        }
+        f->grown = grown;
+        f->grown[f->num_grown] = (char *) malloc(strlen(v->path) + 1);
+        if (f->grown[f->num_grown] == NULL) {
+            ISMRMRD_UNLOCK(&open_files_lock);
+            return false;
+        }
+        strcpy(f->grown[f->num_grown++], v->path);
+    }
+    ISMRMRD_UNLOCK(&open_files_lock);
+    return true;
+}
+
+/* Drops a reference to a file handle, the last one trims the variables handed over and closes it */
+static int close_open_file(hid_t fileid) {
+    ISMRMRD_OpenFile **link, *f = NULL;
+    hid_t dataset;
+    int status = ISMRMRD_NOERROR;
+    size_t i;
+
+    ISMRMRD_LOCK(&open_files_lock);
+    for (link = &open_files; *link != NULL; link = &(*link)->next) {
+        if ((*link)->fileid == fileid) {
+            f = *link;
+            if (--f->refs > 0) {
+                ISMRMRD_UNLOCK(&open_files_lock);
+                return ISMRMRD_NOERROR;
+            }
+            *link = f->next;
+            break;
+        }
+    }
+    ISMRMRD_UNLOCK(&open_files_lock);
+
+    if (f != NULL) {
+        for (i = 0; i < f->num_grown; i++) {
+            dataset = H5Dopen2(fileid, f->grown[i], H5P_DEFAULT);
+            if (dataset < 0 || trim_dataset(dataset) != ISMRMRD_NOERROR) {
+                H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+                status = ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to trim a variable.");
+            }
+            if (dataset >= 0) {
+                H5Dclose(dataset);
+            }
+            free(f->grown[i]);
+        }
+        free(f->grown);
+        free(f->path);
+        free(f);
+    }
+    if (H5Fclose(fileid) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        status = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to close dataset.");
+    }
+    return status;
+}
+
 int ismrmrd_open_dataset(ISMRMRD_Dataset *dset, const bool create_if_needed) {
     /* TODO add a mode for clobbering the dataset if it exists. */
-    hid_t fileid;
+    hid_t fileid, fapl;
+    bool share;
 
     if (NULL == dset) {
         ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
         return false;
     }
 
-    /* Try opening the file */
-    /* Note the is_hdf5 function doesn't work well when trying to open multiple files */
-    fileid = H5Fopen(dset->filename, H5F_ACC_RDWR, H5P_DEFAULT);
+#ifndef ISMRMRD_HAVE_SWMR
+    if (dset->options.swmr != ISMRMRD_SWMR_OFF) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "SWMR access requires HDF5 1.10 or later.");
+    }
+#endif
+    if (dset->options.swmr < ISMRMRD_SWMR_OFF || dset->options.swmr > ISMRMRD_SWMR_READ) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Invalid SWMR mode.");
+    }
+    if (dset->options.driver < ISMRMRD_DRIVER_DEFAULT || dset->options.driver > ISMRMRD_DRIVER_IO_URING) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Invalid file driver.");
+    }
+    if (dset->options.driver == ISMRMRD_DRIVER_CORE && dset->options.swmr != ISMRMRD_SWMR_OFF) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "SWMR access is not available with the core driver.");
+    }
+    if (dset->options.file_format < ISMRMRD_FORMAT_EARLIEST || dset->options.file_format > ISMRMRD_FORMAT_LATEST) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Invalid file format.");
+    }
+#ifndef ISMRMRD_HAVE_PAGED_FILE_SPACE
+    if (dset->options.file_space_page_size > 0 || dset->options.page_buffer_size > 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Paged file space requires HDF5 1.10.1 or later.");
+    }
+#endif
+    /* the in-tree codec is always available to readers and writers */
+    if (H5Zfilter_avail((H5Z_filter_t) ISMRMRD_FILTER_LZ) <= 0 && ismrmrd_register_lz_filter() != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to register the LZ compression filter.");
+    }
 
-    if (fileid > 0) {
+    /* File access properties */
+    fapl = create_file_access(dset);
+    if (fapl < 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open file.");
+    }
+#ifdef ISMRMRD_HAVE_SWMR
+    if (dset->options.swmr == ISMRMRD_SWMR_WRITE) {
+        /* SWMR needs the file format of HDF5 1.10 */
+        if (H5Pset_libver_bounds(fapl, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST) < 0) {
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            H5Pclose(fapl);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to set file format bounds.");
+        }
+    }
+    else if (dset->options.swmr == ISMRMRD_SWMR_READ) {
+        fileid = open_file(dset, H5F_ACC_RDONLY | H5F_ACC_SWMR_READ, fapl);
+        H5Pclose(fapl);
+        if (fileid < 0) {
+            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open file for SWMR reading.");
+        }
         dset->fileid = fileid;
+        /* the group cannot be created by a reader */
+        if (create_cache(dset) != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to create dataset cache.");
+        }
+        /* the file was opened before reading the committed count, catch up */
+        return refresh_swmr_read(dset, false);
     }
-    else if (create_if_needed == false) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        /* Some sort of error opening the file - Maybe it doesn't exist? */
+#endif
+
+    /* Share the handle of a file another dataset has open, SWMR and core files are not shared */
+    share = dset->options.swmr == ISMRMRD_SWMR_OFF && dset->options.driver != ISMRMRD_DRIVER_CORE;
+    fileid = share ? acquire_open_file(dset) : 0;
+    if (fileid < 0) {
+        H5Pclose(fapl);
         return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open file.");
     }
-    else {
-        /* Try creating a new file using the default properties. */
-        /* this will be readwrite */
-        fileid = H5Fcreate(dset->filename, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
-        if (fileid > 0) {
-            dset->fileid = fileid;
+    if (fileid == 0) {
+        /* Try opening the file */
+        /* Note the is_hdf5 function doesn't work well when trying to open multiple files */
+        fileid = open_file(dset, H5F_ACC_RDWR, fapl);
+        if (fileid <= 0 && create_if_needed) {
+            /* Try creating a new file */
+            /* this will be readwrite */
+            fileid = create_file(dset, fapl);
         }
-        else {
-            /* Error opening the file */
-            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open file.");
+        if (fileid > 0 && share) {
+            fileid = register_open_file(dset, fileid);
+            if (fileid < 0) {
+                H5Pclose(fapl);
+                return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open file.");
+            }
         }
     }
+    H5Pclose(fapl);
+    if (fileid <= 0) {
+        /* Some sort of error opening the file - Maybe it doesn't exist? */
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open file.");
+    }
+    dset->fileid = fileid;
+
     /* Open the existing dataset */
     /* ensure that /groupname exists */
     create_link(dset, dset->groupname);
-    
+
+    return create_cache(dset);
+}
+
+int ismrmrd_open_dataset_from_image(ISMRMRD_Dataset *dset, const void *image, size_t size) {
+    hid_t fileid, fapl;
+
+    if (NULL == dset) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
+    }
+    if (NULL == image || size == 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "File image should not be empty.");
+    }
+    if (dset->options.swmr != ISMRMRD_SWMR_OFF) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "SWMR access is not available with a file image.");
+    }
+    if (H5Zfilter_avail((H5Z_filter_t) ISMRMRD_FILTER_LZ) <= 0 && ismrmrd_register_lz_filter() != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to register the LZ compression filter.");
+    }
+
+    /* the core driver copies the image, the caller keeps its buffer */
+    fapl = H5Pcreate(H5P_FILE_ACCESS);
+    if (set_core_driver(dset, fapl) != ISMRMRD_NOERROR) {
+        H5Pclose(fapl);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to set file access properties.");
+    }
+    if (set_file_access(dset, fapl) != ISMRMRD_NOERROR) {
+        H5Pclose(fapl);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to set file access properties.");
+    }
+    if (H5Pset_file_image(fapl, (void *) image, size) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        H5Pclose(fapl);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to set file access properties.");
+    }
+
+    fileid = open_file(dset, H5F_ACC_RDWR, fapl);
+    H5Pclose(fapl);
+    if (fileid < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to open file image.");
+    }
+    dset->fileid = fileid;
+
+    create_link(dset, dset->groupname);
+    return create_cache(dset);
+}
+
+/* Bob Jenkins' lookup3 hash, the checksum of HDF5 metadata */
+#define LOOKUP3_ROT(x, k) (((x) << (k)) ^ ((x) >> (32 - (k))))
+
+static uint32_t checksum_metadata(const uint8_t *k, size_t length)
+{
+    uint32_t a, b, c;
+
+    a = b = c = 0xdeadbeef + (uint32_t) length;
+    while (length > 12) {
+        a += k[0] + ((uint32_t) k[1] << 8) + ((uint32_t) k[2] << 16) + ((uint32_t) k[3] << 24);
+        b += k[4] + ((uint32_t) k[5] << 8) + ((uint32_t) k[6] << 16) + ((uint32_t) k[7] << 24);
+        c += k[8] + ((uint32_t) k[9] << 8) + ((uint32_t) k[10] << 16) + ((uint32_t) k[11] << 24);
+        a -= c; a ^= LOOKUP3_ROT(c, 4);  c += b;
+        b -= a; b ^= LOOKUP3_ROT(a, 6);  a += c;
+        c -= b; c ^= LOOKUP3_ROT(b, 8);  b += a;
+        a -= c; a ^= LOOKUP3_ROT(c, 16); c += b;
+        b -= a; b ^= LOOKUP3_ROT(a, 19); a += c;
+        c -= b; c ^= LOOKUP3_ROT(b, 4);  b += a;
+        length -= 12;
+        k += 12;
+    }
+    if (length == 0) {
+        return c;
+    }
+    switch (length) {
+    case 12: c += (uint32_t) k[11] << 24; /* fall through */
+    case 11: c += (uint32_t) k[10] << 16; /* fall through */
+    case 10: c += (uint32_t) k[9] << 8;   /* fall through */
+    case 9:  c += k[8];                   /* fall through */
+    case 8:  b += (uint32_t) k[7] << 24;  /* fall through */
+    case 7:  b += (uint32_t) k[6] << 16;  /* fall through */
+    case 6:  b += (uint32_t) k[5] << 8;   /* fall through */
+    case 5:  b += k[4];                   /* fall through */
+    case 4:  a += (uint32_t) k[3] << 24;  /* fall through */
+    case 3:  a += (uint32_t) k[2] << 16;  /* fall through */
+    case 2:  a += (uint32_t) k[1] << 8;   /* fall through */
+    default: a += k[0];
+    }
+    c ^= b; c -= LOOKUP3_ROT(b, 14);
+    a ^= c; a -= LOOKUP3_ROT(c, 11);
+    b ^= a; b -= LOOKUP3_ROT(a, 25);
+    c ^= b; c -= LOOKUP3_ROT(b, 16);
+    a ^= c; a -= LOOKUP3_ROT(c, 4);
+    b ^= a; b -= LOOKUP3_ROT(a, 14);
+    c ^= b; c -= LOOKUP3_ROT(b, 24);
+    return c;
+}
+
+/*
+ * Restores the checksum of a version 2 or later superblock at the start of a file image.
+ *
+ * These superblocks, written with ISMRMRD_FORMAT_LATEST or paged file space,
+ * carry status flags that are set while the file is open. H5Fget_file_image of
+ * HDF5 1.10 clears them in the image but keeps the checksum of the open file,
+ * which then fails to open. The checksum is only rewritten if it fails to verify
+ * and verifies with the flags set back, so images of HDF5 versions without the
+ * bug and damaged superblocks are left as they are.
+ */
+static void fix_superblock_checksum(uint8_t *image, size_t size)
+{
+    static const uint8_t signature[8] = {0x89, 'H', 'D', 'F', '\r', '\n', 0x1a, '\n'};
+    /* write access, file consistency and SWMR write access */
+    const uint8_t all_flags = 0x07;
+    uint32_t stored, checksum;
+    uint8_t flags, set;
+    size_t length;
+
+    if (size < 12 || memcmp(image, signature, sizeof(signature)) != 0 || image[8] < 2) {
+        return;
+    }
+    /* signature, versions, sizes and flags, four addresses, then the checksum */
+    length = 12 + 4 * (size_t) image[9];
+    if (size < length + 4) {
+        return;
+    }
+    stored = (uint32_t) image[length] | (uint32_t) image[length + 1] << 8 |
+             (uint32_t) image[length + 2] << 16 | (uint32_t) image[length + 3] << 24;
+    if (checksum_metadata(image, length) == stored) {
+        return;
+    }
+    flags = image[11];
+    for (set = 1; set <= all_flags; set++) {
+        image[11] = flags | set;
+        if (checksum_metadata(image, length) == stored) {
+            break;
+        }
+    }
+    image[11] = flags;
+    if (set > all_flags) {
+        return;
+    }
+    checksum = checksum_metadata(image, length);
+    image[length] = (uint8_t) checksum;
+    image[length + 1] = (uint8_t) (checksum >> 8);
+    image[length + 2] = (uint8_t) (checksum >> 16);
+    image[length + 3] = (uint8_t) (checksum >> 24);
+}
+
+int ismrmrd_get_file_image(const ISMRMRD_Dataset *dset, void **image, size_t *size) {
+    ssize_t image_size;
+    void *buffer;
+
+    if (NULL == dset) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
+    }
+    if (NULL == image || NULL == size) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
+    }
+    if (dset->cache == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open.");
+    }
+
+    /* a first call without a buffer returns the size */
+    if (H5Fflush(dset->fileid, H5F_SCOPE_LOCAL) < 0 ||
+        (image_size = H5Fget_file_image(dset->fileid, NULL, 0)) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to get the size of the file image.");
+    }
+    buffer = malloc(image_size > 0 ? (size_t) image_size : 1);
+    if (buffer == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc file image.");
+    }
+    if (H5Fget_file_image(dset->fileid, buffer, (size_t) image_size) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        free(buffer);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to get the file image.");
+    }
+    fix_superblock_checksum((uint8_t *) buffer, (size_t) image_size);
+    *image = buffer;
+    *size = (size_t) image_size;
     return ISMRMRD_NOERROR;
 }
 
 int ismrmrd_close_dataset(ISMRMRD_Dataset *dset) {
-    herr_t h5status;
+    int status, trim_status, close_status;
 
     if (NULL == dset) {
         ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "NULL Dataset parameter");
         return false;
     }
 
+#ifdef ISMRMRD_HAVE_SWMR
+    /* Hand the last acquisitions to the readers */
+    if (dset->cache != NULL && dset->cache->swmr_started && dset->cache->swmr_unflushed > 0) {
+        commit_swmr_rows(dset);
+    }
+#endif
+
+    /* Shrink the variables grown ahead of their rows unless another dataset still appends to the file */
+    trim_status = ISMRMRD_NOERROR;
+    if (dset->cache != NULL && dset->options.swmr == ISMRMRD_SWMR_OFF && !hand_over_grown_variables(dset)) {
+        trim_status = trim_variables(dset);
+    }
+
+    /* Release the open datasets and datatypes */
+    status = destroy_cache(dset);
+    if (status == ISMRMRD_NOERROR) {
+        status = trim_status;
+    }
+
     /* Check for a valid fileid before trying to close the file */
     if (dset->fileid > 0) {
-        h5status = H5Fclose (dset->fileid);
+        close_status = close_open_file(dset->fileid);
         dset->fileid = 0;
-        if (h5status < 0) {
-            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        if (close_status != ISMRMRD_NOERROR) {
             return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to close dataset.");
         }
     }
-    
+
+    return status;
+}
+
+int ismrmrd_refresh_dataset(ISMRMRD_Dataset *dset) {
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (dset->cache==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open.");
+    }
+
+#ifdef ISMRMRD_HAVE_SWMR
+    if (dset->options.swmr == ISMRMRD_SWMR_READ) {
+        return refresh_swmr_read(dset, false);
+    }
+#endif
     return ISMRMRD_NOERROR;
 }
 
 int ismrmrd_write_header(const ISMRMRD_Dataset *dset, const char *xmlstring) {
-    hid_t dataset, dataspace, datatype, props;
+    hid_t dataset, dataspace, props;
     hsize_t dims[] = {1};
     herr_t h5status;
     void *buff[1];
@@ -923,39 +3153,38 @@ int ismrmrd_write_header(const ISMRMRD_Dataset *dset, const char *xmlstring) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "xmlstring should not be NULL.");
     }
 
+    if (dset->cache==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open.");
+    }
+
     /* The path to the xml header */
     path = make_path(dset, "xml");
-    
+
     /* Delete the old header if it exists */
     h5status = delete_var(dset, "xml");
-    
+
     /* Create a new dataset for the xmlstring */
     /* i.e. create the memory type, data space, and data set */
     dataspace = H5Screate_simple(1, dims, NULL);
-    datatype = get_hdf5type_xmlheader();
     props = H5Pcreate (H5P_DATASET_CREATE);
-    dataset = H5Dcreate2(dset->fileid, path, datatype, dataspace, H5P_DEFAULT, props,  H5P_DEFAULT);
-        
+    dataset = H5Dcreate2(dset->fileid, path, dset->cache->string_type, dataspace, H5P_DEFAULT, props,  H5P_DEFAULT);
+    free(path);
+
     /* Write it out */
     /* We have to wrap the xmlstring in an array */
     buff[0] = (void *) xmlstring;  /* safe to get rid of const the type */
-    h5status = H5Dwrite(dataset, datatype, H5S_ALL, H5S_ALL, H5P_DEFAULT, buff);
+    h5status = H5Dwrite(dataset, dset->cache->string_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, buff);
     if (h5status < 0) {
         H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
         return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to write xml string to dataset");
     }
-    
+
     /* Clean up */
     h5status = H5Pclose(props);
     if (h5status < 0) {
         H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
         return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to close property list.");
     }
-    h5status = H5Tclose(datatype);
-    if (h5status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to close datatype.");
-    }
     h5status = H5Sclose(dataspace);
     if (h5status < 0) {
         H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
@@ -971,167 +3200,615 @@ int ismrmrd_write_header(const ISMRMRD_Dataset *dset, const char *xmlstring) {
 }
 
 char * ismrmrd_read_header(const ISMRMRD_Dataset *dset) {
-    hid_t dataset, datatype;
+    ISMRMRD_CachedVariable *v;
     herr_t h5status;
-    char * xmlstring, *path;
-        
+    char * xmlstring;
+    void *buff[1] = { NULL };
+
     if (dset==NULL) {
         ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
         return NULL;
     }
 
-    /* The path to the xml header */
-    path = make_path(dset, "xml");
-        
-    if (link_exists(dset, path)) {
-        void *buff[1] = { NULL };
-        dataset = H5Dopen2(dset->fileid, path, H5P_DEFAULT);
-        datatype = get_hdf5type_xmlheader();
-        /* Read it into a 1D buffer*/
-        h5status = H5Dread(dataset, datatype, H5S_ALL, H5S_ALL, H5P_DEFAULT, buff);
-        if (h5status < 0 || buff[0] == NULL) {
+    v = open_variable(dset, "xml", NULL);
+    if (v == NULL) {
+        /* No XML String found */
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "No XML Header found.");
+        return NULL;
+    }
+
+    /* Read it into a 1D buffer*/
+    h5status = H5Dread(v->dataset, dset->cache->string_type, H5S_ALL, H5S_ALL, H5P_DEFAULT, buff);
+    if (h5status < 0 || buff[0] == NULL) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read header.");
+        return NULL;
+    }
+
+    /* Unpack */
+    xmlstring = (char *) malloc(strlen(buff[0])+1);
+    if (xmlstring == NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc xmlstring");
+    } else {
+        memcpy(xmlstring, buff[0], strlen(buff[0])+1);
+    }
+    free(buff[0]);
+
+    return xmlstring;
+}
+
+char ** ismrmrd_list_groups(const ISMRMRD_Dataset *dset, uint32_t *count) {
+    H5G_info_t info;
+    hsize_t i;
+    hid_t obj;
+    ssize_t len;
+    size_t size;
+    char **names, *name;
+
+    if (dset==NULL || count==NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
+        return NULL;
+    }
+    if (dset->fileid <= 0) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open.");
+        return NULL;
+    }
+    if (H5Gget_info(dset->fileid, &info) < 0) {
+        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
+        ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to get the root group.");
+        return NULL;
+    }
+
+    /* room for every link at the root, the pointers first */
+    size = info.nlinks * sizeof(char *);
+    for (i = 0; i < info.nlinks; i++) {
+        len = H5Lget_name_by_idx(dset->fileid, ".", H5_INDEX_NAME, H5_ITER_INC, i, NULL, 0, H5P_DEFAULT);
+        if (len < 0) {
             H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-            ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read header.");
-            free(path);
+            ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to get a link name.");
             return NULL;
         }
-        
-        /* Unpack */
-        xmlstring = (char *) malloc(strlen(buff[0])+1);
-        if (xmlstring == NULL) {
-            ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc xmlstring");
-        } else {
-            memcpy(xmlstring, buff[0], strlen(buff[0])+1);
+        size += (size_t) len + 1;
+    }
+    names = (char **) malloc(size > 0 ? size : 1);
+    if (names == NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc group names");
+        return NULL;
+    }
+
+    *count = 0;
+    name = (char *) (names + info.nlinks);
+    for (i = 0; i < info.nlinks; i++) {
+        /* only the object header is read, the group is not opened as a dataset */
+        obj = H5Oopen_by_idx(dset->fileid, ".", H5_INDEX_NAME, H5_ITER_INC, i, H5P_DEFAULT);
+        if (obj < 0) {
+            /* e.g. a dangling soft link */
+            H5Eclear2(H5E_DEFAULT);
+            continue;
         }
-        
-        /* Clean up */
-        h5status = H5Tclose(datatype);
-        if (h5status < 0) {
-            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-            ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to close XML header HDF5 datatype.");
-            return NULL;
+        if (H5Iget_type(obj) == H5I_GROUP) {
+            len = H5Lget_name_by_idx(dset->fileid, ".", H5_INDEX_NAME, H5_ITER_INC, i, name,
+                                     size - (size_t) (name - (char *) names), H5P_DEFAULT);
+            if (len >= 0) {
+                names[(*count)++] = name;
+                name += len + 1;
+            }
         }
-        h5status = H5Dclose(dataset);
-        if (h5status < 0) {
-            H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-            ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to close XML header HDF5 dataset.");
-            return NULL;
+        H5Oclose(obj);
+    }
+    return names;
+}
+
+uint32_t ismrmrd_get_number_of_acquisitions(const ISMRMRD_Dataset *dset) {
+    uint32_t num;
+
+    if (dset==NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
+        return 0;
+    }
+    /* The acqusition data */
+    num = get_number_of_stored_acquisitions(dset);
+    /* A streaming reader stops at the acquisitions the writer has committed */
+    if (dset->options.swmr == ISMRMRD_SWMR_READ && dset->cache != NULL && num > dset->cache->swmr_committed) {
+        num = dset->cache->swmr_committed;
+    }
+    return num;
+}
+
+int ismrmrd_append_acquisition(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acq) {
+    return ismrmrd_append_acquisitions(dset, acq, 1);
+}
+
+int ismrmrd_append_acquisitions(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acqs, uint32_t n) {
+    int status, layout;
+
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (acqs==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Acquisition pointer should not be NULL.");
+    }
+    if (dset->cache==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open.");
+    }
+    if (n == 0) {
+        return ISMRMRD_NOERROR;
+    }
+
+#ifdef ISMRMRD_HAVE_SWMR
+    if (dset->options.swmr == ISMRMRD_SWMR_WRITE && !dset->cache->swmr_started) {
+        status = start_swmr_write(dset, acqs, n);
+        if (status != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to start streaming acquisitions.");
         }
+    }
+#endif
 
-        free(path);
-        return xmlstring;
+    status = prepare_acquisition_layout(dset, acqs, n, &layout);
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to choose acquisition layout.");
     }
-    else {
-        /* No XML String found */
-        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "No XML Header found.");
-        free(path);
-        return NULL;
+    if (layout == ISMRMRD_LAYOUT_FLAT) {
+        status = append_flat_acquisitions(dset, acqs, n);
+    } else {
+        status = append_vlen_acquisitions(dset, acqs, n);
+    }
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append acquisitions.");
+    }
+
+    if (dset->options.index_acquisitions) {
+        status = index_appended_acquisitions(dset, acqs, n);
+        if (status != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to index acquisitions.");
+        }
+    }
+
+#ifdef ISMRMRD_HAVE_SWMR
+    if (dset->cache->swmr_started) {
+        dset->cache->swmr_unflushed += n;
+        if (dset->cache->swmr_unflushed >= dset->options.swmr_flush_rows) {
+            status = commit_swmr_rows(dset);
+            if (status != ISMRMRD_NOERROR) {
+                return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to flush acquisitions to readers.");
+            }
+        }
+    }
+#endif
+
+    return ISMRMRD_NOERROR;
+}
+
+int ismrmrd_read_acquisition(const ISMRMRD_Dataset *dset, uint32_t index, ISMRMRD_Acquisition *acq)
+{
+    return ismrmrd_read_acquisitions(dset, index, 1, acq);
+}
+
+int ismrmrd_read_acquisitions(const ISMRMRD_Dataset *dset, uint32_t start, uint32_t count,
+                              ISMRMRD_Acquisition *acqs)
+{
+    int status;
+
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (acqs==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Acquisition pointer should not be NULL.");
+    }
+    if (dset->cache==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open.");
+    }
+    if (count == 0) {
+        return ISMRMRD_NOERROR;
+    }
+#ifdef ISMRMRD_HAVE_SWMR
+    /* rows past the committed count may still be partly written */
+    if (dset->options.swmr == ISMRMRD_SWMR_READ &&
+        (uint64_t) start + count > ismrmrd_get_number_of_acquisitions(dset)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Index out of range.");
+    }
+#endif
+
+    if (get_acquisition_layout(dset) == ISMRMRD_LAYOUT_FLAT) {
+        status = read_flat_acquisitions(dset, start, count, acqs);
+    } else {
+        status = read_vlen_acquisitions(dset, start, count, acqs);
+    }
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read acquisitions.");
+    }
+
+    return ISMRMRD_NOERROR;
+}
+
+int ismrmrd_read_acquisition_headers(const ISMRMRD_Dataset *dset, uint32_t start, uint32_t count,
+                                     ISMRMRD_AcquisitionHeader *heads)
+{
+    int status;
+
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (heads==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Header pointer should not be NULL.");
+    }
+    if (dset->cache==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open.");
+    }
+    if (count == 0) {
+        return ISMRMRD_NOERROR;
+    }
+#ifdef ISMRMRD_HAVE_SWMR
+    /* rows past the committed count may still be partly written */
+    if (dset->options.swmr == ISMRMRD_SWMR_READ &&
+        (uint64_t) start + count > ismrmrd_get_number_of_acquisitions(dset)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Index out of range.");
+    }
+#endif
+
+    if (get_acquisition_layout(dset) == ISMRMRD_LAYOUT_FLAT) {
+        status = read_elements(dset, "acquisitions", "header", heads, dset->cache->acquisition_header_type,
+                               start, count);
+    } else {
+        /* The memory type only has the head member, so traj and data are never converted */
+        status = read_elements(dset, "data", NULL, heads, dset->cache->acquisition_head_type, start, count);
+    }
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read acquisition headers.");
+    }
+
+    return ISMRMRD_NOERROR;
+}
+
+int ismrmrd_init_acquisition_query(ISMRMRD_AcquisitionQuery *query)
+{
+    if (query==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Query pointer should not be NULL.");
+    }
+    query->flags_set = 0;
+    query->flags_clear = 0;
+    /* all counters unrestricted */
+    memset(&query->idx_min, 0, sizeof(ISMRMRD_EncodingCounters));
+    memset(&query->idx_max, 0xFF, sizeof(ISMRMRD_EncodingCounters));
+    return ISMRMRD_NOERROR;
+}
+
+int ismrmrd_build_acquisition_index(const ISMRMRD_Dataset *dset)
+{
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (dset->cache==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open.");
+    }
+    if (!can_write_acquisition_index(dset)) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not writable, the acquisition index cannot be built.");
+    }
+    return update_acquisition_index(dset);
+}
+
+int ismrmrd_find_acquisitions(const ISMRMRD_Dataset *dset, const ISMRMRD_AcquisitionQuery *query,
+                              uint32_t **rows, uint32_t *count)
+{
+    HDF5_AcquisitionIndexEntry *entries;
+    uint32_t *found = NULL, *newfound;
+    uint32_t num_acqs, num_indexed, num_found = 0, max_found = 0, block, start, n, i;
+    int status;
+
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (query==NULL || rows==NULL || count==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Query and result pointers should not be NULL.");
+    }
+    if (dset->cache==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open.");
+    }
+    *rows = NULL;
+    *count = 0;
+
+    /* Build or extend the index on demand, a read-only handle uses what is indexed */
+    if (can_write_acquisition_index(dset)) {
+        status = update_acquisition_index(dset);
+        if (status != ISMRMRD_NOERROR) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to update acquisition index.");
+        }
     }
+    num_acqs = ismrmrd_get_number_of_acquisitions(dset);
+    num_indexed = get_number_of_elements(dset, ISMRMRD_ACQUISITION_INDEX, NULL);
+    if (num_indexed > num_acqs) {
+        /* stale or ahead of the committed acquisitions, scan the acquisitions instead */
+        num_indexed = 0;
+    }
+    if (num_acqs == 0) {
+        return ISMRMRD_NOERROR;
+    }
+
+    block = num_acqs < ISMRMRD_INDEX_BLOCK_ROWS ? num_acqs : ISMRMRD_INDEX_BLOCK_ROWS;
+    entries = (HDF5_AcquisitionIndexEntry *) malloc(block * sizeof(HDF5_AcquisitionIndexEntry));
+    if (entries == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc acquisition index buffer.");
+    }
+
+    for (start = 0; start < num_acqs; start += n) {
+        n = num_acqs - start < block ? num_acqs - start : block;
+        /* Indexed rows come from the index, the rest from the acquisition headers */
+        if (start < num_indexed) {
+            if (n > num_indexed - start) {
+                n = num_indexed - start;
+            }
+            status = read_elements(dset, ISMRMRD_ACQUISITION_INDEX, NULL, entries, dset->cache->acquisition_index_type, start, n);
+        }
+        else {
+            status = read_acquisition_index_entries(dset, entries, start, n);
+        }
+        if (status != ISMRMRD_NOERROR) {
+            free(entries);
+            free(found);
+            return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read acquisition index.");
+        }
+        for (i = 0; i < n; i++) {
+            if (!acquisition_matches(query, &entries[i])) {
+                continue;
+            }
+            if (num_found == max_found) {
+                max_found = max_found > 0 ? 2 * max_found : 1024;
+                newfound = (uint32_t *) realloc(found, max_found * sizeof(uint32_t));
+                if (newfound == NULL) {
+                    free(entries);
+                    free(found);
+                    return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to realloc acquisition query result.");
+                }
+                found = newfound;
+            }
+            found[num_found++] = start + i;
+        }
+    }
+    free(entries);
+
+    *rows = found;
+    *count = num_found;
+    return ISMRMRD_NOERROR;
+}
+
+int ismrmrd_init_acquisition_cursor(ISMRMRD_AcquisitionCursor *cursor, const ISMRMRD_Dataset *dset,
+                                    const ISMRMRD_AcquisitionQuery *query, uint32_t batch_size)
+{
+    if (cursor==NULL || dset==NULL || query==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Cursor, dataset and query pointers should not be NULL.");
+    }
+    if (batch_size == 0) {
+        batch_size = 1024;
+    }
+
+    cursor->dset = dset;
+    cursor->query = *query;
+    cursor->batch_size = batch_size;
+    cursor->next_row = 0;
+    cursor->num_matches = 0;
+    cursor->next_match = 0;
+    cursor->matches = (uint32_t *) malloc(batch_size * sizeof(uint32_t));
+    cursor->entries = malloc(batch_size * sizeof(HDF5_AcquisitionIndexEntry));
+    if (cursor->matches == NULL || cursor->entries == NULL) {
+        free(cursor->matches);
+        free(cursor->entries);
+        cursor->matches = NULL;
+        cursor->entries = NULL;
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc cursor buffers.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+/* Evaluates the query on the next batch of acquisitions, returns false when all rows are evaluated */
+static bool evaluate_cursor_batch(ISMRMRD_AcquisitionCursor *cursor, int *status)
+{
+    HDF5_AcquisitionIndexEntry *entries = (HDF5_AcquisitionIndexEntry *) cursor->entries;
+    uint32_t num_acqs, n, i;
+
+    cursor->num_matches = 0;
+    cursor->next_match = 0;
+
+    num_acqs = ismrmrd_get_number_of_acquisitions(cursor->dset);
+    if (cursor->next_row >= num_acqs) {
+        return false;
+    }
+    n = num_acqs - cursor->next_row;
+    if (n > cursor->batch_size) {
+        n = cursor->batch_size;
+    }
+
+    /* Only the flags and counters are read */
+    *status = read_acquisition_index_entries(cursor->dset, entries, cursor->next_row, n);
+    if (*status != ISMRMRD_NOERROR) {
+        return false;
+    }
+    for (i = 0; i < n; i++) {
+        if (acquisition_matches(&cursor->query, &entries[i])) {
+            cursor->matches[cursor->num_matches++] = cursor->next_row + i;
+        }
+    }
+    cursor->next_row += n;
+    return true;
+}
+
+int ismrmrd_acquisition_cursor_next(ISMRMRD_AcquisitionCursor *cursor, ISMRMRD_Acquisition *acqs,
+                                    uint32_t *rows, uint32_t max, uint32_t *count)
+{
+    uint32_t start, run;
+    int status = ISMRMRD_NOERROR;
+
+    if (cursor==NULL || acqs==NULL || count==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Cursor, acquisition and count pointers should not be NULL.");
+    }
+    if (cursor->matches==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Cursor is not initialized.");
+    }
+    if (cursor->dset->cache==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open.");
+    }
+
+    *count = 0;
+    while (*count < max) {
+        if (cursor->next_match == cursor->num_matches) {
+            if (!evaluate_cursor_batch(cursor, &status)) {
+                break;
+            }
+            continue;
+        }
+
+        /* Read the run of consecutive rows starting at the next match */
+        start = cursor->matches[cursor->next_match];
+        run = 1;
+        while (*count + run < max && cursor->next_match + run < cursor->num_matches &&
+               cursor->matches[cursor->next_match + run] == start + run) {
+            run++;
+        }
+        status = ismrmrd_read_acquisitions(cursor->dset, start, run, &acqs[*count]);
+        if (status != ISMRMRD_NOERROR) {
+            break;
+        }
+        if (rows != NULL) {
+            memcpy(&rows[*count], &cursor->matches[cursor->next_match], run * sizeof(uint32_t));
+        }
+        cursor->next_match += run;
+        *count += run;
+    }
+
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read acquisitions for cursor.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+int ismrmrd_cleanup_acquisition_cursor(ISMRMRD_AcquisitionCursor *cursor)
+{
+    if (cursor==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Cursor pointer should not be NULL.");
+    }
+    free(cursor->matches);
+    free(cursor->entries);
+    cursor->matches = NULL;
+    cursor->entries = NULL;
+    cursor->num_matches = 0;
+    cursor->next_match = 0;
+    return ISMRMRD_NOERROR;
 }
 
-uint32_t ismrmrd_get_number_of_acquisitions(const ISMRMRD_Dataset *dset) {
-    char *path;
-    uint32_t numacq;
-    
-    if (dset==NULL) {
-        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
-        return 0;
+/* Images per block of a batched image data transfer, 1 transfers the images one by one */
+static uint32_t image_block_rows(size_t data_size, uint32_t count)
+{
+    size_t rows = data_size > 0 ? ISMRMRD_IMAGE_BLOCK_SIZE / data_size : count;
+    if (rows < 1) {
+        rows = 1;
     }
-    /* The path to the acqusition data */    
-    path = make_path(dset, "data");
-    numacq = get_number_of_elements(dset, path);
-    free(path);
-    return numacq;
+    return rows < count ? (uint32_t) rows : count;
 }
 
-int ismrmrd_append_acquisition(const ISMRMRD_Dataset *dset, const ISMRMRD_Acquisition *acq) {
+/* Images appended together share the shape of the data variable */
+static bool is_same_image_shape(const ISMRMRD_ImageHeader *a, const ISMRMRD_ImageHeader *b)
+{
+    return a->data_type == b->data_type && a->channels == b->channels && a->matrix_size[0] == b->matrix_size[0] &&
+           a->matrix_size[1] == b->matrix_size[1] && a->matrix_size[2] == b->matrix_size[2];
+}
+
+/* Appends the headers of n images gathered into one block */
+static int append_image_headers(const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_Image *ims, uint32_t n)
+{
+    ISMRMRD_ImageHeader *heads;
+    uint32_t i;
     int status;
-    char *path;
-    hid_t datatype;
-    HDF5_Acquisition hdf5acq[1];
-            
-    if (dset==NULL) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+
+    if (n == 1) {
+        return append_element(dset, varname, "header", (void *) &ims[0].head, dset->cache->image_header_type, 0, NULL,
+                              dset->options.image_chunk_rows, &dset->options.image_compression);
     }
-    if (acq==NULL) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Acquisition pointer should not be NULL.");
+    heads = (ISMRMRD_ImageHeader *) malloc(n * sizeof(ISMRMRD_ImageHeader));
+    if (heads == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc image header buffer.");
     }
-    
-    /* The path to the acqusition data */    
-    path = make_path(dset, "data");
-            
-    /* The acquisition datatype */
-    datatype = get_hdf5type_acquisition();
-    
-    /* Create the HDF5 version of the acquisition */
-    hdf5acq[0].head = acq->head;
-    hdf5acq[0].traj.len = acq->head.number_of_samples * acq->head.trajectory_dimensions;
-    hdf5acq[0].traj.p = acq->traj;
-    hdf5acq[0].data.len = 2 * acq->head.number_of_samples * acq->head.active_channels;
-    hdf5acq[0].data.p = acq->data;
-    
-    /* Write it */
-    status = append_element(dset, path, hdf5acq, datatype, 0, NULL);
-    if (status != ISMRMRD_NOERROR) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append acquisition.");
+    for (i = 0; i < n; i++) {
+        heads[i] = ims[i].head;
     }
+    status = append_elements(dset, varname, "header", heads, dset->cache->image_header_type, 0, NULL, n,
+                             dset->options.image_chunk_rows, &dset->options.image_compression);
+    free(heads);
+    return status;
+}
 
-    free(path);
+/* Appends the attribute strings of n images, only their pointers are gathered */
+static int append_image_attributes(const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_Image *ims, uint32_t n)
+{
+    char **attributes;
+    uint32_t i;
+    int status;
 
-    /* Clean up */
-    status = H5Tclose(datatype);
-    if (status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close datatype.");
+    if (n == 1) {
+        return append_element(dset, varname, "attributes", (void *) &ims[0].attribute_string,
+                              dset->cache->attribute_string_type, 0, NULL,
+                              dset->options.image_chunk_rows, &dset->options.image_compression);
     }
-    
-    return ISMRMRD_NOERROR;
+    attributes = (char **) malloc(n * sizeof(char *));
+    if (attributes == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc image attribute buffer.");
+    }
+    for (i = 0; i < n; i++) {
+        attributes[i] = ims[i].attribute_string;
+    }
+    status = append_elements(dset, varname, "attributes", attributes, dset->cache->attribute_string_type, 0, NULL, n,
+                             dset->options.image_chunk_rows, &dset->options.image_compression);
+    free(attributes);
+    return status;
 }
 
-int ismrmrd_read_acquisition(const ISMRMRD_Dataset *dset, uint32_t index, ISMRMRD_Acquisition *acq)
+/* Appends the data of n images of the same shape, gathered into blocks of up to ISMRMRD_IMAGE_BLOCK_SIZE bytes */
+static int append_image_data(const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_Image *ims, uint32_t n)
 {
-    hid_t datatype;
-    herr_t status;
-    HDF5_Acquisition hdf5acq;
-    char *path;
+    hid_t datatype = dset->cache->ndarray_types[ims[0].head.data_type];
+    size_t dims[4], data_size;
+    uint32_t i, j, block_rows;
+    char *block;
+    int status = ISMRMRD_NOERROR;
 
-    if (dset==NULL) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    /* permute the dimensions in the hdf5 file */
+    dims[3] = ims[0].head.matrix_size[0];
+    dims[2] = ims[0].head.matrix_size[1];
+    dims[1] = ims[0].head.matrix_size[2];
+    dims[0] = ims[0].head.channels;
+    data_size = ismrmrd_size_of_image_data(&ims[0]);
+    block_rows = image_block_rows(data_size, n);
+    if (block_rows == 1) {
+        for (i = 0; i < n && status == ISMRMRD_NOERROR; i++) {
+            status = append_element(dset, varname, "data", ims[i].data, datatype, 4, dims,
+                                    dset->options.image_chunk_rows, &dset->options.image_compression);
+        }
+        return status;
     }
-    if (acq==NULL) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Acquisition pointer should not be NULL.");
+    block = (char *) malloc(block_rows * data_size);
+    if (block == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc image write buffer.");
     }
-
-    /* The path to the acquisition data */
-    path = make_path(dset, "data");
-
-    /* The acquisition datatype */
-    datatype = get_hdf5type_acquisition();
-
-    status = read_element(dset, path, &hdf5acq, datatype, index);
-    memcpy(&acq->head, &hdf5acq.head, sizeof(ISMRMRD_AcquisitionHeader));
-    ismrmrd_make_consistent_acquisition(acq);
-    memcpy(acq->traj, hdf5acq.traj.p, ismrmrd_size_of_acquisition_traj(acq));
-    memcpy(acq->data, hdf5acq.data.p, ismrmrd_size_of_acquisition_data(acq));
-
-    /* clean up */
-    free(hdf5acq.traj.p);
-    free(hdf5acq.data.p);
-
-    status = H5Tclose(datatype);
-    if (status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close datatype.");
+    for (i = 0; i < n && status == ISMRMRD_NOERROR; i += block_rows) {
+        if (block_rows > n - i) {
+            block_rows = n - i;
+        }
+        for (j = 0; j < block_rows; j++) {
+            memcpy(block + j * data_size, ims[i + j].data, data_size);
+        }
+        status = append_elements(dset, varname, "data", block, datatype, 4, dims, block_rows,
+                                 dset->options.image_chunk_rows, &dset->options.image_compression);
     }
-
-    return ISMRMRD_NOERROR;
+    free(block);
+    return status;
 }
 
 int ismrmrd_append_image(const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_Image *im) {
+    return ismrmrd_append_images(dset, varname, im, 1);
+}
+
+int ismrmrd_append_images(const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_Image *ims, uint32_t n) {
     int status;
-    hid_t datatype;
-    char *path, *headerpath, *attrpath, *datapath;
-    size_t dims[4];
+    char *path;
+    uint32_t i;
 
     if (dset==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
@@ -1139,66 +3816,57 @@ int ismrmrd_append_image(const ISMRMRD_Dataset *dset, const char *varname, const
     if (varname==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
     }
-    if (im==NULL) {
+    if (ims==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Image pointer should not be NULL.");
     }
+    if (dset->cache==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open.");
+    }
+    if (n == 0) {
+        return ISMRMRD_NOERROR;
+    }
+    /* checked before anything is written, the components of an image must stay in step */
+    if (ims[0].head.data_type < ISMRMRD_USHORT || ims[0].head.data_type > ISMRMRD_CXDOUBLE) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_TYPEERROR, "Invalid image data type.");
+    }
+    for (i = 1; i < n; i++) {
+        if (!is_same_image_shape(&ims[i].head, &ims[0].head)) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Images appended together must have the same data type and size.");
+        }
+    }
 
     /* The group for this set of images */
     /* /groupname/varname */
-    path = make_path(dset, varname);
     /* Make sure the path exists */
-    create_link(dset, path);        
-    
-    /* Handle the header */
-    headerpath = append_to_path(dset, path, "header");
-    datatype = get_hdf5type_imageheader();
-    status = append_element(dset, headerpath, (void *) &im->head, datatype, 0, NULL);
+    if (open_variable(dset, varname, "header") == NULL) {
+        path = make_path(dset, varname);
+        create_link(dset, path);
+        free(path);
+    }
+
+    /* Handle the headers */
+    status = append_image_headers(dset, varname, ims, n);
     if (status != ISMRMRD_NOERROR) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append image header.");
     }
-    status = H5Tclose(datatype);
-    free(headerpath);
-            
-    /* Handle the attribute string */
-    attrpath = append_to_path(dset, path, "attributes");
-    datatype = get_hdf5type_image_attribute_string();
-    status = append_element(dset, attrpath, (void *) &im->attribute_string, datatype, 0, NULL);
+
+    /* Handle the attribute strings */
+    status = append_image_attributes(dset, varname, ims, n);
     if (status != ISMRMRD_NOERROR) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append image attribute string.");
     }
-    status = H5Tclose(datatype);
-    free(attrpath);
-            
+
     /* Handle the data */
-    datapath = append_to_path(dset, path, "data");
-    datatype = get_hdf5type_ndarray(im->head.data_type);
-    /* permute the dimensions in the hdf5 file */
-    dims[3] = im->head.matrix_size[0];
-    dims[2] = im->head.matrix_size[1];
-    dims[1] = im->head.matrix_size[2];
-    dims[0] = im->head.channels;
-    status = append_element(dset, datapath, im->data, datatype, 4, dims);
+    status = append_image_data(dset, varname, ims, n);
     if (status != ISMRMRD_NOERROR) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append image data.");
     }
-    status = H5Tclose(datatype);
-    free(datapath);
-            
-    /* Final cleanup */
-    if (status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close datatype.");
-    }
-    free(path);
-    
+
     return ISMRMRD_NOERROR;
 }
 
 uint32_t ismrmrd_get_number_of_images(const ISMRMRD_Dataset *dset, const char *varname)
 {
-    char *path, *headerpath;
-    uint32_t numimages;
-    
     if (dset==NULL) {
         ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
         return 0;
@@ -1207,24 +3875,123 @@ uint32_t ismrmrd_get_number_of_images(const ISMRMRD_Dataset *dset, const char *v
         ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
         return 0;
     }
-    /* The group for this set of images */
-    /* /groupname/varname */
-    path = make_path(dset, varname);
-    /* The path to the acqusition image headers */
-    headerpath = append_to_path(dset, path, "header");
-    numimages = get_number_of_elements(dset, headerpath);
-    free(headerpath);
-    free(path);
-    return numimages;
+    /* The image headers in /groupname/varname */
+    return get_number_of_elements(dset, varname, "header");
+}
+
+
+/* Reads the headers of count images and sizes their buffers */
+static int read_image_headers(const ISMRMRD_Dataset *dset, const char *varname, uint32_t start, uint32_t count,
+                              ISMRMRD_Image *ims)
+{
+    ISMRMRD_ImageHeader head[1], *heads;
+    uint32_t n;
+    int status;
+
+    /* Reading into the image array directly would overwrite the buffer pointers */
+    if (count == 1) {
+        heads = head;
+    } else {
+        heads = (ISMRMRD_ImageHeader *) malloc(count * sizeof(ISMRMRD_ImageHeader));
+        if (heads == NULL) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc image header buffer.");
+        }
+    }
+    status = read_elements(dset, varname, "header", heads, dset->cache->image_header_type, start, count);
+    for (n = 0; n < count && status == ISMRMRD_NOERROR; n++) {
+        if (heads[n].data_type < ISMRMRD_USHORT || heads[n].data_type > ISMRMRD_CXDOUBLE) {
+            status = ISMRMRD_PUSH_ERR(ISMRMRD_TYPEERROR, "Invalid image data type.");
+            break;
+        }
+        /* the data is read as one block, the images of a variable share its shape */
+        if (!is_same_image_shape(&heads[n], &heads[0])) {
+            status = ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Image header does not match the image data.");
+            break;
+        }
+        ims[n].head = heads[n];
+        status = ismrmrd_make_consistent_image(&ims[n]);
+    }
+    if (heads != head) {
+        free(heads);
+    }
+    return status;
+}
+
+/* Reads the attribute strings of count images, HDF5 allocates them with the payload allocator */
+static int read_image_attributes(const ISMRMRD_Dataset *dset, const char *varname, uint32_t start, uint32_t count,
+                                 ISMRMRD_Image *ims)
+{
+    ISMRMRD_PayloadTarget no_target = { NULL, 0, 0, 0 };
+    char *attribute[1] = { NULL }, **attributes;
+    uint32_t n;
+    int status;
+
+    if (count == 1) {
+        attributes = attribute;
+    } else {
+        attributes = (char **) calloc(count, sizeof(char *));
+        if (attributes == NULL) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc image attribute buffer.");
+        }
+    }
+    status = read_elements_into(dset, varname, "attributes", attributes, dset->cache->attribute_string_type,
+                                start, count, &no_target);
+    if (status == ISMRMRD_NOERROR) {
+        for (n = 0; n < count; n++) {
+            ismrmrd_free(ims[n].attribute_string);
+            ims[n].attribute_string = attributes[n];
+        }
+    }
+    if (attributes != attribute) {
+        free(attributes);
+    }
+    return status;
 }
 
+/* Reads the data of count images of the same shape in blocks of up to ISMRMRD_IMAGE_BLOCK_SIZE bytes and scatters it */
+static int read_image_data(const ISMRMRD_Dataset *dset, const char *varname, uint32_t start, uint32_t count,
+                           ISMRMRD_Image *ims)
+{
+    hid_t datatype = dset->cache->ndarray_types[ims[0].head.data_type];
+    size_t data_size;
+    uint32_t n, j, block_rows;
+    char *block;
+    int status = ISMRMRD_NOERROR;
+
+    data_size = ismrmrd_size_of_image_data(&ims[0]);
+    block_rows = image_block_rows(data_size, count);
+    if (block_rows == 1) {
+        for (n = 0; n < count && status == ISMRMRD_NOERROR; n++) {
+            status = read_element(dset, varname, "data", ims[n].data, datatype, start + n);
+        }
+        return status;
+    }
+    block = (char *) malloc(block_rows * data_size);
+    if (block == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc image read buffer.");
+    }
+    for (n = 0; n < count && status == ISMRMRD_NOERROR; n += block_rows) {
+        if (block_rows > count - n) {
+            block_rows = count - n;
+        }
+        status = read_elements(dset, varname, "data", block, datatype, start + n, block_rows);
+        for (j = 0; j < block_rows && status == ISMRMRD_NOERROR; j++) {
+            memcpy(ims[n + j].data, block + j * data_size, data_size);
+        }
+    }
+    free(block);
+    return status;
+}
 
 int ismrmrd_read_image(const ISMRMRD_Dataset *dset, const char *varname,
                        const uint32_t index, ISMRMRD_Image *im) {
+    return ismrmrd_read_images(dset, varname, index, 1, im);
+}
+
+int ismrmrd_read_images(const ISMRMRD_Dataset *dset, const char *varname,
+                        uint32_t start, uint32_t count, ISMRMRD_Image *ims) {
 
     int status;
-    hid_t datatype;
-    char *path, *headerpath, *attrpath, *datapath;
     uint32_t numims;
 
     if (dset==NULL) {
@@ -1233,70 +4000,48 @@ int ismrmrd_read_image(const ISMRMRD_Dataset *dset, const char *varname,
     if (varname==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
     }
-    if (im==NULL) {
+    if (ims==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Image pointer should not be NULL.");
     }
+    if (dset->cache==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open.");
+    }
 
     numims = ismrmrd_get_number_of_images(dset, varname);
-    
-    if (index > numims) {
+
+    if (start > numims || count > numims - start) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Index requested exceeds number of images in the dataset.");
     }
-    
-    /* The group for this set of images */
-    /* /groupname/varname */
-    path = make_path(dset, varname);
-    
-    /* Handle the header */
-    headerpath = append_to_path(dset, path, "header");
-    datatype = get_hdf5type_imageheader();
-    status = read_element(dset, headerpath, (void *) &im->head, datatype, index);
+    if (count == 0) {
+        return ISMRMRD_NOERROR;
+    }
+
+    /* Handle the headers, allocating the memory for the attribute strings and the data */
+    status = read_image_headers(dset, varname, start, count, ims);
     if (status != ISMRMRD_NOERROR) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read image header.");
     }
-    free(headerpath);
-    H5Tclose(datatype);
 
-    /* Allocate the memory for the attribute string and the data */
-    ismrmrd_make_consistent_image(im);
-    
-    /* Handle the attribute string */
-    attrpath = append_to_path(dset, path, "attributes");
-    datatype = get_hdf5type_image_attribute_string();
-    status = read_element(dset, attrpath, (void *) &im->attribute_string, datatype, index);
+    /* Handle the attribute strings */
+    status = read_image_attributes(dset, varname, start, count, ims);
     if (status != ISMRMRD_NOERROR) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read image attribute string.");
     }
-    free(attrpath);
-    H5Tclose(datatype);
-            
+
     /* Handle the data */
-    datapath = append_to_path(dset, path, "data");
-    datatype = get_hdf5type_ndarray(im->head.data_type);
-    status = read_element(dset, datapath, im->data, datatype, index);
+    status = read_image_data(dset, varname, start, count, ims);
     if (status != ISMRMRD_NOERROR) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read image data.");
     }
-    free(datapath);
-            
-    /* Final cleanup */
-    status = H5Tclose(datatype);
-    if (status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close datatype.");
-    }
-    free(path);
-    
+
     return ISMRMRD_NOERROR;
 }
 
 int ismrmrd_append_array(const ISMRMRD_Dataset *dset, const char *varname, const ISMRMRD_NDArray *arr) {
     int status;
-    hid_t datatype;
     uint16_t ndim;
-    size_t *dims;
+    size_t dims[ISMRMRD_NDARRAY_MAXDIM];
     int n;
-    char *path;
 
     if (dset==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
@@ -1307,40 +4052,33 @@ int ismrmrd_append_array(const ISMRMRD_Dataset *dset, const char *varname, const
     if (arr==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Array pointer should not be NULL.");
     }
-    
-    /* The group for this set */
-    /* /groupname/varname */
-    path = make_path(dset, varname);
-            
+    if (dset->cache==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open.");
+    }
+    if (arr->data_type < ISMRMRD_USHORT || arr->data_type > ISMRMRD_CXDOUBLE) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_TYPEERROR, "Invalid array data type.");
+    }
+    if (arr->ndim > ISMRMRD_NDARRAY_MAXDIM) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Too many array dimensions.");
+    }
+
     /* Handle the data */
-    datatype = get_hdf5type_ndarray(arr->data_type);
+    /* /groupname/varname */
     ndim = arr->ndim;
-    dims = (size_t *) malloc(ndim*sizeof(size_t));
     /* permute the dimensions in the hdf5 file */
     for (n=0; n<ndim; n++) {
         dims[ndim-n-1] = arr->dims[n];
     }
-    status = append_element(dset, path, arr->data, datatype, ndim, dims);
+    status = append_element(dset, varname, NULL, arr->data, dset->cache->ndarray_types[arr->data_type], ndim, dims,
+                            dset->options.array_chunk_rows, &dset->options.array_compression);
     if (status != ISMRMRD_NOERROR) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append array.");
     }
-    
-    /* Final cleanup */
-    free(dims);
-    status = H5Tclose(datatype);
-    if (status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close datatype.");
-    }
-    free(path);
-    
+
     return ISMRMRD_NOERROR;
 }
 
 uint32_t ismrmrd_get_number_of_arrays(const ISMRMRD_Dataset *dset, const char *varname) {
-    char *path;
-    uint32_t numarrays;
-    
     if (dset==NULL) {
         ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
         return 0;
@@ -1350,20 +4088,14 @@ uint32_t ismrmrd_get_number_of_arrays(const ISMRMRD_Dataset *dset, const char *v
         return 0;
     }
 
-    /* The group for this set */
     /* /groupname/varname */
-    path = make_path(dset, varname);
-    numarrays = get_number_of_elements(dset, path);
-    free(path);
-    return numarrays;
+    return get_number_of_elements(dset, varname, NULL);
 }
 
 int ismrmrd_read_array(const ISMRMRD_Dataset *dset, const char *varname,
-                       const uint32_t index, ISMRMRD_NDArray *arr) {    
+                       const uint32_t index, ISMRMRD_NDArray *arr) {
     int status;
-    hid_t datatype;
-    char *path;
-    
+
     if (dset==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
     }
@@ -1373,35 +4105,301 @@ int ismrmrd_read_array(const ISMRMRD_Dataset *dset, const char *varname,
     if (arr==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Array pointer should not be NULL.");
     }
-
-    /* The group for this set */
-    /* /groupname/varname */
-    path = make_path(dset, varname);
+    if (dset->cache==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open.");
+    }
 
     /* get the array properties */
-    get_array_properties(dset, path, &arr->ndim, arr->dims, &arr->data_type);
-    datatype = get_hdf5type_ndarray(arr->data_type);
+    /* /groupname/varname */
+    status = get_array_properties(dset, varname, NULL, &arr->ndim, arr->dims, &arr->data_type);
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to get array properties.");
+    }
+    if (arr->data_type == 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_TYPEERROR, "Unsupported array data type.");
+    }
 
     /* allocate the memory */
     ismrmrd_make_consistent_ndarray(arr);
 
     /* read the data */
-    status = read_element(dset, path, arr->data, datatype, index);
+    status = read_element(dset, varname, NULL, arr->data, dset->cache->ndarray_types[arr->data_type], index);
     if (status != ISMRMRD_NOERROR) {
-        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to append array.");
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read array.");
     }
-    
-    /* Final cleanup */
-    status = H5Tclose(datatype);
-    if (status < 0) {
-        H5Ewalk2(H5E_DEFAULT, H5E_WALK_UPWARD, walk_hdf5_errors, NULL);
-        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to close datatype.");
+
+    return ISMRMRD_NOERROR;
+}
+
+/* Variable holding the frames of varname, the data of an image variable or the NDArray variable itself */
+static const char * get_frames_sub(const ISMRMRD_Dataset *dset, const char *varname) {
+    const char *sub = NULL;
+    char *path;
+    hid_t obj;
+
+    path = make_var_path(dset, varname, NULL);
+    if (path != NULL && link_exists(dset, path)) {
+        obj = H5Oopen(dset->fileid, path, H5P_DEFAULT);
+        if (obj >= 0) {
+            /* images are a group of variables */
+            if (H5Iget_type(obj) == H5I_GROUP) {
+                sub = "data";
+            }
+            H5Oclose(obj);
+        }
     }
     free(path);
-    
+    return sub;
+}
+
+#ifndef _WIN32
+/*
+ * File addresses of the frames of a variable, one per chunk of *segment_frames
+ * frames or one for contiguous storage. Returns false if the frames cannot be
+ * mapped as they are stored: filtered, converted, not allocated, or chunks
+ * that split frames.
+ */
+static bool get_frame_addresses(const ISMRMRD_CachedVariable *v, hid_t datatype, uint32_t count,
+                                uint32_t *segment_frames, haddr_t **addresses, uint32_t *num_segments) {
+    hid_t filetype, props;
+    haddr_t *addr = NULL;
+    bool mappable;
+#ifdef ISMRMRD_HAVE_CHUNK_INFO
+    hsize_t chunk_dims[ISMRMRD_NDARRAY_MAXDIM + 1], coords[ISMRMRD_NDARRAY_MAXDIM + 1];
+    hsize_t chunk_size;
+    unsigned filter_mask;
+    uint32_t k, n;
+    int d;
+#endif
+
+    /* the frames are used as stored, without conversion */
+    filetype = H5Dget_type(v->dataset);
+    mappable = H5Tequal(filetype, datatype) > 0;
+    H5Tclose(filetype);
+    if (!mappable || count == 0) {
+        return false;
+    }
+
+    props = H5Dget_create_plist(v->dataset);
+    switch (H5Pget_layout(props)) {
+    case H5D_CONTIGUOUS:
+        addr = (haddr_t *) malloc(sizeof(*addr));
+        if (addr != NULL) {
+            addr[0] = H5Dget_offset(v->dataset);
+            mappable = addr[0] != HADDR_UNDEF;
+            *segment_frames = count;
+            *num_segments = 1;
+        }
+        break;
+#ifdef ISMRMRD_HAVE_CHUNK_INFO
+    case H5D_CHUNKED:
+        mappable = H5Pget_nfilters(props) == 0 && H5Pget_chunk(props, v->rank, chunk_dims) == v->rank;
+        for (d = 1; mappable && d < v->rank; d++) {
+            /* a chunk of whole frames */
+            mappable = chunk_dims[d] == v->dims[d];
+        }
+        if (!mappable || chunk_dims[0] == 0 || chunk_dims[0] > UINT32_MAX) {
+            mappable = false;
+            break;
+        }
+        *segment_frames = (uint32_t) chunk_dims[0];
+        *num_segments = (uint32_t) ((count + chunk_dims[0] - 1) / chunk_dims[0]);
+        addr = (haddr_t *) malloc(*num_segments * sizeof(*addr));
+        memset(coords, 0, sizeof(coords));
+        for (k = 0, n = *num_segments; addr != NULL && mappable && k < n; k++) {
+            coords[0] = (hsize_t) k * chunk_dims[0];
+            mappable = H5Dget_chunk_info_by_coord(v->dataset, coords, &filter_mask, &addr[k], &chunk_size) >= 0 &&
+                       addr[k] != HADDR_UNDEF;
+        }
+        break;
+#endif
+    default:
+        mappable = false;
+        break;
+    }
+    H5Pclose(props);
+
+    if (addr == NULL || !mappable) {
+        /* leaves nothing on the HDF5 error stack for the copy */
+        H5Eclear2(H5E_DEFAULT);
+        free(addr);
+        return false;
+    }
+    *addresses = addr;
+    return true;
+}
+
+/* Maps the frames at the file addresses into map, returns false if the file cannot be mapped */
+static bool map_frames(const ISMRMRD_Dataset *dset, const haddr_t *addresses, uint32_t num_segments,
+                       ISMRMRD_ArrayMap *map) {
+    haddr_t first = HADDR_UNDEF, end = 0, segment_end;
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    struct stat sb;
+    unsigned char *base;
+    uint32_t k, frames;
+    int fd;
+
+    for (k = 0; k < num_segments; k++) {
+        frames = k + 1 < num_segments ? map->segment_frames : map->count - k * map->segment_frames;
+        segment_end = addresses[k] + (haddr_t) frames * map->frame_size;
+        first = addresses[k] < first ? addresses[k] : first;
+        end = segment_end > end ? segment_end : end;
+    }
+    first = first / page * page;
+
+    map->segments = (const char **) malloc(num_segments * sizeof(*map->segments));
+    if (map->segments == NULL) {
+        return false;
+    }
+    fd = open(dset->filename, O_RDONLY);
+    if (fd < 0) {
+        free(map->segments);
+        map->segments = NULL;
+        return false;
+    }
+    base = MAP_FAILED;
+    /* touching a mapped page past the end of the file is fatal */
+    if (fstat(fd, &sb) == 0 && (haddr_t) sb.st_size >= end) {
+        base = (unsigned char *) mmap(NULL, (size_t) (end - first), PROT_READ, MAP_SHARED, fd, (off_t) first);
+    }
+    close(fd);
+    if (base == MAP_FAILED) {
+        free(map->segments);
+        map->segments = NULL;
+        return false;
+    }
+
+    map->mapped = 1;
+    map->memory = base;
+    map->memory_size = (size_t) (end - first);
+    for (k = 0; k < num_segments; k++) {
+        map->segments[k] = (const char *) base + (addresses[k] - first);
+    }
+    return true;
+}
+
+/* Whether the file is a plain file on disk that holds the frames HDF5 wrote */
+static bool is_mappable_file(const ISMRMRD_Dataset *dset) {
+    hid_t fapl, driver;
+    unsigned intent;
+
+    if (dset->options.swmr != ISMRMRD_SWMR_OFF) {
+        return false;
+    }
+    fapl = H5Fget_access_plist(dset->fileid);
+    driver = H5Pget_driver(fapl);
+    H5Pclose(fapl);
+    if (driver != H5FD_SEC2 && !(driver != H5FD_CORE && dset->options.driver == ISMRMRD_DRIVER_IO_URING)) {
+        return false;
+    }
+    /* frames still in the chunk cache are not in the file yet */
+    if (H5Fget_intent(dset->fileid, &intent) < 0 ||
+        ((intent & H5F_ACC_RDWR) && H5Fflush(dset->fileid, H5F_SCOPE_LOCAL) < 0)) {
+        H5Eclear2(H5E_DEFAULT);
+        return false;
+    }
+    return true;
+}
+#endif /* _WIN32 */
+
+int ismrmrd_map_array(const ISMRMRD_Dataset *dset, const char *varname, ISMRMRD_ArrayMap *map) {
+    ISMRMRD_CachedVariable *v;
+    const char *sub;
+    size_t size;
+    int status, n;
+#ifndef _WIN32
+    haddr_t *addresses;
+    uint32_t num_segments;
+#endif
+
+    if (dset==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset pointer should not be NULL.");
+    }
+    if (varname==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Varname should not be NULL.");
+    }
+    if (map==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Map pointer should not be NULL.");
+    }
+    if (dset->cache==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Dataset is not open.");
+    }
+    memset(map, 0, sizeof(*map));
+
+    /* /groupname/varname or /groupname/varname/data */
+    sub = get_frames_sub(dset, varname);
+    status = get_array_properties(dset, varname, sub, &map->ndim, map->dims, &map->data_type);
+    if (status != ISMRMRD_NOERROR) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to get array properties.");
+    }
+    if (map->data_type == 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_TYPEERROR, "Unsupported array data type.");
+    }
+    v = open_variable(dset, varname, sub);
+    map->count = (uint32_t) v->dims[0];
+    map->frame_size = ismrmrd_sizeof_data_type(map->data_type);
+    for (n = 0; n < map->ndim; n++) {
+        map->frame_size *= map->dims[n];
+    }
+    if (map->count == 0) {
+        return ISMRMRD_NOERROR;
+    }
+
+#ifndef _WIN32
+    if (map->frame_size > 0 && is_mappable_file(dset) &&
+        get_frame_addresses(v, dset->cache->ndarray_types[map->data_type], map->count,
+                            &map->segment_frames, &addresses, &num_segments)) {
+        bool mapped = map_frames(dset, addresses, num_segments, map);
+        free(addresses);
+        if (mapped) {
+            return ISMRMRD_NOERROR;
+        }
+    }
+#endif
+
+    /* copy all frames */
+    size = map->count * map->frame_size;
+    map->segment_frames = map->count;
+    map->segments = (const char **) malloc(sizeof(*map->segments));
+    map->memory = malloc(size > 0 ? size : 1);
+    map->memory_size = size;
+    if (map->segments == NULL || map->memory == NULL) {
+        ismrmrd_cleanup_array_map(map);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc array frames.");
+    }
+    map->segments[0] = (const char *) map->memory;
+    status = read_elements(dset, varname, sub, map->memory, dset->cache->ndarray_types[map->data_type], 0, map->count);
+    if (status != ISMRMRD_NOERROR) {
+        ismrmrd_cleanup_array_map(map);
+        return ISMRMRD_PUSH_ERR(ISMRMRD_FILEERROR, "Failed to read array frames.");
+    }
     return ISMRMRD_NOERROR;
 }
 
+const void * ismrmrd_array_map_frame(const ISMRMRD_ArrayMap *map, uint32_t index) {
+    if (map==NULL || index >= map->count) {
+        return NULL;
+    }
+    return map->segments[index / map->segment_frames] + (size_t) (index % map->segment_frames) * map->frame_size;
+}
+
+int ismrmrd_cleanup_array_map(ISMRMRD_ArrayMap *map) {
+    if (map==NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Map pointer should not be NULL.");
+    }
+#ifndef _WIN32
+    if (map->mapped) {
+        munmap(map->memory, map->memory_size);
+    }
+    else
+#endif
+    {
+        free(map->memory);
+    }
+    free(map->segments);
+    memset(map, 0, sizeof(*map));
+    return ISMRMRD_NOERROR;
+}
 
 #ifdef __cplusplus
 } /* extern "C" */
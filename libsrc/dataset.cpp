@@ -5,12 +5,51 @@
 #include <stdlib.h>
 #include <stdexcept>
 
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1800)
+#include <chrono>
+#include <thread>
+#elif defined(WIN32)
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
 namespace ISMRMRD {
+
+// Clock and sleep used to poll a dataset that is being written
+static double now_seconds()
+{
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1800)
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#elif defined(WIN32)
+    return GetTickCount() * 1e-3;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+#endif
+}
+
+static void sleep_seconds(double seconds)
+{
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1800)
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+#elif defined(WIN32)
+    Sleep(static_cast<DWORD>(seconds * 1e3));
+#else
+    usleep(static_cast<useconds_t>(seconds * 1e6));
+#endif
+}
+
 //
 // Dataset class implementation
 //
 // Constructor
 Dataset::Dataset(const char* filename, const char* groupname, bool create_file_if_needed)
+    : acq_buffer_bytes_(0)
+    , acq_buffer_max_count_(0)
+    , acq_buffer_max_bytes_(0)
 {
     // TODO error checking and exception throwing
     // Initialize the dataset
@@ -26,13 +65,69 @@ Dataset::Dataset(const char* filename, const char* groupname, bool create_file_i
     }
 }
 
-// Destructor
-Dataset::~Dataset()
+Dataset::Dataset(const char* filename, const char* groupname, bool create_file_if_needed,
+                 const DatasetOptions &options)
+    : acq_buffer_bytes_(0)
+    , acq_buffer_max_count_(0)
+    , acq_buffer_max_bytes_(0)
+{
+    // Initialize the dataset
+    int status;
+    status = ismrmrd_init_dataset(&dset_, filename, groupname);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    dset_.options = options;
+    // Open the file
+    status = ismrmrd_open_dataset(&dset_, create_file_if_needed);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+Dataset::Dataset(const char* filename, const char* groupname, const void *image, size_t size)
+    : acq_buffer_bytes_(0)
+    , acq_buffer_max_count_(0)
+    , acq_buffer_max_bytes_(0)
+{
+    int status;
+    status = ismrmrd_init_dataset(&dset_, filename, groupname);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    status = ismrmrd_open_dataset_from_image(&dset_, image, size);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+Dataset::Dataset(const char* filename, const char* groupname, const void *image, size_t size,
+                 const DatasetOptions &options)
+    : acq_buffer_bytes_(0)
+    , acq_buffer_max_count_(0)
+    , acq_buffer_max_bytes_(0)
 {
-    int status = ismrmrd_close_dataset(&dset_);
+    int status;
+    status = ismrmrd_init_dataset(&dset_, filename, groupname);
     if (status != ISMRMRD_NOERROR) {
         throw std::runtime_error(build_exception_string());
     }
+    dset_.options = options;
+    status = ismrmrd_open_dataset_from_image(&dset_, image, size);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+// Destructor
+Dataset::~Dataset()
+{
+    // Errors stay on the error stack and reach the error handler, a
+    // destructor must not throw
+    if (!acq_buffer_.empty()) {
+        ismrmrd_append_acquisitions(&dset_, reinterpret_cast<const ISMRMRD_Acquisition*>(&acq_buffer_[0]), acq_buffer_.size());
+    }
+    ismrmrd_close_dataset(&dset_);
 }
 
 // XML Header
@@ -54,29 +149,226 @@ void Dataset::readHeader(std::string& xmlstring){
     }
 }
 
+// Groups
+std::vector<std::string> Dataset::listGroups()
+{
+    uint32_t count = 0;
+    char **names = ismrmrd_list_groups(&dset_, &count);
+    if (NULL == names) {
+        throw std::runtime_error(build_exception_string());
+    }
+    std::vector<std::string> groups(names, names + count);
+    free(names);
+    return groups;
+}
+
 // Acquisitions
 void Dataset::appendAcquisition(const Acquisition &acq)
 {
+    if (acq_buffer_max_count_ > 0 || acq_buffer_max_bytes_ > 0) {
+        acq_buffer_.push_back(acq);
+        acq_buffer_bytes_ += sizeof(ISMRMRD_AcquisitionHeader) +
+            ismrmrd_size_of_acquisition_traj(&acq.acq) + ismrmrd_size_of_acquisition_data(&acq.acq);
+        if ((acq_buffer_max_count_ > 0 && acq_buffer_.size() >= acq_buffer_max_count_) ||
+            (acq_buffer_max_bytes_ > 0 && acq_buffer_bytes_ >= acq_buffer_max_bytes_)) {
+            flush();
+        }
+        return;
+    }
     int status = ismrmrd_append_acquisition(&dset_, reinterpret_cast<const ISMRMRD_Acquisition*>(&acq));
     if (status != ISMRMRD_NOERROR) {
         throw std::runtime_error(build_exception_string());
     }
 }
 
+void Dataset::appendAcquisitions(const std::vector<Acquisition> &acqs)
+{
+    flush();
+    if (acqs.empty()) {
+        return;
+    }
+    int status = ismrmrd_append_acquisitions(&dset_, reinterpret_cast<const ISMRMRD_Acquisition*>(&acqs[0]), acqs.size());
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
 void Dataset::readAcquisition(uint32_t index, Acquisition & acq) {
+    flush();
     int status = ismrmrd_read_acquisition(&dset_, index, reinterpret_cast<ISMRMRD_Acquisition*>(&acq));
     if (status != ISMRMRD_NOERROR) {
         throw std::runtime_error(build_exception_string());
     }
 }
 
+void Dataset::readAcquisitions(uint32_t start, uint32_t count, std::vector<Acquisition> &acqs) {
+    flush();
+    acqs.resize(count);
+    if (count == 0) {
+        return;
+    }
+    int status = ismrmrd_read_acquisitions(&dset_, start, count, reinterpret_cast<ISMRMRD_Acquisition*>(&acqs[0]));
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+void Dataset::readAcquisitionHeaders(uint32_t start, uint32_t count, std::vector<AcquisitionHeader> &heads) {
+    flush();
+    heads.resize(count);
+    if (count == 0) {
+        return;
+    }
+    int status = ismrmrd_read_acquisition_headers(&dset_, start, count, &heads[0]);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
 
 uint32_t Dataset::getNumberOfAcquisitions()
 {
+    flush();
     uint32_t num = ismrmrd_get_number_of_acquisitions(&dset_);
     return num;
 }
 
+// Acquisition index
+void Dataset::buildAcquisitionIndex()
+{
+    flush();
+    int status = ismrmrd_build_acquisition_index(&dset_);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+void Dataset::findAcquisitions(const AcquisitionQuery &query, std::vector<uint32_t> &rows)
+{
+    flush();
+    uint32_t *found = NULL;
+    uint32_t count = 0;
+    int status = ismrmrd_find_acquisitions(&dset_, &query, &found, &count);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    rows.assign(found, found + count);
+    free(found);
+}
+
+// Filtered acquisition cursor
+AcquisitionCursor::AcquisitionCursor(Dataset &dataset, const AcquisitionQuery &query, uint32_t batch_size)
+    : dataset_(dataset)
+{
+    dataset_.flush();
+    int status = ismrmrd_init_acquisition_cursor(&cursor_, &dataset_.dset_, &query, batch_size);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+AcquisitionCursor::~AcquisitionCursor()
+{
+    ismrmrd_cleanup_acquisition_cursor(&cursor_);
+}
+
+bool AcquisitionCursor::next(Acquisition &acq)
+{
+    dataset_.flush();
+    uint32_t count = 0;
+    int status = ismrmrd_acquisition_cursor_next(&cursor_, reinterpret_cast<ISMRMRD_Acquisition*>(&acq), NULL, 1, &count);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    return count > 0;
+}
+
+bool AcquisitionCursor::next(std::vector<Acquisition> &acqs, std::vector<uint32_t> &rows, uint32_t max)
+{
+    dataset_.flush();
+    uint32_t count = 0;
+    acqs.resize(max);
+    rows.resize(max);
+    if (max > 0) {
+        int status = ismrmrd_acquisition_cursor_next(&cursor_, reinterpret_cast<ISMRMRD_Acquisition*>(&acqs[0]),
+                                                     &rows[0], max, &count);
+        if (status != ISMRMRD_NOERROR) {
+            throw std::runtime_error(build_exception_string());
+        }
+    }
+    acqs.resize(count);
+    rows.resize(count);
+    return count > 0;
+}
+
+// Write-behind buffering
+void Dataset::setAcquisitionBuffering(size_t max_acquisitions, size_t max_bytes)
+{
+    flush();
+    acq_buffer_max_count_ = max_acquisitions;
+    acq_buffer_max_bytes_ = max_bytes;
+    acq_buffer_.reserve(max_acquisitions);
+}
+
+void Dataset::flush()
+{
+    if (acq_buffer_.empty()) {
+        return;
+    }
+    int status = ismrmrd_append_acquisitions(&dset_, reinterpret_cast<const ISMRMRD_Acquisition*>(&acq_buffer_[0]), acq_buffer_.size());
+    acq_buffer_.clear();
+    acq_buffer_bytes_ = 0;
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+// File image
+void Dataset::getFileImage(std::vector<char> &image)
+{
+    flush();
+    void *buffer;
+    size_t size;
+    int status = ismrmrd_get_file_image(&dset_, &buffer, &size);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    image.assign(static_cast<char *>(buffer), static_cast<char *>(buffer) + size);
+    free(buffer);
+}
+
+// Streaming
+void Dataset::refresh()
+{
+    int status = ismrmrd_refresh_dataset(&dset_);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+bool Dataset::waitForAcquisitions(uint32_t n, double timeout_seconds)
+{
+    // poll quickly at first and back off to 10 ms while the writer is idle
+    const double max_interval = 10e-3;
+    double interval = 100e-6;
+    double deadline = now_seconds() + timeout_seconds;
+    for (;;) {
+        refresh();
+        if (getNumberOfAcquisitions() >= n) {
+            return true;
+        }
+        double now = now_seconds();
+        if (timeout_seconds >= 0 && now >= deadline) {
+            return false;
+        }
+        if (timeout_seconds >= 0 && deadline - now < interval) {
+            sleep_seconds(deadline - now);
+        } else {
+            sleep_seconds(interval);
+        }
+        interval = interval * 2 < max_interval ? interval * 2 : max_interval;
+    }
+}
+
 // Images
 template <typename T>void Dataset::appendImage(const std::string &var, const Image<T> &im)
 {
@@ -111,6 +403,76 @@ template <typename T> void Dataset::readImage(const std::string &var, uint32_t i
     }
 }
 
+// Specific instantiations
+template EXPORTISMRMRD void Dataset::readImage(const std::string &var, uint32_t index, Image<uint16_t> &im);
+template EXPORTISMRMRD void Dataset::readImage(const std::string &var, uint32_t index, Image<int16_t> &im);
+template EXPORTISMRMRD void Dataset::readImage(const std::string &var, uint32_t index, Image<uint32_t> &im);
+template EXPORTISMRMRD void Dataset::readImage(const std::string &var, uint32_t index, Image<int32_t> &im);
+template EXPORTISMRMRD void Dataset::readImage(const std::string &var, uint32_t index, Image<float> &im);
+template EXPORTISMRMRD void Dataset::readImage(const std::string &var, uint32_t index, Image<double> &im);
+template EXPORTISMRMRD void Dataset::readImage(const std::string &var, uint32_t index, Image<complex_float_t> &im);
+template EXPORTISMRMRD void Dataset::readImage(const std::string &var, uint32_t index, Image<complex_double_t> &im);
+
+template <typename T> void Dataset::appendImages(const std::string &var, const std::vector<Image<T> > &ims)
+{
+    if (ims.empty()) {
+        return;
+    }
+    int status = ismrmrd_append_images(&dset_, var.c_str(), reinterpret_cast<const ISMRMRD_Image*>(&ims[0]), ims.size());
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+void Dataset::appendImages(const std::string &var, const ISMRMRD_Image *ims, uint32_t count)
+{
+    int status = ismrmrd_append_images(&dset_, var.c_str(), ims, count);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+// Specific instantiations
+template EXPORTISMRMRD void Dataset::appendImages(const std::string &var, const std::vector<Image<uint16_t> > &ims);
+template EXPORTISMRMRD void Dataset::appendImages(const std::string &var, const std::vector<Image<int16_t> > &ims);
+template EXPORTISMRMRD void Dataset::appendImages(const std::string &var, const std::vector<Image<uint32_t> > &ims);
+template EXPORTISMRMRD void Dataset::appendImages(const std::string &var, const std::vector<Image<int32_t> > &ims);
+template EXPORTISMRMRD void Dataset::appendImages(const std::string &var, const std::vector<Image<float> > &ims);
+template EXPORTISMRMRD void Dataset::appendImages(const std::string &var, const std::vector<Image<double> > &ims);
+template EXPORTISMRMRD void Dataset::appendImages(const std::string &var, const std::vector<Image<complex_float_t> > &ims);
+template EXPORTISMRMRD void Dataset::appendImages(const std::string &var, const std::vector<Image<complex_double_t> > &ims);
+
+template <typename T> void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count,
+                                               std::vector<Image<T> > &ims)
+{
+    ims.resize(count);
+    if (count == 0) {
+        return;
+    }
+    int status = ismrmrd_read_images(&dset_, var.c_str(), start, count, reinterpret_cast<ISMRMRD_Image*>(&ims[0]));
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, ISMRMRD_Image *ims)
+{
+    int status = ismrmrd_read_images(&dset_, var.c_str(), start, count, ims);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+}
+
+// Specific instantiations
+template EXPORTISMRMRD void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<uint16_t> > &ims);
+template EXPORTISMRMRD void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<int16_t> > &ims);
+template EXPORTISMRMRD void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<uint32_t> > &ims);
+template EXPORTISMRMRD void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<int32_t> > &ims);
+template EXPORTISMRMRD void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<float> > &ims);
+template EXPORTISMRMRD void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<double> > &ims);
+template EXPORTISMRMRD void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<complex_float_t> > &ims);
+template EXPORTISMRMRD void Dataset::readImages(const std::string &var, uint32_t start, uint32_t count, std::vector<Image<complex_double_t> > &ims);
+
 uint32_t Dataset::getNumberOfImages(const std::string &var)
 {
     uint32_t num =  ismrmrd_get_number_of_images(&dset_, var.c_str());
@@ -152,10 +514,97 @@ template <typename T> void Dataset::readNDArray(const std::string &var, uint32_t
     }
 }
 
+// Specific instantiations
+template EXPORTISMRMRD void Dataset::readNDArray(const std::string &var, uint32_t index, NDArray<uint16_t> &arr);
+template EXPORTISMRMRD void Dataset::readNDArray(const std::string &var, uint32_t index, NDArray<int16_t> &arr);
+template EXPORTISMRMRD void Dataset::readNDArray(const std::string &var, uint32_t index, NDArray<uint32_t> &arr);
+template EXPORTISMRMRD void Dataset::readNDArray(const std::string &var, uint32_t index, NDArray<int32_t> &arr);
+template EXPORTISMRMRD void Dataset::readNDArray(const std::string &var, uint32_t index, NDArray<float> &arr);
+template EXPORTISMRMRD void Dataset::readNDArray(const std::string &var, uint32_t index, NDArray<double> &arr);
+template EXPORTISMRMRD void Dataset::readNDArray(const std::string &var, uint32_t index, NDArray<complex_float_t> &arr);
+template EXPORTISMRMRD void Dataset::readNDArray(const std::string &var, uint32_t index, NDArray<complex_double_t> &arr);
+
 uint32_t Dataset::getNumberOfNDArrays(const std::string &var)
 {
     uint32_t num = ismrmrd_get_number_of_arrays(&dset_, var.c_str());
     return num;
 }
 
+template <typename T> void Dataset::mapNDArray(const std::string &var, NDArrayView<T> &view)
+{
+    ismrmrd_cleanup_array_map(&view.map_);
+    int status = ismrmrd_map_array(&dset_, var.c_str(), &view.map_);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    if (view.map_.data_type != get_data_type<T>()) {
+        ismrmrd_cleanup_array_map(&view.map_);
+        throw std::runtime_error("Data type of the array frames does not match the view.");
+    }
+}
+
+// Specific instantiations
+template EXPORTISMRMRD void Dataset::mapNDArray(const std::string &var, NDArrayView<uint16_t> &view);
+template EXPORTISMRMRD void Dataset::mapNDArray(const std::string &var, NDArrayView<int16_t> &view);
+template EXPORTISMRMRD void Dataset::mapNDArray(const std::string &var, NDArrayView<uint32_t> &view);
+template EXPORTISMRMRD void Dataset::mapNDArray(const std::string &var, NDArrayView<int32_t> &view);
+template EXPORTISMRMRD void Dataset::mapNDArray(const std::string &var, NDArrayView<float> &view);
+template EXPORTISMRMRD void Dataset::mapNDArray(const std::string &var, NDArrayView<double> &view);
+template EXPORTISMRMRD void Dataset::mapNDArray(const std::string &var, NDArrayView<complex_float_t> &view);
+template EXPORTISMRMRD void Dataset::mapNDArray(const std::string &var, NDArrayView<complex_double_t> &view);
+
+// NDArray views
+template <typename T> NDArrayView<T>::NDArrayView()
+{
+    memset(&map_, 0, sizeof(map_));
+}
+
+template <typename T> NDArrayView<T>::~NDArrayView()
+{
+    ismrmrd_cleanup_array_map(&map_);
+}
+
+template <typename T> uint32_t NDArrayView<T>::getNumberOfFrames() const
+{
+    return map_.count;
+}
+
+template <typename T> uint16_t NDArrayView<T>::getNDim() const
+{
+    return map_.ndim;
+}
+
+template <typename T> const size_t (&NDArrayView<T>::getDims() const)[ISMRMRD_NDARRAY_MAXDIM]
+{
+    return map_.dims;
+}
+
+template <typename T> size_t NDArrayView<T>::getNumberOfElements() const
+{
+    return map_.frame_size / sizeof(T);
+}
+
+template <typename T> const T * NDArrayView<T>::getFrame(uint32_t index) const
+{
+    if (index >= map_.count) {
+        throw std::runtime_error("Frame index out of range.");
+    }
+    return static_cast<const T *>(ismrmrd_array_map_frame(&map_, index));
+}
+
+template <typename T> bool NDArrayView<T>::isMapped() const
+{
+    return map_.mapped != 0;
+}
+
+// Specific instantiations
+template EXPORTISMRMRD class NDArrayView<uint16_t>;
+template EXPORTISMRMRD class NDArrayView<int16_t>;
+template EXPORTISMRMRD class NDArrayView<uint32_t>;
+template EXPORTISMRMRD class NDArrayView<int32_t>;
+template EXPORTISMRMRD class NDArrayView<float>;
+template EXPORTISMRMRD class NDArrayView<double>;
+template EXPORTISMRMRD class NDArrayView<complex_float_t>;
+template EXPORTISMRMRD class NDArrayView<complex_double_t>;
+
 } // namespace ISMRMRD
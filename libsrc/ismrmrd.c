@@ -21,21 +21,61 @@ namespace ISMRMRD {
 extern "C" {
 #endif
 
+/* Thread-local storage */
+#if defined(__cplusplus) && __cplusplus >= 201103L
+#define ISMRMRD_THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+#define ISMRMRD_THREAD_LOCAL __declspec(thread)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define ISMRMRD_THREAD_LOCAL _Thread_local
+#else /* GCC and Clang in C99 mode */
+#define ISMRMRD_THREAD_LOCAL __thread
+#endif
+
+/* Atomic access to the error handler, which any thread may replace */
+#if defined(__GNUC__)
+#define ISMRMRD_LOAD_HANDLER(h) __atomic_load_n(&(h), __ATOMIC_ACQUIRE)
+#define ISMRMRD_STORE_HANDLER(h, v) __atomic_store_n(&(h), (v), __ATOMIC_RELEASE)
+#else /* aligned pointer access is atomic on the supported MSVC targets */
+#define ISMRMRD_LOAD_HANDLER(h) (*(ismrmrd_error_handler_t volatile *) &(h))
+#define ISMRMRD_STORE_HANDLER(h, v) (*(ismrmrd_error_handler_t volatile *) &(h) = (v))
+#endif
+
 /* Error handling prototypes */
-typedef struct ISMRMRD_error_node {
-    struct ISMRMRD_error_node *next;
-    char *file;
-    char *func;
-    char *msg;
+/* Number of errors kept per thread, older errors are overwritten */
+#define ISMRMRD_ERROR_STACK_SIZE 32
+
+typedef struct ISMRMRD_error_record {
+    const char *file;
+    const char *func;
+    const char *msg;
     int line;
     int code;
-} ISMRMRD_error_node_t;
+} ISMRMRD_error_record_t;
 
 static void ismrmrd_error_default(const char *file, int line,
         const char *func, int code, const char *msg);
-static ISMRMRD_error_node_t *error_stack_head = NULL;
+static ISMRMRD_THREAD_LOCAL ISMRMRD_error_record_t error_stack[ISMRMRD_ERROR_STACK_SIZE];
+static ISMRMRD_THREAD_LOCAL unsigned int error_stack_top = 0;   /* slot of the next push */
+static ISMRMRD_THREAD_LOCAL unsigned int error_stack_count = 0;
 static ismrmrd_error_handler_t ismrmrd_error_handler = ismrmrd_error_default;
 
+/* Payload allocator, see ismrmrd_set_allocator */
+static void *ismrmrd_default_malloc(size_t size, void *ctx);
+static void *ismrmrd_default_realloc(void *ptr, size_t size, void *ctx);
+static void ismrmrd_default_free(void *ptr, void *ctx);
+
+typedef struct ISMRMRD_Allocator {
+    ismrmrd_malloc_t alloc;
+    ismrmrd_realloc_t realloc_fn;
+    ismrmrd_free_t free_fn;
+    void *ctx;
+} ISMRMRD_Allocator;
+
+static ISMRMRD_Allocator ismrmrd_allocator = {
+    ismrmrd_default_malloc, ismrmrd_default_realloc, ismrmrd_default_free, NULL
+};
+
 
 /* Acquisition functions */
 int ismrmrd_init_acquisition_header(ISMRMRD_AcquisitionHeader *hdr) {
@@ -66,9 +106,9 @@ int ismrmrd_cleanup_acquisition(ISMRMRD_Acquisition *acq) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
     }
     
-    free(acq->data);
+    ismrmrd_free(acq->data);
     acq->data = NULL;
-    free(acq->traj);
+    ismrmrd_free(acq->traj);
     acq->traj = NULL;
     return ISMRMRD_NOERROR;
 }
@@ -133,7 +173,7 @@ int ismrmrd_make_consistent_acquisition(ISMRMRD_Acquisition *acq) {
     
     traj_size = ismrmrd_size_of_acquisition_traj(acq);
     if (traj_size > 0) {
-        acq->traj = (float *)realloc(acq->traj, traj_size);
+        acq->traj = (float *)ismrmrd_realloc(acq->traj, traj_size);
         if (acq->traj == NULL) {
             return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR,
                           "Failed to realloc acquisition trajectory array");
@@ -142,7 +182,7 @@ int ismrmrd_make_consistent_acquisition(ISMRMRD_Acquisition *acq) {
         
     data_size = ismrmrd_size_of_acquisition_data(acq);
     if (data_size > 0) {
-        acq->data = (complex_float_t *)realloc(acq->data, data_size);
+        acq->data = (complex_float_t *)ismrmrd_realloc(acq->data, data_size);
         if (acq->data == NULL) {
             return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR,
                           "Failed to realloc acquisition data array");
@@ -225,9 +265,9 @@ int ismrmrd_cleanup_image(ISMRMRD_Image *im) {
     if (im==NULL) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not NULL.");
     }
-    free(im->attribute_string);
+    ismrmrd_free(im->attribute_string);
     im->attribute_string = NULL;
-    free(im->data);
+    ismrmrd_free(im->data);
     im->data = NULL;
     return ISMRMRD_NOERROR;
 }
@@ -268,7 +308,7 @@ int ismrmrd_make_consistent_image(ISMRMRD_Image *im) {
    
     attr_size = ismrmrd_size_of_image_attribute_string(im);
     if (attr_size > 0) {
-        im->attribute_string = (char *)realloc(im->attribute_string, attr_size);
+        im->attribute_string = (char *)ismrmrd_realloc(im->attribute_string, attr_size);
         if (im->attribute_string == NULL) {
             return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to realloc image attribute string");
         }
@@ -276,7 +316,7 @@ int ismrmrd_make_consistent_image(ISMRMRD_Image *im) {
         
     data_size = ismrmrd_size_of_image_data(im);
     if (data_size > 0) {
-        im->data = realloc(im->data, data_size);
+        im->data = ismrmrd_realloc(im->data, data_size);
         if (im->data == NULL) {
             return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to realloc image data array");
         }
@@ -352,7 +392,7 @@ int ismrmrd_cleanup_ndarray(ISMRMRD_NDArray *arr) {
         return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
     }
 
-    free(arr->data);
+    ismrmrd_free(arr->data);
     arr->data = NULL;
     return ISMRMRD_NOERROR;
 }
@@ -402,7 +442,7 @@ int ismrmrd_make_consistent_ndarray(ISMRMRD_NDArray *arr) {
 
     data_size = ismrmrd_size_of_ndarray_data(arr);
     if (data_size > 0) {
-        arr->data = realloc(arr->data, data_size);
+        arr->data = ismrmrd_realloc(arr->data, data_size);
         if (arr->data == NULL) {
             return ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to realloc NDArray data array");
         }
@@ -657,34 +697,32 @@ void ismrmrd_quaternion_to_directions(float quat[4], float read_dir[3],
 }
 
 /**
- * Saves error information on the error stack
+ * Saves error information on the calling thread's error stack
  * @returns error code
  */
 int ismrmrd_push_error(const char *file, const int line, const char *func,
         const int code, const char *msg)
 {
-    ISMRMRD_error_node_t *node = NULL;
+    ISMRMRD_error_record_t *record = NULL;
+    ismrmrd_error_handler_t handler = ISMRMRD_LOAD_HANDLER(ismrmrd_error_handler);
 
     /* Call user-defined error handler if it exists */
-    if (ismrmrd_error_handler != NULL) {
-        ismrmrd_error_handler(file, line, func, code, msg);
+    if (handler != NULL) {
+        handler(file, line, func, code, msg);
     }
 
-    /* Save error information on error stack */
-    node = (ISMRMRD_error_node_t*)calloc(1, sizeof(*node));
-    if (node == NULL) {
-        /* TODO: how to handle this? */
-        return ISMRMRD_MEMORYERROR;
+    /* Save error information on error stack, overwriting the oldest error when full */
+    record = &error_stack[error_stack_top];
+    error_stack_top = (error_stack_top + 1) % ISMRMRD_ERROR_STACK_SIZE;
+    if (error_stack_count < ISMRMRD_ERROR_STACK_SIZE) {
+        error_stack_count++;
     }
 
-    node->next = error_stack_head;
-    error_stack_head = node;
-
-    node->file = (char*)file;
-    node->line = line;
-    node->func = (char*)func;
-    node->code = code;
-    node->msg = (char*)msg;
+    record->file = file;
+    record->line = line;
+    record->func = func;
+    record->code = code;
+    record->msg = msg;
 
     return code;
 }
@@ -692,37 +730,144 @@ int ismrmrd_push_error(const char *file, const int line, const char *func,
 bool ismrmrd_pop_error(char **file, int *line, char **func,
         int *code, char **msg)
 {
-    ISMRMRD_error_node_t *node = error_stack_head;
-    if (node == NULL) {
+    ISMRMRD_error_record_t *record = NULL;
+    if (error_stack_count == 0) {
         /* nothing to pop */
         return false;
     }
 
-    /* pop head off stack */
-    error_stack_head = node->next;
+    /* pop the most recent error */
+    error_stack_top = (error_stack_top + ISMRMRD_ERROR_STACK_SIZE - 1) % ISMRMRD_ERROR_STACK_SIZE;
+    error_stack_count--;
+    record = &error_stack[error_stack_top];
 
     if (file != NULL) {
-        *file = node->file;
+        *file = (char*)record->file;
     }
     if (line != NULL) {
-        *line = node->line;
+        *line = record->line;
     }
     if (func != NULL) {
-        *func = node->func;
+        *func = (char*)record->func;
     }
     if (code != NULL) {
-        *code = node->code;
+        *code = record->code;
     }
     if (msg != NULL) {
-        *msg = node->msg;
+        *msg = (char*)record->msg;
     }
 
-    free(node);
     return true;
 }
 
 void ismrmrd_set_error_handler(ismrmrd_error_handler_t handler) {
-    ismrmrd_error_handler = handler;
+    ISMRMRD_STORE_HANDLER(ismrmrd_error_handler, handler);
+}
+
+/* The default allocator is the C heap, so payload buffers can be freed and
+   replaced by callers with malloc and free as before allocators existed */
+static void *ismrmrd_default_malloc(size_t size, void *ctx) {
+    (void) ctx;
+    return malloc(size);
+}
+
+static void *ismrmrd_default_realloc(void *ptr, size_t size, void *ctx) {
+    (void) ctx;
+    return realloc(ptr, size);
+}
+
+static void ismrmrd_default_free(void *ptr, void *ctx) {
+    (void) ctx;
+    free(ptr);
+}
+
+/* The aligned allocator aligns the buffers it gets from malloc, a buffer is
+   preceded by 1 to ISMRMRD_PAYLOAD_ALIGNMENT bytes of padding and the byte
+   just before the buffer holds the length of the padding */
+static char *ismrmrd_align_payload(char *block) {
+    return (char *) (((size_t) block + ISMRMRD_PAYLOAD_ALIGNMENT) & ~(size_t) (ISMRMRD_PAYLOAD_ALIGNMENT - 1));
+}
+
+void *ismrmrd_aligned_malloc(size_t size, void *ctx) {
+    char *block, *p;
+
+    (void) ctx;
+    if (size > (size_t) -1 - ISMRMRD_PAYLOAD_ALIGNMENT) {
+        return NULL;
+    }
+    block = (char *) malloc(size + ISMRMRD_PAYLOAD_ALIGNMENT);
+    if (block == NULL) {
+        return NULL;
+    }
+    p = ismrmrd_align_payload(block);
+    p[-1] = (char) (p - block);
+    return p;
+}
+
+void *ismrmrd_aligned_realloc(void *ptr, size_t size, void *ctx) {
+    char *block, *p;
+    size_t padding;
+
+    if (ptr == NULL) {
+        return ismrmrd_aligned_malloc(size, ctx);
+    }
+    if (size > (size_t) -1 - ISMRMRD_PAYLOAD_ALIGNMENT) {
+        return NULL;
+    }
+    padding = (unsigned char) ((char *) ptr)[-1];
+    block = (char *) realloc((char *) ptr - padding, size + ISMRMRD_PAYLOAD_ALIGNMENT);
+    if (block == NULL) {
+        return NULL;
+    }
+    /* realloc keeps the alignment of malloc only, move the buffer if the padding changed */
+    p = ismrmrd_align_payload(block);
+    if ((size_t) (p - block) != padding) {
+        memmove(p, block + padding, size);
+    }
+    p[-1] = (char) (p - block);
+    return p;
+}
+
+void ismrmrd_aligned_free(void *ptr, void *ctx) {
+    (void) ctx;
+    if (ptr != NULL) {
+        free((char *) ptr - (unsigned char) ((char *) ptr)[-1]);
+    }
+}
+
+int ismrmrd_set_allocator(ismrmrd_malloc_t alloc, ismrmrd_realloc_t realloc_fn,
+        ismrmrd_free_t free_fn, void *ctx) {
+    if (alloc == NULL && realloc_fn == NULL && free_fn == NULL) {
+        alloc = ismrmrd_default_malloc;
+        realloc_fn = ismrmrd_default_realloc;
+        free_fn = ismrmrd_default_free;
+        ctx = NULL;
+    } else if (alloc == NULL || realloc_fn == NULL || free_fn == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Allocator functions should all be set or all be NULL.");
+    }
+    ismrmrd_allocator.alloc = alloc;
+    ismrmrd_allocator.realloc_fn = realloc_fn;
+    ismrmrd_allocator.free_fn = free_fn;
+    ismrmrd_allocator.ctx = ctx;
+    return ISMRMRD_NOERROR;
+}
+
+void *ismrmrd_malloc(size_t size) {
+    return ismrmrd_allocator.alloc(size, ismrmrd_allocator.ctx);
+}
+
+void *ismrmrd_realloc(void *ptr, size_t size) {
+    return ismrmrd_allocator.realloc_fn(ptr, size, ismrmrd_allocator.ctx);
+}
+
+void ismrmrd_free(void *ptr) {
+    if (ptr != NULL) {
+        ismrmrd_allocator.free_fn(ptr, ismrmrd_allocator.ctx);
+    }
+}
+
+bool ismrmrd_is_aligned(const void *ptr) {
+    return ((size_t) ptr & (ISMRMRD_PAYLOAD_ALIGNMENT - 1)) == 0;
 }
 
 char *ismrmrd_strerror(int code) {
@@ -81,14 +81,10 @@ Acquisition::Acquisition(const Acquisition &other) {
 }
 
 Acquisition & Acquisition::operator= (const Acquisition &other) {
-    // Assignment makes a copy
+    // Assignment makes a copy into the existing buffers
     int err = 0;
     if (this != &other )
     {
-        err = ismrmrd_init_acquisition(&acq);
-        if (err) {
-            throw std::runtime_error(build_exception_string());
-        }
         err = ismrmrd_copy_acquisition(&acq, &other.acq);
         if (err) {
             throw std::runtime_error(build_exception_string());
@@ -97,12 +93,54 @@ Acquisition & Acquisition::operator= (const Acquisition &other) {
     return *this;
 }
 
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+Acquisition::Acquisition(Acquisition &&other) noexcept {
+    acq = other.acq;
+    ismrmrd_init_acquisition(&other.acq);
+}
+
+Acquisition & Acquisition::operator= (Acquisition &&other) noexcept {
+    if (this != &other) {
+        ismrmrd_cleanup_acquisition(&acq);
+        acq = other.acq;
+        ismrmrd_init_acquisition(&other.acq);
+    }
+    return *this;
+}
+#endif
+
 Acquisition::~Acquisition() {
     if (ismrmrd_cleanup_acquisition(&acq) != ISMRMRD_NOERROR) {
         throw std::runtime_error(build_exception_string());
     }
 }
 
+// Ownership transfer
+void Acquisition::swap(Acquisition &other) {
+    ISMRMRD_Acquisition tmp = acq;
+    acq = other.acq;
+    other.acq = tmp;
+}
+
+void Acquisition::release(ISMRMRD_Acquisition *dest) {
+    if (dest == NULL) {
+        throw std::runtime_error("Acquisition pointer should not be NULL");
+    }
+    *dest = acq;
+    ismrmrd_init_acquisition(&acq);
+}
+
+void Acquisition::adopt(ISMRMRD_Acquisition *src) {
+    if (src == NULL) {
+        throw std::runtime_error("Acquisition pointer should not be NULL");
+    }
+    if (src != &acq) {
+        ismrmrd_cleanup_acquisition(&acq);
+        acq = *src;
+        ismrmrd_init_acquisition(src);
+    }
+}
+
 // Accessors and mutators
 const uint16_t &Acquisition::version() {
     return acq.head.version;
@@ -221,6 +259,10 @@ const size_t Acquisition::getTrajSize() {
     return num*sizeof(float);
 }
 
+bool Acquisition::isAligned() const {
+    return ismrmrd_is_aligned(acq.data) && ismrmrd_is_aligned(acq.traj);
+}
+
 // Data and Trajectory accessors
 const AcquisitionHeader & Acquisition::getHead() {
     // This returns a reference
@@ -375,13 +417,9 @@ template <typename T> Image<T>::Image(const Image<T> &other) {
 template <typename T> Image<T> & Image<T>::operator= (const Image<T> &other)
 {
     int err = 0;
-    // Assignment makes a copy
+    // Assignment makes a copy into the existing buffers
     if (this != &other )
     {
-        err = ismrmrd_init_image(&im);
-        if (err) {
-            throw std::runtime_error(build_exception_string());
-        }
         err = ismrmrd_copy_image(&im, &other.im);
         if (err) {
             throw std::runtime_error(build_exception_string());
@@ -390,12 +428,60 @@ template <typename T> Image<T> & Image<T>::operator= (const Image<T> &other)
     return *this;
 }
 
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+template <typename T> Image<T>::Image(Image<T> &&other) noexcept {
+    im = other.im;
+    ismrmrd_init_image(&other.im);
+    other.im.head.data_type = get_data_type<T>();
+}
+
+template <typename T> Image<T> & Image<T>::operator= (Image<T> &&other) noexcept {
+    if (this != &other) {
+        ismrmrd_cleanup_image(&im);
+        im = other.im;
+        ismrmrd_init_image(&other.im);
+        other.im.head.data_type = get_data_type<T>();
+    }
+    return *this;
+}
+#endif
+
 template <typename T> Image<T>::~Image() {
     if (ismrmrd_cleanup_image(&im) != ISMRMRD_NOERROR) {
         throw std::runtime_error(build_exception_string());
     }
 }
 
+// Ownership transfer
+template <typename T> void Image<T>::swap(Image<T> &other) {
+    ISMRMRD_Image tmp = im;
+    im = other.im;
+    other.im = tmp;
+}
+
+template <typename T> void Image<T>::release(ISMRMRD_Image *dest) {
+    if (dest == NULL) {
+        throw std::runtime_error("Image pointer should not be NULL");
+    }
+    *dest = im;
+    ismrmrd_init_image(&im);
+    im.head.data_type = get_data_type<T>();
+}
+
+template <typename T> void Image<T>::adopt(ISMRMRD_Image *src) {
+    if (src == NULL) {
+        throw std::runtime_error("Image pointer should not be NULL");
+    }
+    if (src->head.data_type != get_data_type<T>()) {
+        throw std::runtime_error("Image data type does not match");
+    }
+    if (src != &im) {
+        ismrmrd_cleanup_image(&im);
+        im = *src;
+        ismrmrd_init_image(src);
+    }
+}
+
 // Image dimensions
 template <typename T> void Image<T>::resize(uint16_t matrix_size_x,
                                             uint16_t matrix_size_y,
@@ -913,7 +999,7 @@ template <typename T> void Image<T>::getAttributeString(std::string &attr) const
 template <typename T> void Image<T>::setAttributeString(const std::string attr)
 {
     im.head.attribute_string_len = attr.length();
-    im.attribute_string = (char *)realloc(im.attribute_string, attr.length()+1);
+    im.attribute_string = (char *)ismrmrd_realloc(im.attribute_string, attr.length()+1);
     // TODO error check?
     strcpy(im.attribute_string, attr.c_str());
 }
@@ -941,6 +1027,10 @@ template <typename T> size_t Image<T>::getDataSize() const {
     return ismrmrd_size_of_image_data(&im);
 }
 
+template <typename T> bool Image<T>::isAligned() const {
+    return ismrmrd_is_aligned(im.data);
+}
+
 template <typename T> T * Image<T>::begin() {
      return static_cast<T*>(im.data);
 }
@@ -1000,13 +1090,9 @@ template <typename T> NDArray<T>::~NDArray()
 template <typename T> NDArray<T> & NDArray<T>::operator= (const NDArray<T> &other)
 {
     int err = 0;
-    // Assignment makes a copy
+    // Assignment makes a copy into the existing buffer
     if (this != &other )
     {
-        err = ismrmrd_init_ndarray(&arr);
-        if (err) {
-            throw std::runtime_error(build_exception_string());
-        }
         err = ismrmrd_copy_ndarray(&arr, &other.arr);
         if (err) {
             throw std::runtime_error(build_exception_string());
@@ -1015,6 +1101,59 @@ template <typename T> NDArray<T> & NDArray<T>::operator= (const NDArray<T> &othe
     return *this;
 }
 
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+template <typename T> NDArray<T>::NDArray(NDArray<T> &&other) noexcept
+{
+    arr = other.arr;
+    ismrmrd_init_ndarray(&other.arr);
+    other.arr.data_type = get_data_type<T>();
+}
+
+template <typename T> NDArray<T> & NDArray<T>::operator= (NDArray<T> &&other) noexcept
+{
+    if (this != &other) {
+        ismrmrd_cleanup_ndarray(&arr);
+        arr = other.arr;
+        ismrmrd_init_ndarray(&other.arr);
+        other.arr.data_type = get_data_type<T>();
+    }
+    return *this;
+}
+#endif
+
+// Ownership transfer
+template <typename T> void NDArray<T>::swap(NDArray<T> &other)
+{
+    ISMRMRD_NDArray tmp = arr;
+    arr = other.arr;
+    other.arr = tmp;
+}
+
+template <typename T> void NDArray<T>::release(ISMRMRD_NDArray *dest)
+{
+    if (dest == NULL) {
+        throw std::runtime_error("NDArray pointer should not be NULL");
+    }
+    *dest = arr;
+    ismrmrd_init_ndarray(&arr);
+    arr.data_type = get_data_type<T>();
+}
+
+template <typename T> void NDArray<T>::adopt(ISMRMRD_NDArray *src)
+{
+    if (src == NULL) {
+        throw std::runtime_error("NDArray pointer should not be NULL");
+    }
+    if (src->data_type != get_data_type<T>()) {
+        throw std::runtime_error("NDArray data type does not match");
+    }
+    if (src != &arr) {
+        ismrmrd_cleanup_ndarray(&arr);
+        arr = *src;
+        ismrmrd_init_ndarray(src);
+    }
+}
+
 template <typename T> const uint16_t NDArray<T>::getVersion() {
     return arr.version;
 };
@@ -1052,6 +1191,10 @@ template <typename T> const size_t NDArray<T>::getDataSize() {
     return ismrmrd_size_of_ndarray_data(&arr);
 }
 
+template <typename T> bool NDArray<T>::isAligned() const {
+    return ismrmrd_is_aligned(arr.data);
+}
+
 template <typename T> const size_t NDArray<T>::getNumberOfElements() {
     size_t num = 1;
     for (int n = 0; n < arr.ndim; n++) {
@@ -1087,37 +1230,37 @@ template <> EXPORTISMRMRD ISMRMRD_DataTypes get_data_type<uint16_t>()
     return ISMRMRD_USHORT;
 }
 
-template <> EXPORTISMRMRD inline ISMRMRD_DataTypes get_data_type<int16_t>()
+template <> EXPORTISMRMRD ISMRMRD_DataTypes get_data_type<int16_t>()
 {
     return ISMRMRD_SHORT;
 }
 
-template <> EXPORTISMRMRD inline ISMRMRD_DataTypes get_data_type<uint32_t>()
+template <> EXPORTISMRMRD ISMRMRD_DataTypes get_data_type<uint32_t>()
 {
     return ISMRMRD_UINT;
 }
 
-template <> EXPORTISMRMRD inline ISMRMRD_DataTypes get_data_type<int32_t>()
+template <> EXPORTISMRMRD ISMRMRD_DataTypes get_data_type<int32_t>()
 {
     return ISMRMRD_INT;
 }
 
-template <> EXPORTISMRMRD inline ISMRMRD_DataTypes get_data_type<float>()
+template <> EXPORTISMRMRD ISMRMRD_DataTypes get_data_type<float>()
 {
     return ISMRMRD_FLOAT;
 }
 
-template <> EXPORTISMRMRD inline ISMRMRD_DataTypes get_data_type<double>()
+template <> EXPORTISMRMRD ISMRMRD_DataTypes get_data_type<double>()
 {
     return ISMRMRD_DOUBLE;
 }
 
-template <> EXPORTISMRMRD inline ISMRMRD_DataTypes get_data_type<complex_float_t>()
+template <> EXPORTISMRMRD ISMRMRD_DataTypes get_data_type<complex_float_t>()
 {
     return ISMRMRD_CXFLOAT;
 }
 
-template <> EXPORTISMRMRD inline ISMRMRD_DataTypes get_data_type<complex_double_t>()
+template <> EXPORTISMRMRD ISMRMRD_DataTypes get_data_type<complex_double_t>()
 {
     return ISMRMRD_CXDOUBLE;
 }
@@ -0,0 +1,36 @@
+/* ISMRMRD internal mutex */
+
+#pragma once
+#ifndef ISMRMRD_LOCK_H
+#define ISMRMRD_LOCK_H
+
+/*
+ * A mutex for the library's own shared state, an SRWLOCK on Windows and a
+ * pthread mutex elsewhere. ISMRMRD_LOCK_INIT returns 0 on success and a lock
+ * initialized with it is released with ISMRMRD_LOCK_DESTROY, a static lock
+ * uses ISMRMRD_LOCK_INITIALIZER and is never destroyed.
+ */
+
+#ifdef _WIN32
+#include <windows.h>
+
+typedef SRWLOCK ISMRMRD_Lock;
+
+#define ISMRMRD_LOCK_INITIALIZER SRWLOCK_INIT
+#define ISMRMRD_LOCK_INIT(l) (InitializeSRWLock(l), 0)
+#define ISMRMRD_LOCK_DESTROY(l) ((void) (l))
+#define ISMRMRD_LOCK(l) AcquireSRWLockExclusive(l)
+#define ISMRMRD_UNLOCK(l) ReleaseSRWLockExclusive(l)
+#else
+#include <pthread.h>
+
+typedef pthread_mutex_t ISMRMRD_Lock;
+
+#define ISMRMRD_LOCK_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#define ISMRMRD_LOCK_INIT(l) pthread_mutex_init(l, NULL)
+#define ISMRMRD_LOCK_DESTROY(l) pthread_mutex_destroy(l)
+#define ISMRMRD_LOCK(l) pthread_mutex_lock(l)
+#define ISMRMRD_UNLOCK(l) pthread_mutex_unlock(l)
+#endif
+
+#endif /* ISMRMRD_LOCK_H */
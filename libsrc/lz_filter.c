@@ -0,0 +1,289 @@
+/* Language and Cross platform section for defining types */
+#ifdef __cplusplus
+#include <cstring>
+#include <cstdlib>
+#else
+/* C99 compiler */
+#include <string.h>
+#include <stdlib.h>
+#endif /* __cplusplus */
+
+#include <hdf5.h>
+#include "ismrmrd/dataset.h"
+
+#ifdef __cplusplus
+namespace ISMRMRD {
+extern "C" {
+#endif
+
+/*
+ * In-tree LZ codec for HDF5 chunks.
+ *
+ * A filtered chunk is the original size as a 4 byte little endian integer
+ * followed by one LZ4 format block: sequences of a token, literals and a
+ * match offset and length. Matching is greedy on a hash of 4 byte sequences,
+ * which is fast rather than tight, run it after the shuffle filter so that
+ * the slowly varying bytes of floats line up.
+ */
+
+#define LZ_HASH_LOG 14
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5    /* the block ends with at least this many literals */
+#define LZ_MATCH_LIMIT 12     /* no match starts in the last bytes of the block */
+#define LZ_MAX_OFFSET 65535
+#define LZ_SKIP_TRIGGER 6     /* step through data without matches faster */
+
+/* Filter buffers must come from the HDF5 allocator when it has one */
+#if H5_VERSION_GE(1, 8, 15)
+#define LZ_MALLOC(n) H5allocate_memory((n), false)
+#define LZ_FREE(p) H5free_memory(p)
+#else
+#define LZ_MALLOC(n) malloc(n)
+#define LZ_FREE(p) free(p)
+#endif
+
+static uint32_t lz_read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t lz_hash(uint32_t v) {
+    return (v * 2654435761U) >> (32 - LZ_HASH_LOG);
+}
+
+static uint8_t * lz_write_length(uint8_t *op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t) len;
+    return op;
+}
+
+/* Writes one sequence, returns NULL if it does not fit before oend */
+static uint8_t * lz_write_sequence(uint8_t *op, const uint8_t *oend, const uint8_t *literals, size_t num_literals,
+                                   size_t offset, size_t match_length) {
+    uint8_t *token;
+
+    if ((size_t)(oend - op) < 1 + num_literals / 255 + 1 + num_literals + 2 + match_length / 255 + 1) {
+        return NULL;
+    }
+    token = op++;
+    *token = (uint8_t) ((num_literals >= 15 ? 15 : num_literals) << 4);
+    if (num_literals >= 15) {
+        op = lz_write_length(op, num_literals - 15);
+    }
+    memcpy(op, literals, num_literals);
+    op += num_literals;
+    if (offset == 0) {
+        /* the last sequence has literals only */
+        return op;
+    }
+    *op++ = (uint8_t) (offset & 0xFF);
+    *op++ = (uint8_t) (offset >> 8);
+    match_length -= LZ_MIN_MATCH;
+    *token |= (uint8_t) (match_length >= 15 ? 15 : match_length);
+    if (match_length >= 15) {
+        op = lz_write_length(op, match_length - 15);
+    }
+    return op;
+}
+
+/* Compresses n bytes into at most capacity bytes, returns 0 if they do not fit */
+static size_t lz_compress(const uint8_t *src, size_t n, uint8_t *dst, size_t capacity) {
+    uint32_t table[1 << LZ_HASH_LOG];
+    const uint8_t *ip = src, *anchor = src, *end = src + n;
+    const uint8_t *ref, *match_end, *r;
+    uint8_t *op = dst;
+    const uint8_t *oend = dst + capacity;
+    uint32_t seq, h;
+
+    memset(table, 0, sizeof(table));
+    if (n > LZ_MATCH_LIMIT) {
+        const uint8_t *mflimit = end - LZ_MATCH_LIMIT;
+        const uint8_t *matchlimit = end - LZ_LAST_LITERALS;
+        while (ip < mflimit) {
+            seq = lz_read32(ip);
+            h = lz_hash(seq);
+            ref = src + table[h];
+            table[h] = (uint32_t) (ip - src);
+            if (ref >= ip || ip - ref > LZ_MAX_OFFSET || lz_read32(ref) != seq) {
+                ip += 1 + ((size_t)(ip - anchor) >> LZ_SKIP_TRIGGER);
+                continue;
+            }
+            /* extend the match both ways */
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            match_end = ip + LZ_MIN_MATCH;
+            r = ref + LZ_MIN_MATCH;
+            while (match_end < matchlimit && *match_end == *r) {
+                match_end++;
+                r++;
+            }
+            op = lz_write_sequence(op, oend, anchor, (size_t)(ip - anchor), (size_t)(ip - ref),
+                                   (size_t)(match_end - ip));
+            if (op == NULL) {
+                return 0;
+            }
+            ip = anchor = match_end;
+        }
+    }
+    op = lz_write_sequence(op, oend, anchor, (size_t)(end - anchor), 0, 0);
+    if (op == NULL) {
+        return 0;
+    }
+    return (size_t)(op - dst);
+}
+
+static size_t lz_read_length(const uint8_t **ip, const uint8_t *iend, size_t len, bool *ok) {
+    uint8_t b;
+    if (len != 15) {
+        return len;
+    }
+    do {
+        if (*ip >= iend) {
+            *ok = false;
+            return 0;
+        }
+        b = *(*ip)++;
+        len += b;
+    } while (b == 255);
+    return len;
+}
+
+/* Decompresses into exactly capacity bytes, returns false on corrupt input */
+static bool lz_decompress(const uint8_t *src, size_t n, uint8_t *dst, size_t capacity) {
+    const uint8_t *ip = src, *iend = src + n;
+    uint8_t *op = dst, *oend = dst + capacity;
+    const uint8_t *ref;
+    size_t literals, length, offset, i;
+    uint8_t token;
+    bool ok = true;
+
+    while (ip < iend) {
+        token = *ip++;
+        literals = lz_read_length(&ip, iend, token >> 4, &ok);
+        if (!ok || literals > (size_t)(iend - ip) || literals > (size_t)(oend - op)) {
+            return false;
+        }
+        memcpy(op, ip, literals);
+        op += literals;
+        ip += literals;
+        if (ip == iend) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return false;
+        }
+        offset = (size_t) ip[0] | ((size_t) ip[1] << 8);
+        ip += 2;
+        length = lz_read_length(&ip, iend, token & 15, &ok) + LZ_MIN_MATCH;
+        if (!ok || offset == 0 || offset > (size_t)(op - dst) || length > (size_t)(oend - op)) {
+            return false;
+        }
+        ref = op - offset;
+        if (offset >= length) {
+            memcpy(op, ref, length);
+        } else {
+            /* overlapping copy repeats the last offset bytes */
+            for (i = 0; i < length; i++) {
+                op[i] = ref[i];
+            }
+        }
+        op += length;
+    }
+    return op == oend;
+}
+
+static size_t lz_filter(unsigned int flags, size_t cd_nelmts, const unsigned int cd_values[],
+                        size_t nbytes, size_t *buf_size, void **buf) {
+    const uint8_t *in = (const uint8_t *) *buf;
+    uint8_t *out;
+    size_t size;
+
+    (void) cd_nelmts;
+    (void) cd_values;
+
+    if (flags & H5Z_FLAG_REVERSE) {
+        if (nbytes < 4) {
+            return 0;
+        }
+        size = (size_t) in[0] | ((size_t) in[1] << 8) | ((size_t) in[2] << 16) | ((size_t) in[3] << 24);
+        out = (uint8_t *) LZ_MALLOC(size > 0 ? size : 1);
+        if (out == NULL) {
+            return 0;
+        }
+        if (!lz_decompress(in + 4, nbytes - 4, out, size)) {
+            LZ_FREE(out);
+            return 0;
+        }
+    } else {
+        /* a chunk that does not shrink is stored unfiltered, the filter is optional */
+        if (nbytes <= 4 || nbytes > 0xFFFFFFFFU) {
+            return 0;
+        }
+        out = (uint8_t *) LZ_MALLOC(nbytes);
+        if (out == NULL) {
+            return 0;
+        }
+        size = lz_compress(in, nbytes, out + 4, nbytes - 5);
+        if (size == 0) {
+            LZ_FREE(out);
+            return 0;
+        }
+        out[0] = (uint8_t) (nbytes & 0xFF);
+        out[1] = (uint8_t) ((nbytes >> 8) & 0xFF);
+        out[2] = (uint8_t) ((nbytes >> 16) & 0xFF);
+        out[3] = (uint8_t) ((nbytes >> 24) & 0xFF);
+        size += 4;
+    }
+
+    LZ_FREE(*buf);
+    *buf = out;
+    *buf_size = (flags & H5Z_FLAG_REVERSE) ? size : nbytes;
+    return size;
+}
+
+static const H5Z_class2_t lz_filter_class = {
+    H5Z_CLASS_T_VERS,
+    (H5Z_filter_t) ISMRMRD_FILTER_LZ,
+    1, 1,
+    "ismrmrd lz",
+    NULL,
+    NULL,
+    lz_filter
+};
+
+int ismrmrd_register_filter(const void *filter_class) {
+    if (filter_class == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Filter class should not be NULL.");
+    }
+    if (H5Zregister(filter_class) < 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to register compression filter.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+int ismrmrd_register_lz_filter(void) {
+    return ismrmrd_register_lz_filter_id(ISMRMRD_FILTER_LZ);
+}
+
+int ismrmrd_register_lz_filter_id(unsigned int filter_id) {
+    /* HDF5 copies the class */
+    H5Z_class2_t filter_class = lz_filter_class;
+
+    if (filter_id < H5Z_FILTER_RESERVED || filter_id > H5Z_FILTER_MAX) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Filter id should be from 256 to 65535.");
+    }
+    filter_class.id = (H5Z_filter_t) filter_id;
+    return ismrmrd_register_filter(&filter_class);
+}
+
+#ifdef __cplusplus
+} /* extern "C" */
+} /* ISMRMRD namespace */
+#endif
@@ -0,0 +1,267 @@
+/* Language and Cross platform section for defining types */
+#ifdef __cplusplus
+#include <cstring>
+#include <cstdlib>
+#else
+/* C99 compiler */
+#include <string.h>
+#include <stdlib.h>
+#endif /* __cplusplus */
+
+#include "ismrmrd/ismrmrd.h"
+#include "lock.h"
+
+#ifdef __cplusplus
+namespace ISMRMRD {
+extern "C" {
+#endif
+
+/*
+ * Size class pool for payload buffers.
+ *
+ * Every power of two from 64 bytes to 64 MB is split into 4 size classes, so a
+ * buffer is at most 25% larger than requested. A buffer is aligned to
+ * ISMRMRD_PAYLOAD_ALIGNMENT within its malloc block and preceded by a header
+ * holding its class, freed buffers go on the free list of their class until the
+ * pool caches max_cached_bytes. Requests above the largest class go to malloc.
+ */
+
+#define POOL_MIN_SHIFT 6
+#define POOL_MAX_SHIFT 26
+#define POOL_SUBCLASS_SHIFT 2
+#define POOL_NUM_CLASSES (((POOL_MAX_SHIFT - POOL_MIN_SHIFT) << POOL_SUBCLASS_SHIFT) + 1)
+#define POOL_LARGE POOL_NUM_CLASSES /* class of blocks from malloc */
+
+typedef struct PoolHeader {
+    size_t size_class;
+    size_t offset;          /* of the buffer in its malloc block */
+} PoolHeader;
+
+#define POOL_BLOCK_OVERHEAD (sizeof(PoolHeader) + ISMRMRD_PAYLOAD_ALIGNMENT - 1)
+
+typedef struct PoolBlock {
+    struct PoolBlock *next; /* only valid while the block is cached */
+} PoolBlock;
+
+struct ISMRMRD_Pool {
+    PoolBlock *free_lists[POOL_NUM_CLASSES];
+    size_t max_cached_bytes;
+    size_t cached_bytes;
+    size_t hits;
+    size_t misses;
+    ISMRMRD_Lock lock;      /* guards the free lists and the counters */
+};
+
+static size_t class_size(size_t cls) {
+    size_t shift = POOL_MIN_SHIFT + (cls >> POOL_SUBCLASS_SHIFT);
+    size_t sub = cls & ((1 << POOL_SUBCLASS_SHIFT) - 1);
+    return ((size_t) 1 << shift) + sub * ((size_t) 1 << (shift - POOL_SUBCLASS_SHIFT));
+}
+
+/* The smallest class that holds size bytes, POOL_LARGE if there is none */
+static size_t class_of(size_t size) {
+    size_t shift = 0, step;
+
+    if (size <= ((size_t) 1 << POOL_MIN_SHIFT)) {
+        return 0;
+    }
+    if (size > ((size_t) 1 << POOL_MAX_SHIFT)) {
+        return POOL_LARGE;
+    }
+    while (((size - 1) >> (shift + 1)) != 0) {
+        shift++;
+    }
+    /* the classes of this power of two are spaced by step bytes */
+    step = (size_t) 1 << (shift - POOL_SUBCLASS_SHIFT);
+    return ((shift - POOL_MIN_SHIFT) << POOL_SUBCLASS_SHIFT) + (size - ((size_t) 1 << shift) + step - 1) / step;
+}
+
+static PoolHeader * block_header(void *ptr) {
+    return (PoolHeader *) ptr - 1;
+}
+
+/* The first aligned address in a malloc block with room for the header */
+static char * block_buffer(char *raw) {
+    return (char *) (((size_t) raw + POOL_BLOCK_OVERHEAD) & ~(size_t) (ISMRMRD_PAYLOAD_ALIGNMENT - 1));
+}
+
+static void set_header(char *p, char *raw, size_t cls) {
+    block_header(p)->size_class = cls;
+    block_header(p)->offset = (size_t) (p - raw);
+}
+
+static void * new_block(size_t cls, size_t size) {
+    char *raw, *p;
+
+    if (size > (size_t) -1 - POOL_BLOCK_OVERHEAD) {
+        return NULL;
+    }
+    raw = (char *) malloc(size + POOL_BLOCK_OVERHEAD);
+    if (raw == NULL) {
+        return NULL;
+    }
+    p = block_buffer(raw);
+    set_header(p, raw, cls);
+    return p;
+}
+
+static void free_block(void *ptr) {
+    free((char *) ptr - block_header(ptr)->offset);
+}
+
+ISMRMRD_Pool * ismrmrd_create_pool(size_t max_cached_bytes) {
+    ISMRMRD_Pool *pool = (ISMRMRD_Pool *) calloc(1, sizeof(ISMRMRD_Pool));
+    if (pool == NULL) {
+        ISMRMRD_PUSH_ERR(ISMRMRD_MEMORYERROR, "Failed to malloc new ISMRMRD_Pool.");
+        return NULL;
+    }
+    if (ISMRMRD_LOCK_INIT(&pool->lock) != 0) {
+        free(pool);
+        ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Failed to initialize the ISMRMRD_Pool lock.");
+        return NULL;
+    }
+    pool->max_cached_bytes = max_cached_bytes;
+    return pool;
+}
+
+int ismrmrd_free_pool(ISMRMRD_Pool *pool) {
+    PoolBlock *block, *next;
+    size_t cls;
+
+    if (pool == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
+    }
+    for (cls = 0; cls < POOL_NUM_CLASSES; cls++) {
+        for (block = pool->free_lists[cls]; block != NULL; block = next) {
+            next = block->next;
+            free_block(block);
+        }
+    }
+    ISMRMRD_LOCK_DESTROY(&pool->lock);
+    free(pool);
+    return ISMRMRD_NOERROR;
+}
+
+void *ismrmrd_pool_malloc(size_t size, void *ctx) {
+    ISMRMRD_Pool *pool = (ISMRMRD_Pool *) ctx;
+    PoolBlock *block;
+    size_t cls = class_of(size);
+
+    if (pool == NULL) {
+        return NULL;
+    }
+    if (cls == POOL_LARGE) {
+        ISMRMRD_LOCK(&pool->lock);
+        pool->misses++;
+        ISMRMRD_UNLOCK(&pool->lock);
+        return new_block(POOL_LARGE, size);
+    }
+
+    ISMRMRD_LOCK(&pool->lock);
+    block = pool->free_lists[cls];
+    if (block != NULL) {
+        pool->free_lists[cls] = block->next;
+        pool->cached_bytes -= class_size(cls);
+        pool->hits++;
+    } else {
+        pool->misses++;
+    }
+    ISMRMRD_UNLOCK(&pool->lock);
+
+    if (block != NULL) {
+        return block;
+    }
+    return new_block(cls, class_size(cls));
+}
+
+void ismrmrd_pool_free(void *ptr, void *ctx) {
+    ISMRMRD_Pool *pool = (ISMRMRD_Pool *) ctx;
+    PoolBlock *block = (PoolBlock *) ptr;
+    size_t cls;
+
+    if (ptr == NULL || pool == NULL) {
+        return;
+    }
+    cls = block_header(ptr)->size_class;
+    if (cls != POOL_LARGE) {
+        ISMRMRD_LOCK(&pool->lock);
+        if (pool->cached_bytes + class_size(cls) <= pool->max_cached_bytes) {
+            block->next = pool->free_lists[cls];
+            pool->free_lists[cls] = block;
+            pool->cached_bytes += class_size(cls);
+            block = NULL;
+        }
+        ISMRMRD_UNLOCK(&pool->lock);
+    }
+    if (block != NULL) {
+        free_block(ptr);
+    }
+}
+
+void *ismrmrd_pool_realloc(void *ptr, size_t size, void *ctx) {
+    size_t cls, new_cls, old_size, offset;
+    char *raw, *moved;
+    void *p;
+
+    if (ptr == NULL) {
+        return ismrmrd_pool_malloc(size, ctx);
+    }
+    if (ctx == NULL) {
+        return NULL;
+    }
+    cls = block_header(ptr)->size_class;
+    new_cls = class_of(size);
+    /* a buffer keeps its block while the size stays in its class */
+    if (cls == new_cls && cls != POOL_LARGE) {
+        return ptr;
+    }
+    if (cls == POOL_LARGE && new_cls == POOL_LARGE) {
+        if (size > (size_t) -1 - POOL_BLOCK_OVERHEAD) {
+            return NULL;
+        }
+        offset = block_header(ptr)->offset;
+        raw = (char *) realloc((char *) ptr - offset, size + POOL_BLOCK_OVERHEAD);
+        if (raw == NULL) {
+            return NULL;
+        }
+        /* realloc keeps the alignment of malloc only */
+        moved = block_buffer(raw);
+        if ((size_t) (moved - raw) != offset) {
+            memmove(moved, raw + offset, size);
+        }
+        set_header(moved, raw, POOL_LARGE);
+        return moved;
+    }
+
+    p = ismrmrd_pool_malloc(size, ctx);
+    if (p == NULL) {
+        return NULL;
+    }
+    /* the size of a large block is not kept, it is larger than any class */
+    old_size = cls == POOL_LARGE ? size : class_size(cls);
+    memcpy(p, ptr, old_size < size ? old_size : size);
+    ismrmrd_pool_free(ptr, ctx);
+    return p;
+}
+
+int ismrmrd_pool_stats(const ISMRMRD_Pool *pool, size_t *hits, size_t *misses) {
+    ISMRMRD_Pool *p = (ISMRMRD_Pool *) pool;
+
+    if (pool == NULL) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_RUNTIMEERROR, "Pointer should not be NULL.");
+    }
+    ISMRMRD_LOCK(&p->lock);
+    if (hits != NULL) {
+        *hits = p->hits;
+    }
+    if (misses != NULL) {
+        *misses = p->misses;
+    }
+    ISMRMRD_UNLOCK(&p->lock);
+    return ISMRMRD_NOERROR;
+}
+
+#ifdef __cplusplus
+} /* extern "C" */
+} /* ISMRMRD namespace */
+#endif
@@ -0,0 +1,208 @@
+#include "ismrmrd/prefetch.h"
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1800)
+
+#include <algorithm>
+#include <stdexcept>
+#include <hdf5.h>
+
+namespace ISMRMRD {
+//
+// AcquisitionPrefetcher class implementation
+//
+static size_t payload_size(const ISMRMRD_Acquisition *acq)
+{
+    return ismrmrd_size_of_acquisition_data(acq) + ismrmrd_size_of_acquisition_traj(acq);
+}
+
+AcquisitionPrefetcher::AcquisitionPrefetcher(Dataset &dataset, uint32_t start, uint32_t count,
+                                             size_t depth, size_t max_bytes)
+    : dataset_(dataset)
+    , use_query_(false)
+    , next_row_(start)
+    , end_row_(start + count)
+    , last_size_(0)
+    , ring_(std::max<size_t>(depth, 1))
+    , max_bytes_(max_bytes)
+    , head_(0)
+    , tail_(0)
+    , bytes_(0)
+    , done_(false)
+    , stop_(false)
+    , waiting_(0)
+{
+    dataset_.flush();
+    if (end_row_ < start) {
+        throw std::runtime_error("Acquisition range exceeds the maximum number of acquisitions");
+    }
+    this->start();
+}
+
+AcquisitionPrefetcher::AcquisitionPrefetcher(Dataset &dataset, const AcquisitionQuery &query,
+                                             size_t depth, size_t max_bytes)
+    : dataset_(dataset)
+    , use_query_(true)
+    , next_row_(0)
+    , end_row_(0)
+    , last_size_(0)
+    , ring_(std::max<size_t>(depth, 1))
+    , max_bytes_(max_bytes)
+    , head_(0)
+    , tail_(0)
+    , bytes_(0)
+    , done_(false)
+    , stop_(false)
+    , waiting_(0)
+{
+    dataset_.flush();
+    int status = ismrmrd_init_acquisition_cursor(&cursor_, &dataset_.dset_, &query, 0);
+    if (status != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    this->start();
+}
+
+AcquisitionPrefetcher::~AcquisitionPrefetcher()
+{
+    stop_ = true;
+    wake();
+    if (reader_.joinable()) {
+        reader_.join();
+    }
+    if (use_query_) {
+        ismrmrd_cleanup_acquisition_cursor(&cursor_);
+    }
+}
+
+void AcquisitionPrefetcher::start()
+{
+    reader_ = std::thread(&AcquisitionPrefetcher::run, this);
+}
+
+// Wakes the other side if it is sleeping, the mutex orders the wake up after its predicate check
+void AcquisitionPrefetcher::wake()
+{
+    // Orders the release store of head_ or tail_ before the load of waiting_, pairing
+    // with the sleeper's increment of waiting_ before it checks head_ or tail_
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_.load() > 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.notify_all();
+    }
+}
+
+// Number of contiguous free slots the reader may fill, 0 when asked to stop
+size_t AcquisitionPrefetcher::waitForSpace()
+{
+    const size_t depth = ring_.size();
+    for (;;) {
+        if (stop_.load()) {
+            return 0;
+        }
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t n = std::min(depth - (tail - head), depth - tail % depth);
+        if (n > 0 && max_bytes_ > 0 && tail != head) {
+            size_t used = bytes_.load();
+            if (used >= max_bytes_) {
+                n = 0;
+            } else if (last_size_ > 0) {
+                n = std::min(n, std::max<size_t>((max_bytes_ - used) / last_size_, 1));
+            }
+        }
+        if (n > 0) {
+            return n;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++waiting_;
+        ready_.wait(lock, [&] {
+            return stop_.load() || head_.load() != head;
+        });
+        --waiting_;
+    }
+}
+
+void AcquisitionPrefetcher::run()
+{
+    // Disable HDF5 automatic error printing on the reader thread
+    H5Eset_auto2(H5E_DEFAULT, NULL, NULL);
+
+    const size_t depth = ring_.size();
+    for (;;) {
+        size_t n = waitForSpace();
+        if (n == 0) {
+            break;
+        }
+
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        ISMRMRD_Acquisition *acqs = reinterpret_cast<ISMRMRD_Acquisition*>(&ring_[tail % depth]);
+        uint32_t count = 0;
+        int status = ISMRMRD_NOERROR;
+        if (use_query_) {
+            status = ismrmrd_acquisition_cursor_next(&cursor_, acqs, NULL, static_cast<uint32_t>(n), &count);
+        } else {
+            count = static_cast<uint32_t>(std::min<size_t>(n, end_row_ - next_row_));
+            if (count > 0) {
+                status = ismrmrd_read_acquisitions(&dataset_.dset_, next_row_, count, acqs);
+                next_row_ += count;
+            }
+        }
+        if (status != ISMRMRD_NOERROR) {
+            error_ = build_exception_string();
+            break;
+        }
+        if (count == 0) {
+            break;
+        }
+
+        size_t size = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            last_size_ = payload_size(&acqs[i]);
+            size += last_size_;
+        }
+        bytes_ += size;
+        tail_.store(tail + count, std::memory_order_release);
+        wake();
+    }
+    done_ = true;
+    wake();
+}
+
+bool AcquisitionPrefetcher::next(Acquisition &acq)
+{
+    const size_t depth = ring_.size();
+    size_t head = head_.load(std::memory_order_relaxed);
+    while (tail_.load(std::memory_order_acquire) == head) {
+        if (done_.load()) {
+            // the reader may have published its last batch just before finishing
+            if (tail_.load(std::memory_order_acquire) != head) {
+                break;
+            }
+            if (!error_.empty()) {
+                std::string error;
+                error.swap(error_);
+                throw std::runtime_error(error);
+            }
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++waiting_;
+        ready_.wait(lock, [&] {
+            return done_.load() || tail_.load() != head;
+        });
+        --waiting_;
+    }
+
+    // Hand the slot to the caller and give the caller's buffers to the slot
+    Acquisition &slot = ring_[head % depth];
+    bytes_ -= slot.getDataSize() + slot.getTrajSize();
+    slot.swap(acq);
+    head_.store(head + 1, std::memory_order_release);
+    wake();
+    return true;
+}
+
+} /* ISMRMRD namespace */
+
+#endif /* C++11 */
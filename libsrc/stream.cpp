@@ -0,0 +1,638 @@
+#include "ismrmrd/stream.h"
+
+// for memcpy and strerror in older compilers
+#include <string.h>
+#include <errno.h>
+#include <stdexcept>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace ISMRMRD {
+
+// Id and body length in front of every message
+static const size_t message_prefix_size = sizeof(uint16_t) + sizeof(uint64_t);
+
+// Segments per vectored write, below IOV_MAX everywhere
+static const size_t max_segments = 64;
+
+static std::runtime_error stream_error(const char *what)
+{
+    return std::runtime_error(std::string(what) + ": " + strerror(errno));
+}
+
+//
+// StreamWriter class implementation
+//
+StreamWriter::StreamWriter(std::ostream &os, size_t buffer_size)
+    : os_(&os)
+    , fd_(-1)
+    , buffer_(std::max<size_t>(buffer_size, 256))
+    , used_(0)
+    , mark_(0)
+    , written_(0)
+{
+}
+
+StreamWriter::StreamWriter(int fd, size_t buffer_size)
+    : os_(NULL)
+    , fd_(fd)
+    , buffer_(std::max<size_t>(buffer_size, 256))
+    , used_(0)
+    , mark_(0)
+    , written_(0)
+{
+}
+
+StreamWriter::~StreamWriter()
+{
+    try {
+        flush();
+    } catch (...) {
+    }
+}
+
+void StreamWriter::writeHeader(const std::string &xmlstring)
+{
+    beginMessage(ISMRMRD_STREAM_HEADER, xmlstring.size());
+    putPayload(xmlstring.data(), xmlstring.size());
+    endMessage();
+}
+
+void StreamWriter::writeAcquisition(const Acquisition &acq)
+{
+    writeAcquisition(&acq.acq);
+}
+
+void StreamWriter::writeAcquisition(const ISMRMRD_Acquisition *acq)
+{
+    if (acq == NULL) {
+        throw std::runtime_error("Acquisition pointer should not be NULL");
+    }
+    size_t traj_size = ismrmrd_size_of_acquisition_traj(acq);
+    size_t data_size = ismrmrd_size_of_acquisition_data(acq);
+    beginMessage(ISMRMRD_STREAM_ACQUISITION, sizeof(acq->head) + traj_size + data_size);
+    put(&acq->head, sizeof(acq->head));
+    putPayload(acq->traj, traj_size);
+    putPayload(acq->data, data_size);
+    endMessage();
+}
+
+template <typename T> void StreamWriter::writeImage(const std::string &var, const Image<T> &im)
+{
+    writeImage(var, &im.im);
+}
+
+void StreamWriter::writeImage(const std::string &var, const ISMRMRD_Image *im)
+{
+    if (im == NULL) {
+        throw std::runtime_error("Image pointer should not be NULL");
+    }
+    size_t attr_size = ismrmrd_size_of_image_attribute_string(im);
+    size_t data_size = ismrmrd_size_of_image_data(im);
+    beginVariable(ISMRMRD_STREAM_IMAGE, var, sizeof(im->head) + attr_size + data_size);
+    put(&im->head, sizeof(im->head));
+    putPayload(im->attribute_string, attr_size);
+    putPayload(im->data, data_size);
+    endMessage();
+}
+
+template <typename T> void StreamWriter::writeNDArray(const std::string &var, const NDArray<T> &arr)
+{
+    writeNDArray(var, &arr.arr);
+}
+
+void StreamWriter::writeNDArray(const std::string &var, const ISMRMRD_NDArray *arr)
+{
+    if (arr == NULL) {
+        throw std::runtime_error("NDArray pointer should not be NULL");
+    }
+    if (arr->ndim > ISMRMRD_NDARRAY_MAXDIM) {
+        throw std::runtime_error("NDArray has too many dimensions");
+    }
+    size_t data_size = ismrmrd_size_of_ndarray_data(arr);
+    beginVariable(ISMRMRD_STREAM_NDARRAY, var, 3 * sizeof(uint16_t) + arr->ndim * sizeof(uint64_t) + data_size);
+    put(&arr->version, sizeof(uint16_t));
+    put(&arr->data_type, sizeof(uint16_t));
+    put(&arr->ndim, sizeof(uint16_t));
+    for (uint16_t n = 0; n < arr->ndim; n++) {
+        uint64_t dim = arr->dims[n];
+        put(&dim, sizeof(dim));
+    }
+    putPayload(arr->data, data_size);
+    endMessage();
+}
+
+void StreamWriter::close()
+{
+    beginMessage(ISMRMRD_STREAM_CLOSE, 0);
+    endMessage();
+    flush();
+}
+
+void StreamWriter::flush()
+{
+    writePending();
+    if (os_ != NULL && !os_->flush()) {
+        throw std::runtime_error("Failed to flush the output stream");
+    }
+}
+
+uint64_t StreamWriter::position() const
+{
+    return written_;
+}
+
+void StreamWriter::beginMessage(uint16_t id, uint64_t length)
+{
+    put(&id, sizeof(id));
+    put(&length, sizeof(length));
+}
+
+// Payloads that are not copied must be written before the write call returns
+void StreamWriter::endMessage()
+{
+    if (!segments_.empty()) {
+        writePending();
+    }
+}
+
+void StreamWriter::beginVariable(uint16_t id, const std::string &var, uint64_t length)
+{
+    if (var.size() > 0xFFFF) {
+        throw std::runtime_error("Variable name is too long");
+    }
+    uint16_t name_length = static_cast<uint16_t>(var.size());
+    beginMessage(id, sizeof(name_length) + name_length + length);
+    put(&name_length, sizeof(name_length));
+    put(var.data(), name_length);
+}
+
+// Copies data into the buffer
+void StreamWriter::put(const void *data, size_t size)
+{
+    written_ += size;
+    if (size > buffer_.size() - used_) {
+        writePending();
+    }
+    if (size > buffer_.size()) {
+        segments_.push_back(std::make_pair(static_cast<const char *>(data), size));
+        return;
+    }
+    if (size > 0) {
+        memcpy(&buffer_[used_], data, size);
+        used_ += size;
+    }
+}
+
+// Copies small payloads and queues large ones behind the buffered bytes
+void StreamWriter::putPayload(const void *data, size_t size)
+{
+    if (size <= buffer_.size() / 4) {
+        put(data, size);
+        return;
+    }
+    written_ += size;
+    if (used_ > mark_) {
+        segments_.push_back(std::make_pair(&buffer_[mark_], used_ - mark_));
+    }
+    segments_.push_back(std::make_pair(static_cast<const char *>(data), size));
+    mark_ = used_;
+}
+
+void StreamWriter::writePending()
+{
+    if (used_ > mark_) {
+        segments_.push_back(std::make_pair(&buffer_[mark_], used_ - mark_));
+    }
+    // the writer is empty again even if the output fails
+    used_ = 0;
+    mark_ = 0;
+    try {
+        writeSegments();
+    } catch (...) {
+        segments_.clear();
+        throw;
+    }
+    segments_.clear();
+}
+
+void StreamWriter::writeSegments()
+{
+    if (os_ != NULL) {
+        for (size_t i = 0; i < segments_.size(); i++) {
+            if (!os_->write(segments_[i].first, segments_[i].second)) {
+                throw std::runtime_error("Failed to write to the output stream");
+            }
+        }
+        return;
+    }
+
+    size_t i = 0, offset = 0;
+    while (i < segments_.size()) {
+#ifdef _WIN32
+        int written = _write(fd_, segments_[i].first + offset,
+                             static_cast<unsigned int>(std::min<size_t>(segments_[i].second - offset, 1 << 30)));
+#else
+        struct iovec iov[max_segments];
+        int count = 0;
+        for (size_t j = i; j < segments_.size() && count < static_cast<int>(max_segments); j++, count++) {
+            size_t skip = j == i ? offset : 0;
+            iov[count].iov_base = const_cast<char *>(segments_[j].first + skip);
+            iov[count].iov_len = segments_[j].second - skip;
+        }
+        ssize_t written = ::writev(fd_, iov, count);
+#endif
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw stream_error("Failed to write stream");
+        }
+        // advance over the segments that were written, the last one may be partial
+        size_t n = static_cast<size_t>(written);
+        while (i < segments_.size() && n >= segments_[i].second - offset) {
+            n -= segments_[i].second - offset;
+            offset = 0;
+            i++;
+        }
+        offset += n;
+    }
+}
+
+// Specific instantiations
+template EXPORTISMRMRD void StreamWriter::writeImage(const std::string &var, const Image<uint16_t> &im);
+template EXPORTISMRMRD void StreamWriter::writeImage(const std::string &var, const Image<int16_t> &im);
+template EXPORTISMRMRD void StreamWriter::writeImage(const std::string &var, const Image<uint32_t> &im);
+template EXPORTISMRMRD void StreamWriter::writeImage(const std::string &var, const Image<int32_t> &im);
+template EXPORTISMRMRD void StreamWriter::writeImage(const std::string &var, const Image<float> &im);
+template EXPORTISMRMRD void StreamWriter::writeImage(const std::string &var, const Image<double> &im);
+template EXPORTISMRMRD void StreamWriter::writeImage(const std::string &var, const Image<complex_float_t> &im);
+template EXPORTISMRMRD void StreamWriter::writeImage(const std::string &var, const Image<complex_double_t> &im);
+
+template EXPORTISMRMRD void StreamWriter::writeNDArray(const std::string &var, const NDArray<uint16_t> &arr);
+template EXPORTISMRMRD void StreamWriter::writeNDArray(const std::string &var, const NDArray<int16_t> &arr);
+template EXPORTISMRMRD void StreamWriter::writeNDArray(const std::string &var, const NDArray<uint32_t> &arr);
+template EXPORTISMRMRD void StreamWriter::writeNDArray(const std::string &var, const NDArray<int32_t> &arr);
+template EXPORTISMRMRD void StreamWriter::writeNDArray(const std::string &var, const NDArray<float> &arr);
+template EXPORTISMRMRD void StreamWriter::writeNDArray(const std::string &var, const NDArray<double> &arr);
+template EXPORTISMRMRD void StreamWriter::writeNDArray(const std::string &var, const NDArray<complex_float_t> &arr);
+template EXPORTISMRMRD void StreamWriter::writeNDArray(const std::string &var, const NDArray<complex_double_t> &arr);
+
+//
+// StreamReader class implementation
+//
+StreamReader::StreamReader(std::istream &is, size_t buffer_size)
+    : is_(&is)
+    , fd_(-1)
+    , pos_(0)
+    , end_(0)
+    , pending_(false)
+    , closed_(false)
+    , id_(0)
+    , remaining_(0)
+{
+    // the istream buffers itself
+    (void) buffer_size;
+}
+
+StreamReader::StreamReader(int fd, size_t buffer_size)
+    : is_(NULL)
+    , fd_(fd)
+    , buffer_(std::max<size_t>(buffer_size, 256))
+    , pos_(0)
+    , end_(0)
+    , pending_(false)
+    , closed_(false)
+    , id_(0)
+    , remaining_(0)
+{
+}
+
+uint16_t StreamReader::nextMessage()
+{
+    if (closed_) {
+        return ISMRMRD_STREAM_CLOSE;
+    }
+    if (pending_) {
+        return id_;
+    }
+
+    // the end of the input between messages closes the stream
+    bool at_end;
+    if (is_ != NULL) {
+        at_end = is_->peek() == std::istream::traits_type::eof();
+    } else {
+        if (pos_ == end_) {
+            pos_ = 0;
+            end_ = fill(&buffer_[0], buffer_.size());
+        }
+        at_end = end_ == 0;
+    }
+    if (at_end) {
+        closed_ = true;
+        return ISMRMRD_STREAM_CLOSE;
+    }
+
+    // the prefix is read like a message of its own size
+    char prefix[message_prefix_size];
+    remaining_ = message_prefix_size;
+    get(prefix, message_prefix_size);
+    memcpy(&id_, prefix, sizeof(id_));
+    memcpy(&remaining_, prefix + sizeof(id_), sizeof(remaining_));
+    pending_ = true;
+
+    if (id_ == ISMRMRD_STREAM_CLOSE) {
+        pending_ = false;
+        discard();
+        closed_ = true;
+    }
+    return id_;
+}
+
+void StreamReader::readHeader(std::string &xmlstring)
+{
+    beginMessage(ISMRMRD_STREAM_HEADER);
+    xmlstring.resize(static_cast<size_t>(remaining_));
+    if (!xmlstring.empty()) {
+        get(&xmlstring[0], xmlstring.size());
+    }
+    endMessage();
+}
+
+void StreamReader::readAcquisition(Acquisition &acq)
+{
+    readAcquisition(&acq.acq);
+}
+
+void StreamReader::readAcquisition(ISMRMRD_Acquisition *acq)
+{
+    if (acq == NULL) {
+        throw std::runtime_error("Acquisition pointer should not be NULL");
+    }
+    beginMessage(ISMRMRD_STREAM_ACQUISITION);
+    get(&acq->head, sizeof(acq->head));
+    if (ismrmrd_make_consistent_acquisition(acq) != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    get(acq->traj, ismrmrd_size_of_acquisition_traj(acq));
+    get(acq->data, ismrmrd_size_of_acquisition_data(acq));
+    endMessage();
+}
+
+template <typename T> void StreamReader::readImage(std::string &var, Image<T> &im)
+{
+    ISMRMRD_ImageHeader head;
+    readImageHeader(var, head);
+    if (head.data_type != im.im.head.data_type) {
+        discard();
+        throw std::runtime_error("Image data type does not match the image in the stream");
+    }
+    readImageBody(head, &im.im);
+}
+
+void StreamReader::readImage(std::string &var, ISMRMRD_Image *im)
+{
+    if (im == NULL) {
+        throw std::runtime_error("Image pointer should not be NULL");
+    }
+    ISMRMRD_ImageHeader head;
+    readImageHeader(var, head);
+    readImageBody(head, im);
+}
+
+template <typename T> void StreamReader::readNDArray(std::string &var, NDArray<T> &arr)
+{
+    ISMRMRD_NDArray head;
+    readNDArrayHeader(var, head);
+    if (head.data_type != arr.arr.data_type) {
+        discard();
+        throw std::runtime_error("NDArray data type does not match the array in the stream");
+    }
+    readNDArrayBody(head, &arr.arr);
+}
+
+void StreamReader::readNDArray(std::string &var, ISMRMRD_NDArray *arr)
+{
+    if (arr == NULL) {
+        throw std::runtime_error("NDArray pointer should not be NULL");
+    }
+    ISMRMRD_NDArray head;
+    readNDArrayHeader(var, head);
+    readNDArrayBody(head, arr);
+}
+
+void StreamReader::skipMessage()
+{
+    nextMessage();
+    pending_ = false;
+    discard();
+}
+
+// Skips the rest of the current message
+void StreamReader::discard()
+{
+    while (remaining_ > 0) {
+        if (is_ != NULL) {
+            std::streamsize n = static_cast<std::streamsize>(std::min<uint64_t>(remaining_, 1 << 30));
+            if (is_->ignore(n).gcount() != n) {
+                throw std::runtime_error("Unexpected end of stream");
+            }
+            remaining_ -= n;
+        } else {
+            if (pos_ == end_) {
+                pos_ = 0;
+                end_ = fill(&buffer_[0], buffer_.size());
+                if (end_ == 0) {
+                    throw std::runtime_error("Unexpected end of stream");
+                }
+            }
+            size_t n = static_cast<size_t>(std::min<uint64_t>(remaining_, end_ - pos_));
+            pos_ += n;
+            remaining_ -= n;
+        }
+    }
+}
+
+void StreamReader::beginMessage(uint16_t id)
+{
+    if (nextMessage() != id) {
+        throw std::runtime_error("Unexpected message in stream");
+    }
+    pending_ = false;
+}
+
+void StreamReader::endMessage()
+{
+    if (remaining_ != 0) {
+        throw std::runtime_error("Malformed message in stream, message is longer than its contents");
+    }
+}
+
+void StreamReader::readVariableName(std::string &var)
+{
+    uint16_t name_length;
+    get(&name_length, sizeof(name_length));
+    var.resize(name_length);
+    if (name_length > 0) {
+        get(&var[0], name_length);
+    }
+}
+
+void StreamReader::readImageHeader(std::string &var, ISMRMRD_ImageHeader &head)
+{
+    beginMessage(ISMRMRD_STREAM_IMAGE);
+    readVariableName(var);
+    get(&head, sizeof(head));
+    if (head.data_type < ISMRMRD_USHORT || head.data_type > ISMRMRD_CXDOUBLE) {
+        throw std::runtime_error("Invalid image data type in stream");
+    }
+}
+
+void StreamReader::readImageBody(const ISMRMRD_ImageHeader &head, ISMRMRD_Image *im)
+{
+    im->head = head;
+    if (ismrmrd_make_consistent_image(im) != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    size_t attr_size = ismrmrd_size_of_image_attribute_string(im);
+    if (attr_size > 0) {
+        // the attribute string is kept null terminated like the one read from HDF5
+        char *attr = static_cast<char *>(ismrmrd_realloc(im->attribute_string, attr_size + 1));
+        if (attr == NULL) {
+            throw std::runtime_error("Failed to realloc image attribute string");
+        }
+        im->attribute_string = attr;
+        get(attr, attr_size);
+        attr[attr_size] = '\0';
+    }
+    get(im->data, ismrmrd_size_of_image_data(im));
+    endMessage();
+}
+
+void StreamReader::readNDArrayHeader(std::string &var, ISMRMRD_NDArray &head)
+{
+    beginMessage(ISMRMRD_STREAM_NDARRAY);
+    readVariableName(var);
+    ismrmrd_init_ndarray(&head);
+    get(&head.version, sizeof(uint16_t));
+    get(&head.data_type, sizeof(uint16_t));
+    get(&head.ndim, sizeof(uint16_t));
+    if (head.data_type < ISMRMRD_USHORT || head.data_type > ISMRMRD_CXDOUBLE) {
+        throw std::runtime_error("Invalid NDArray data type in stream");
+    }
+    if (head.ndim > ISMRMRD_NDARRAY_MAXDIM) {
+        throw std::runtime_error("NDArray in stream has too many dimensions");
+    }
+    for (uint16_t n = 0; n < head.ndim; n++) {
+        uint64_t dim;
+        get(&dim, sizeof(dim));
+        head.dims[n] = static_cast<size_t>(dim);
+    }
+}
+
+void StreamReader::readNDArrayBody(const ISMRMRD_NDArray &head, ISMRMRD_NDArray *arr)
+{
+    arr->version = head.version;
+    arr->data_type = head.data_type;
+    arr->ndim = head.ndim;
+    for (int n = 0; n < ISMRMRD_NDARRAY_MAXDIM; n++) {
+        arr->dims[n] = head.dims[n];
+    }
+    if (ismrmrd_make_consistent_ndarray(arr) != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+    }
+    get(arr->data, ismrmrd_size_of_ndarray_data(arr));
+    endMessage();
+}
+
+// Reads size bytes of the current message
+void StreamReader::get(void *data, size_t size)
+{
+    if (size > remaining_) {
+        throw std::runtime_error("Malformed message in stream, contents are longer than the message");
+    }
+    remaining_ -= size;
+
+    char *dest = static_cast<char *>(data);
+    if (is_ != NULL) {
+        if (size > 0 && !is_->read(dest, size)) {
+            throw std::runtime_error("Unexpected end of stream");
+        }
+        return;
+    }
+
+    size_t n = std::min(size, end_ - pos_);
+    if (n > 0) {
+        memcpy(dest, &buffer_[pos_], n);
+        pos_ += n;
+        dest += n;
+        size -= n;
+    }
+    while (size > 0) {
+        if (size >= buffer_.size()) {
+            // large payloads go straight to their destination
+            n = fill(dest, size);
+            if (n == 0) {
+                throw std::runtime_error("Unexpected end of stream");
+            }
+            dest += n;
+            size -= n;
+        } else {
+            pos_ = 0;
+            end_ = fill(&buffer_[0], buffer_.size());
+            if (end_ == 0) {
+                throw std::runtime_error("Unexpected end of stream");
+            }
+            n = std::min(size, end_);
+            memcpy(dest, &buffer_[0], n);
+            pos_ = n;
+            dest += n;
+            size -= n;
+        }
+    }
+}
+
+// Reads what the file descriptor has up to size bytes, 0 at the end of the input
+size_t StreamReader::fill(char *data, size_t size)
+{
+    for (;;) {
+#ifdef _WIN32
+        int n = _read(fd_, data, static_cast<unsigned int>(std::min<size_t>(size, 1 << 30)));
+#else
+        ssize_t n = ::read(fd_, data, size);
+#endif
+        if (n >= 0) {
+            return static_cast<size_t>(n);
+        }
+        if (errno != EINTR) {
+            throw stream_error("Failed to read stream");
+        }
+    }
+}
+
+// Specific instantiations
+template EXPORTISMRMRD void StreamReader::readImage(std::string &var, Image<uint16_t> &im);
+template EXPORTISMRMRD void StreamReader::readImage(std::string &var, Image<int16_t> &im);
+template EXPORTISMRMRD void StreamReader::readImage(std::string &var, Image<uint32_t> &im);
+template EXPORTISMRMRD void StreamReader::readImage(std::string &var, Image<int32_t> &im);
+template EXPORTISMRMRD void StreamReader::readImage(std::string &var, Image<float> &im);
+template EXPORTISMRMRD void StreamReader::readImage(std::string &var, Image<double> &im);
+template EXPORTISMRMRD void StreamReader::readImage(std::string &var, Image<complex_float_t> &im);
+template EXPORTISMRMRD void StreamReader::readImage(std::string &var, Image<complex_double_t> &im);
+
+template EXPORTISMRMRD void StreamReader::readNDArray(std::string &var, NDArray<uint16_t> &arr);
+template EXPORTISMRMRD void StreamReader::readNDArray(std::string &var, NDArray<int16_t> &arr);
+template EXPORTISMRMRD void StreamReader::readNDArray(std::string &var, NDArray<uint32_t> &arr);
+template EXPORTISMRMRD void StreamReader::readNDArray(std::string &var, NDArray<int32_t> &arr);
+template EXPORTISMRMRD void StreamReader::readNDArray(std::string &var, NDArray<float> &arr);
+template EXPORTISMRMRD void StreamReader::readNDArray(std::string &var, NDArray<double> &arr);
+template EXPORTISMRMRD void StreamReader::readNDArray(std::string &var, NDArray<complex_float_t> &arr);
+template EXPORTISMRMRD void StreamReader::readNDArray(std::string &var, NDArray<complex_double_t> &arr);
+
+} // namespace ISMRMRD
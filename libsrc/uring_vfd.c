@@ -0,0 +1,723 @@
+#ifdef ISMRMRD_HAVE_IO_URING
+/* O_DIRECT, syscall and flock */
+#define _GNU_SOURCE
+#endif
+
+/* Language and Cross platform section for defining types */
+#ifdef __cplusplus
+#include <cstring>
+#include <cstdlib>
+#else
+/* C99 compiler */
+#include <string.h>
+#include <stdlib.h>
+#endif /* __cplusplus */
+
+#ifdef ISMRMRD_HAVE_IO_URING
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#include <hdf5.h>
+#include "ismrmrd/dataset.h"
+
+#ifdef __cplusplus
+namespace ISMRMRD {
+extern "C" {
+#endif
+
+#ifdef ISMRMRD_HAVE_IO_URING
+
+/*
+ * HDF5 file driver doing its I/O through a Linux io_uring.
+ *
+ * The file format is the one of the default sec2 driver. HDF5 hands a driver
+ * one request at a time, so the ring cannot batch separate requests. Instead
+ * each large request is split into pieces of at least URING_MIN_PIECE bytes
+ * that are all submitted at once and transferred in parallel, up to the queue
+ * depth. Smaller requests, mostly metadata, take a plain pread or pwrite,
+ * which is as fast as one trip through the ring.
+ *
+ * Requests of at least direct_size bytes bypass the page cache through a
+ * second descriptor opened with O_DIRECT, reads through an aligned bounce
+ * buffer, writes only when they start on a block boundary. Where io_uring or
+ * O_DIRECT are not available, e.g. blocked in a container or on tmpfs, the
+ * driver falls back to pread and pwrite.
+ */
+
+#define URING_NAME "ismrmrd_io_uring"
+#define URING_DEFAULT_QUEUE_DEPTH 32
+#define URING_MIN_PIECE (128 * 1024)
+/* offsets, sizes and buffers of O_DIRECT transfers are multiples of this */
+#define URING_DIRECT_ALIGNMENT 4096
+/* largest address, the one sec2 uses for a signed 64 bit off_t */
+#define URING_MAXADDR (((haddr_t) 1 << (8 * sizeof(off_t) - 1)) - 1)
+
+typedef struct uring_config {
+    uint32_t queue_depth;
+    size_t direct_size;
+} uring_config;
+
+typedef struct uring_ring {
+    int fd;                        /* -1 when the ring could not be set up */
+    unsigned entries;
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ptr, *cq_ptr;
+    size_t sq_size, cq_size, sqes_size;
+} uring_ring;
+
+typedef struct uring_file {
+    H5FD_t pub;                    /* public fields, must be first */
+    int fd;
+    int direct_fd;                 /* O_DIRECT descriptor, -1 if unused */
+    haddr_t eoa;
+    haddr_t eof;
+    dev_t device;
+    ino_t inode;
+    uring_config config;
+    uring_ring ring;
+    void *bounce;                  /* aligned buffer of O_DIRECT transfers */
+    size_t bounce_size;
+} uring_file;
+
+/* A part of a transfer, completed with pread or pwrite if the ring leaves it short */
+typedef struct uring_piece {
+    haddr_t offset;
+    size_t size;
+    unsigned char *buffer;
+} uring_piece;
+
+static hid_t uring_driver_id = H5I_INVALID_HID;
+
+#define URING_ERROR(minor, msg) \
+    H5Epush2(H5E_DEFAULT, __FILE__, __func__, __LINE__, H5E_ERR_CLS, H5E_VFL, (minor), (msg))
+
+/* Ring setup and teardown */
+
+static void uring_ring_destroy(uring_ring *ring)
+{
+    if (ring->fd < 0) {
+        return;
+    }
+    if (ring->sqes != NULL) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_ptr != NULL && ring->cq_ptr != ring->sq_ptr) {
+        munmap(ring->cq_ptr, ring->cq_size);
+    }
+    if (ring->sq_ptr != NULL) {
+        munmap(ring->sq_ptr, ring->sq_size);
+    }
+    close(ring->fd);
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+static void uring_ring_create(uring_ring *ring, unsigned entries)
+{
+    struct io_uring_params params;
+    unsigned char *sq, *cq;
+    void *p;
+
+    memset(ring, 0, sizeof(*ring));
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        ring->fd = -1;
+        return;
+    }
+    ring->entries = params.sq_entries;
+    ring->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_size > ring->sq_size) {
+            ring->sq_size = ring->cq_size;
+        }
+        ring->cq_size = ring->sq_size;
+    }
+
+    p = mmap(NULL, ring->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (p == MAP_FAILED) {
+        uring_ring_destroy(ring);
+        return;
+    }
+    ring->sq_ptr = p;
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ptr = p;
+    }
+    else {
+        p = mmap(NULL, ring->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (p == MAP_FAILED) {
+            uring_ring_destroy(ring);
+            return;
+        }
+        ring->cq_ptr = p;
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    p = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (p == MAP_FAILED) {
+        uring_ring_destroy(ring);
+        return;
+    }
+    ring->sqes = (struct io_uring_sqe *) p;
+
+    sq = (unsigned char *) ring->sq_ptr;
+    cq = (unsigned char *) ring->cq_ptr;
+    ring->sq_tail = (unsigned *) (sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *) (sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (sq + params.sq_off.array);
+    ring->cq_head = (unsigned *) (cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *) (cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + params.cq_off.cqes);
+}
+
+/* Transfers */
+
+/*
+ * Completes a piece with pread or pwrite, reads past the end of the file give zeros.
+ *
+ * The first transfer goes to fd, what it leaves short to rest_fd. A short
+ * O_DIRECT transfer leaves a rest whose offset, buffer and size are off the
+ * block boundaries, so rest_fd is the page cache descriptor.
+ */
+static int uring_finish_piece(int fd, int rest_fd, bool write, haddr_t offset, size_t size, unsigned char *buffer)
+{
+    ssize_t n;
+
+    while (size > 0) {
+        if (write) {
+            n = pwrite(fd, buffer, size, (off_t) offset);
+        }
+        else {
+            n = pread(fd, buffer, size, (off_t) offset);
+        }
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            if (write) {
+                errno = EIO;
+                return -1;
+            }
+            memset(buffer, 0, size);
+            return 0;
+        }
+        offset += (haddr_t) n;
+        size -= (size_t) n;
+        buffer += n;
+        fd = rest_fd;
+    }
+    return 0;
+}
+
+/*
+ * Submits the pieces to the ring and waits for all of them.
+ *
+ * Returns -1 if the ring cannot take the requests, then nothing is in flight
+ * and the caller transfers the pieces itself. Pieces the ring leaves short
+ * are completed on fd.
+ */
+static int uring_submit(uring_file *file, int ring_fd_target, bool write,
+                        uring_piece *pieces, unsigned count)
+{
+    uring_ring *ring = &file->ring;
+    struct io_uring_sqe *sqe;
+    struct io_uring_cqe *cqe;
+    unsigned tail, head, index, done = 0, i;
+    int submitted, unsupported = 0, status = 0;
+    long ret;
+
+    tail = *ring->sq_tail;
+    for (i = 0; i < count; i++) {
+        index = tail & *ring->sq_mask;
+        sqe = &ring->sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+        sqe->fd = ring_fd_target;
+        sqe->off = pieces[i].offset;
+        sqe->addr = (uint64_t) (uintptr_t) pieces[i].buffer;
+        sqe->len = (uint32_t) pieces[i].size;
+        sqe->user_data = i;
+        ring->sq_array[index] = index;
+        tail++;
+    }
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+    do {
+        ret = syscall(__NR_io_uring_enter, ring->fd, count, count, IORING_ENTER_GETEVENTS, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+    if (ret < 0) {
+        /* nothing was consumed, take the entries back */
+        __atomic_store_n(ring->sq_tail, tail - count, __ATOMIC_RELEASE);
+        return -1;
+    }
+    submitted = (int) ret;
+
+    while (done < (unsigned) submitted) {
+        head = *ring->cq_head;
+        while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            cqe = &ring->cqes[head & *ring->cq_mask];
+            i = (unsigned) cqe->user_data;
+            if (cqe->res == -EINVAL || cqe->res == -EOPNOTSUPP) {
+                /* a kernel without IORING_OP_READ and IORING_OP_WRITE */
+                unsupported = 1;
+            }
+            else if (cqe->res > 0) {
+                pieces[i].offset += (haddr_t) cqe->res;
+                pieces[i].buffer += cqe->res;
+                pieces[i].size -= (size_t) cqe->res;
+            }
+            head++;
+            done++;
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+        if (done < (unsigned) submitted) {
+            do {
+                ret = syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            } while (ret < 0 && errno == EINTR);
+            if (ret < 0) {
+                return -1;
+            }
+        }
+    }
+
+    /* what the ring did not do, including entries it did not take */
+    for (i = 0; i < count && status == 0; i++) {
+        if (pieces[i].size > 0) {
+            status = uring_finish_piece(file->fd, file->fd, write, pieces[i].offset, pieces[i].size, pieces[i].buffer);
+        }
+    }
+    if ((unsigned) submitted < count) {
+        /* the kernel dropped the rest of the submission queue */
+        __atomic_store_n(ring->sq_tail, *ring->sq_tail - (count - (unsigned) submitted), __ATOMIC_RELEASE);
+    }
+    if (unsupported) {
+        uring_ring_destroy(ring);
+    }
+    return status;
+}
+
+/* Transfers size bytes at offset on fd, in parallel pieces through the ring when it pays off */
+static int uring_transfer(uring_file *file, int fd, bool write, haddr_t offset, size_t size, unsigned char *buffer)
+{
+    uring_piece pieces[256];
+    size_t piece_size;
+    unsigned count, i, n;
+
+    if (file->ring.fd < 0 || size < 2 * URING_MIN_PIECE) {
+        return uring_finish_piece(fd, file->fd, write, offset, size, buffer);
+    }
+
+    n = file->ring.entries < 256 ? file->ring.entries : 256;
+    piece_size = (size + n - 1) / n;
+    if (piece_size < URING_MIN_PIECE) {
+        piece_size = URING_MIN_PIECE;
+    }
+    /* keeps O_DIRECT pieces on block boundaries */
+    piece_size = (piece_size + URING_DIRECT_ALIGNMENT - 1) / URING_DIRECT_ALIGNMENT * URING_DIRECT_ALIGNMENT;
+
+    while (size > 0) {
+        for (count = 0; count < n && size > 0; count++) {
+            pieces[count].offset = offset;
+            pieces[count].buffer = buffer;
+            pieces[count].size = size < piece_size ? size : piece_size;
+            offset += pieces[count].size;
+            buffer += pieces[count].size;
+            size -= pieces[count].size;
+        }
+        if (file->ring.fd < 0 || uring_submit(file, fd, write, pieces, count) < 0) {
+            /* the ring is unusable, stay with plain I/O from now on */
+            uring_ring_destroy(&file->ring);
+            for (i = 0; i < count; i++) {
+                if (uring_finish_piece(file->fd, file->fd, write, pieces[i].offset, pieces[i].size, pieces[i].buffer) < 0) {
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+static int uring_reserve_bounce(uring_file *file, size_t size)
+{
+    void *p;
+
+    if (size <= file->bounce_size) {
+        return 0;
+    }
+    if (posix_memalign(&p, URING_DIRECT_ALIGNMENT, size) != 0) {
+        return -1;
+    }
+    free(file->bounce);
+    file->bounce = p;
+    file->bounce_size = size;
+    return 0;
+}
+
+/* Reads the blocks around a request with O_DIRECT */
+static int uring_read_direct(uring_file *file, haddr_t addr, size_t size, unsigned char *buffer)
+{
+    haddr_t start = addr / URING_DIRECT_ALIGNMENT * URING_DIRECT_ALIGNMENT;
+    haddr_t end = (addr + size + URING_DIRECT_ALIGNMENT - 1) / URING_DIRECT_ALIGNMENT * URING_DIRECT_ALIGNMENT;
+
+    if (start == addr && end == addr + size && ((uintptr_t) buffer % URING_DIRECT_ALIGNMENT) == 0) {
+        return uring_transfer(file, file->direct_fd, false, addr, size, buffer);
+    }
+    if (uring_reserve_bounce(file, (size_t) (end - start)) < 0 ||
+        uring_transfer(file, file->direct_fd, false, start, (size_t) (end - start), (unsigned char *) file->bounce) < 0) {
+        return -1;
+    }
+    memcpy(buffer, (unsigned char *) file->bounce + (addr - start), size);
+    return 0;
+}
+
+/* Writes the whole blocks of a request starting on a block boundary with O_DIRECT, the rest through the page cache */
+static int uring_write_direct(uring_file *file, haddr_t addr, size_t size, const unsigned char *buffer)
+{
+    size_t blocks = size / URING_DIRECT_ALIGNMENT * URING_DIRECT_ALIGNMENT;
+    const unsigned char *source = buffer;
+
+    if (((uintptr_t) buffer % URING_DIRECT_ALIGNMENT) != 0) {
+        if (uring_reserve_bounce(file, blocks) < 0) {
+            return -1;
+        }
+        memcpy(file->bounce, buffer, blocks);
+        source = (const unsigned char *) file->bounce;
+    }
+    if (uring_transfer(file, file->direct_fd, true, addr, blocks, (unsigned char *) source) < 0) {
+        return -1;
+    }
+    if (blocks < size) {
+        return uring_transfer(file, file->fd, true, addr + blocks, size - blocks, (unsigned char *) buffer + blocks);
+    }
+    return 0;
+}
+
+/* Driver callbacks */
+
+static void * uring_fapl_get(H5FD_t *_file)
+{
+    uring_file *file = (uring_file *) _file;
+    uring_config *config = (uring_config *) malloc(sizeof(*config));
+
+    if (config != NULL) {
+        *config = file->config;
+    }
+    return config;
+}
+
+static void * uring_fapl_copy(const void *_old)
+{
+    uring_config *config = (uring_config *) malloc(sizeof(*config));
+
+    if (config != NULL) {
+        *config = *(const uring_config *) _old;
+    }
+    return config;
+}
+
+static herr_t uring_fapl_free(void *config)
+{
+    free(config);
+    return 0;
+}
+
+static H5FD_t * uring_open(const char *name, unsigned flags, hid_t fapl, haddr_t maxaddr)
+{
+    const uring_config *config;
+    uring_file *file;
+    struct stat sb;
+    int o_flags, fd;
+
+    if (name == NULL || *name == '\0' || maxaddr == 0 || maxaddr == HADDR_UNDEF || maxaddr > URING_MAXADDR) {
+        URING_ERROR(H5E_BADVALUE, "invalid file name or address");
+        return NULL;
+    }
+
+    o_flags = (flags & H5F_ACC_RDWR) ? O_RDWR : O_RDONLY;
+    if (flags & H5F_ACC_TRUNC) {
+        o_flags |= O_TRUNC;
+    }
+    if (flags & H5F_ACC_CREAT) {
+        o_flags |= O_CREAT;
+    }
+    if (flags & H5F_ACC_EXCL) {
+        o_flags |= O_EXCL;
+    }
+    fd = open(name, o_flags, 0666);
+    if (fd < 0) {
+        URING_ERROR(H5E_CANTOPENFILE, "unable to open file");
+        return NULL;
+    }
+    if (fstat(fd, &sb) < 0) {
+        close(fd);
+        URING_ERROR(H5E_BADFILE, "unable to fstat file");
+        return NULL;
+    }
+
+    file = (uring_file *) calloc(1, sizeof(*file));
+    if (file == NULL) {
+        close(fd);
+        URING_ERROR(H5E_CANTALLOC, "unable to allocate file struct");
+        return NULL;
+    }
+    file->fd = fd;
+    file->eof = (haddr_t) sb.st_size;
+    file->device = sb.st_dev;
+    file->inode = sb.st_ino;
+
+    config = (const uring_config *) H5Pget_driver_info(fapl);
+    if (config != NULL) {
+        file->config = *config;
+    }
+    if (file->config.queue_depth == 0) {
+        file->config.queue_depth = URING_DEFAULT_QUEUE_DEPTH;
+    }
+
+    uring_ring_create(&file->ring, file->config.queue_depth);
+    file->direct_fd = -1;
+    if (file->config.direct_size > 0) {
+        /* not every file system takes O_DIRECT, e.g. tmpfs */
+        file->direct_fd = open(name, (o_flags & O_ACCMODE) | O_DIRECT);
+    }
+    return (H5FD_t *) file;
+}
+
+static herr_t uring_close(H5FD_t *_file)
+{
+    uring_file *file = (uring_file *) _file;
+    herr_t status = 0;
+
+    uring_ring_destroy(&file->ring);
+    if (file->direct_fd >= 0) {
+        close(file->direct_fd);
+    }
+    if (close(file->fd) < 0) {
+        URING_ERROR(H5E_CANTCLOSEFILE, "unable to close file");
+        status = -1;
+    }
+    free(file->bounce);
+    free(file);
+    return status;
+}
+
+static int uring_cmp(const H5FD_t *_f1, const H5FD_t *_f2)
+{
+    const uring_file *f1 = (const uring_file *) _f1;
+    const uring_file *f2 = (const uring_file *) _f2;
+
+    if (f1->device != f2->device) {
+        return f1->device < f2->device ? -1 : 1;
+    }
+    if (f1->inode != f2->inode) {
+        return f1->inode < f2->inode ? -1 : 1;
+    }
+    return 0;
+}
+
+static herr_t uring_query(const H5FD_t *_file, unsigned long *flags)
+{
+    (void) _file;
+    /* the same features as sec2 */
+    *flags = H5FD_FEAT_AGGREGATE_METADATA | H5FD_FEAT_ACCUMULATE_METADATA | H5FD_FEAT_DATA_SIEVE |
+             H5FD_FEAT_AGGREGATE_SMALLDATA | H5FD_FEAT_POSIX_COMPAT_HANDLE | H5FD_FEAT_SUPPORTS_SWMR_IO;
+#ifdef H5FD_FEAT_DEFAULT_VFD_COMPATIBLE
+    *flags |= H5FD_FEAT_DEFAULT_VFD_COMPATIBLE;
+#endif
+    return 0;
+}
+
+static haddr_t uring_get_eoa(const H5FD_t *_file, H5FD_mem_t type)
+{
+    (void) type;
+    return ((const uring_file *) _file)->eoa;
+}
+
+static herr_t uring_set_eoa(H5FD_t *_file, H5FD_mem_t type, haddr_t addr)
+{
+    (void) type;
+    ((uring_file *) _file)->eoa = addr;
+    return 0;
+}
+
+static haddr_t uring_get_eof(const H5FD_t *_file, H5FD_mem_t type)
+{
+    (void) type;
+    return ((const uring_file *) _file)->eof;
+}
+
+static herr_t uring_get_handle(H5FD_t *_file, hid_t fapl, void **file_handle)
+{
+    (void) fapl;
+    *file_handle = &((uring_file *) _file)->fd;
+    return 0;
+}
+
+static herr_t uring_read(H5FD_t *_file, H5FD_mem_t type, hid_t dxpl, haddr_t addr, size_t size, void *buffer)
+{
+    uring_file *file = (uring_file *) _file;
+    int status;
+
+    (void) type;
+    (void) dxpl;
+    if (addr == HADDR_UNDEF || addr + size > file->eoa || addr + size < addr) {
+        URING_ERROR(H5E_OVERFLOW, "addr overflow");
+        return -1;
+    }
+    if (file->direct_fd >= 0 && size >= file->config.direct_size) {
+        status = uring_read_direct(file, addr, size, (unsigned char *) buffer);
+    }
+    else {
+        status = uring_transfer(file, file->fd, false, addr, size, (unsigned char *) buffer);
+    }
+    if (status < 0) {
+        URING_ERROR(H5E_READERROR, "file read failed");
+        return -1;
+    }
+    return 0;
+}
+
+static herr_t uring_write(H5FD_t *_file, H5FD_mem_t type, hid_t dxpl, haddr_t addr, size_t size, const void *buffer)
+{
+    uring_file *file = (uring_file *) _file;
+    int status;
+
+    (void) type;
+    (void) dxpl;
+    if (addr == HADDR_UNDEF || addr + size > file->eoa || addr + size < addr) {
+        URING_ERROR(H5E_OVERFLOW, "addr overflow");
+        return -1;
+    }
+    if (file->direct_fd >= 0 && size >= file->config.direct_size && size >= URING_DIRECT_ALIGNMENT &&
+        addr % URING_DIRECT_ALIGNMENT == 0) {
+        status = uring_write_direct(file, addr, size, (const unsigned char *) buffer);
+    }
+    else {
+        status = uring_transfer(file, file->fd, true, addr, size, (unsigned char *) buffer);
+    }
+    if (status < 0) {
+        URING_ERROR(H5E_WRITEERROR, "file write failed");
+        return -1;
+    }
+    if (addr + size > file->eof) {
+        file->eof = addr + size;
+    }
+    return 0;
+}
+
+static herr_t uring_truncate(H5FD_t *_file, hid_t dxpl, hbool_t closing)
+{
+    uring_file *file = (uring_file *) _file;
+
+    (void) dxpl;
+    (void) closing;
+    if (file->eoa != file->eof) {
+        if (ftruncate(file->fd, (off_t) file->eoa) < 0) {
+            URING_ERROR(H5E_SEEKERROR, "unable to extend file properly");
+            return -1;
+        }
+        file->eof = file->eoa;
+    }
+    return 0;
+}
+
+#if H5_VERSION_GE(1, 10, 0)
+static herr_t uring_lock(H5FD_t *_file, hbool_t rw)
+{
+    if (flock(((uring_file *) _file)->fd, (rw ? LOCK_EX : LOCK_SH) | LOCK_NB) < 0 && errno != ENOSYS) {
+        URING_ERROR(H5E_CANTLOCKFILE, "unable to lock file");
+        return -1;
+    }
+    return 0;
+}
+
+static herr_t uring_unlock(H5FD_t *_file)
+{
+    if (flock(((uring_file *) _file)->fd, LOCK_UN) < 0 && errno != ENOSYS) {
+        URING_ERROR(H5E_CANTUNLOCKFILE, "unable to unlock file");
+        return -1;
+    }
+    return 0;
+}
+#endif
+
+static const H5FD_class_t uring_class = {
+#if H5_VERSION_GE(1, 14, 0)
+    .version = H5FD_CLASS_VERSION,
+    .value = (H5FD_class_value_t) 0x1d0,
+#endif
+    .name = URING_NAME,
+    .maxaddr = URING_MAXADDR,
+    .fc_degree = H5F_CLOSE_WEAK,
+    .fapl_size = sizeof(uring_config),
+    .fapl_get = uring_fapl_get,
+    .fapl_copy = uring_fapl_copy,
+    .fapl_free = uring_fapl_free,
+    .open = uring_open,
+    .close = uring_close,
+    .cmp = uring_cmp,
+    .query = uring_query,
+    .get_eoa = uring_get_eoa,
+    .set_eoa = uring_set_eoa,
+    .get_eof = uring_get_eof,
+    .get_handle = uring_get_handle,
+    .read = uring_read,
+    .write = uring_write,
+    .truncate = uring_truncate,
+#if H5_VERSION_GE(1, 10, 0)
+    .lock = uring_lock,
+    .unlock = uring_unlock,
+#endif
+    .fl_map = {H5FD_MEM_DRAW, H5FD_MEM_DRAW, H5FD_MEM_DRAW, H5FD_MEM_DRAW,
+               H5FD_MEM_DRAW, H5FD_MEM_DRAW, H5FD_MEM_DRAW}
+};
+
+int ismrmrd_set_fapl_io_uring(int64_t fapl, uint32_t queue_depth, size_t direct_size)
+{
+    uring_config config;
+
+    /* the id is gone once HDF5 is closed and reopened */
+    if (uring_driver_id < 0 || H5Iget_type(uring_driver_id) != H5I_VFL) {
+        uring_driver_id = H5FDregister(&uring_class);
+        if (uring_driver_id < 0) {
+            return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to register the io_uring file driver.");
+        }
+    }
+    config.queue_depth = queue_depth;
+    config.direct_size = direct_size;
+    if (H5Pset_driver((hid_t) fapl, uring_driver_id, &config) < 0) {
+        return ISMRMRD_PUSH_ERR(ISMRMRD_HDF5ERROR, "Failed to set the io_uring file driver.");
+    }
+    return ISMRMRD_NOERROR;
+}
+
+#else /* ISMRMRD_HAVE_IO_URING */
+
+int ismrmrd_set_fapl_io_uring(int64_t fapl, uint32_t queue_depth, size_t direct_size)
+{
+    /* built without io_uring, the file access keeps the default driver */
+    (void) fapl;
+    (void) queue_depth;
+    (void) direct_size;
+    return ISMRMRD_NOERROR;
+}
+
+#endif /* ISMRMRD_HAVE_IO_URING */
+
+#ifdef __cplusplus
+} /* extern "C" */
+} /* ISMRMRD namespace */
+#endif
@@ -0,0 +1,200 @@
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "ismrmrd/ismrmrd.h"
+#include "ismrmrd/dataset.h"
+
+using namespace ISMRMRD;
+
+
+static double now_seconds()
+{
+#ifdef WIN32
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  return static_cast<double>(counter.QuadPart) / frequency.QuadPart;
+#else
+  timeval t;
+  gettimeofday(&t, NULL);
+  return t.tv_sec + t.tv_usec * 1e-6;
+#endif
+}
+
+static double file_size(const std::string &filename)
+{
+  std::ifstream f(filename.c_str(), std::ios::binary | std::ios::ate);
+  return f ? static_cast<double>(f.tellg()) : 0.0;
+}
+
+struct Setting
+{
+  const char *name;
+  CompressionOptions compression;
+};
+
+static Setting make_setting(const char *name, int shuffle, int deflate_level, unsigned int filter_id)
+{
+  Setting s;
+  s.name = name;
+  DatasetOptions defaults;
+  ismrmrd_init_dataset_options(&defaults);
+  s.compression = defaults.acquisition_compression;
+  s.compression.shuffle = shuffle;
+  s.compression.deflate_level = deflate_level;
+  s.compression.filter_id = filter_id;
+  return s;
+}
+
+// NDArrays written by the Shepp-Logan generator
+static const char *array_names[] = { "phantom", "csm", "coil_images" };
+static const size_t num_array_names = sizeof(array_names) / sizeof(array_names[0]);
+
+
+int main(int argc, char** argv)
+{
+  std::cout << "Compression benchmark" << std::endl;
+
+  if (argc > 3) {
+    std::cout << "Usage: " << std::endl;
+    std::cout << "  " << argv[0] << " [<INPUT FILENAME> [<OUTPUT FILENAME>]]" << std::endl;
+    std::cout << "  The input defaults to testdata.h5 as written by ismrmrd_generate_cartesian_shepp_logan" << std::endl;
+    return -1;
+  }
+  std::string infile = argc > 1 ? argv[1] : "testdata.h5";
+  std::string outfile = argc > 2 ? argv[2] : "compression_benchmark.h5";
+
+  // Load everything into memory so that only the output file is timed
+  std::string xml;
+  std::vector<Acquisition> acqs;
+  std::vector<ISMRMRD_NDArray> arrays;
+  std::vector<std::string> array_vars;
+  double payload_bytes = 0.0;
+  try {
+    Dataset d(infile.c_str(), "dataset", false);
+    d.readHeader(xml);
+    d.readAcquisitions(0, d.getNumberOfAcquisitions(), acqs);
+  } catch (std::exception &e) {
+    std::cout << "Failed to read " << infile << ": " << e.what() << std::endl;
+    return -1;
+  }
+  for (size_t i = 0; i < acqs.size(); i++) {
+    payload_bytes += acqs[i].getDataSize() + acqs[i].getTrajSize();
+  }
+
+  ISMRMRD_Dataset in;
+  ismrmrd_init_dataset(&in, infile.c_str(), "dataset");
+  if (ismrmrd_open_dataset(&in, false) == ISMRMRD_NOERROR) {
+    for (size_t n = 0; n < num_array_names; n++) {
+      uint32_t count = ismrmrd_get_number_of_arrays(&in, array_names[n]);
+      for (uint32_t i = 0; i < count; i++) {
+        ISMRMRD_NDArray arr;
+        ismrmrd_init_ndarray(&arr);
+        if (ismrmrd_read_array(&in, array_names[n], i, &arr) == ISMRMRD_NOERROR) {
+          payload_bytes += ismrmrd_size_of_ndarray_data(&arr);
+          arrays.push_back(arr);
+          array_vars.push_back(array_names[n]);
+        }
+      }
+    }
+    ismrmrd_close_dataset(&in);
+  }
+
+  std::cout << "Input " << infile << ": " << acqs.size() << " acquisitions, " << arrays.size() << " arrays, "
+            << payload_bytes / (1024.0 * 1024.0) << " MB of payload" << std::endl;
+  if (payload_bytes == 0.0) {
+    return -1;
+  }
+
+  std::vector<Setting> settings;
+  settings.push_back(make_setting("none", 0, 0, 0));
+  settings.push_back(make_setting("shuffle+deflate1", 1, 1, 0));
+  settings.push_back(make_setting("shuffle+deflate6", 1, 6, 0));
+  settings.push_back(make_setting("lz", 0, 0, ISMRMRD_FILTER_LZ));
+  settings.push_back(make_setting("shuffle+lz", 1, 0, ISMRMRD_FILTER_LZ));
+
+  std::cout << std::left << std::setw(20) << "SETTING"
+            << std::right << std::setw(14) << "WRITE MB/s"
+            << std::setw(14) << "READ MB/s"
+            << std::setw(14) << "SIZE MB"
+            << std::setw(10) << "RATIO" << std::endl;
+
+  for (size_t s = 0; s < settings.size(); s++) {
+    std::remove(outfile.c_str());
+
+    DatasetOptions options;
+    ismrmrd_init_dataset_options(&options);
+    // vlen rows are not compressed, the flat layout is
+    options.acquisition_layout = ISMRMRD_LAYOUT_AUTO;
+    options.acquisition_compression = settings[s].compression;
+    options.array_compression = settings[s].compression;
+
+    double write_time, read_time;
+    try {
+      double start = now_seconds();
+      {
+        Dataset d(outfile.c_str(), "dataset", true, options);
+        d.writeHeader(xml);
+        d.appendAcquisitions(acqs);
+        for (size_t i = 0; i < arrays.size(); i++) {
+          d.appendNDArray(array_vars[i], &arrays[i]);
+        }
+      }
+      write_time = now_seconds() - start;
+
+      start = now_seconds();
+      {
+        std::vector<Acquisition> check;
+        Dataset d(outfile.c_str(), "dataset", false);
+        d.readAcquisitions(0, d.getNumberOfAcquisitions(), check);
+        if (check.size() != acqs.size()) {
+          throw std::runtime_error("Wrong number of acquisitions read back");
+        }
+      }
+      ISMRMRD_Dataset out;
+      ismrmrd_init_dataset(&out, outfile.c_str(), "dataset");
+      if (ismrmrd_open_dataset(&out, false) != ISMRMRD_NOERROR) {
+        throw std::runtime_error(build_exception_string());
+      }
+      for (size_t n = 0; n < num_array_names; n++) {
+        uint32_t count = ismrmrd_get_number_of_arrays(&out, array_names[n]);
+        for (uint32_t i = 0; i < count; i++) {
+          ISMRMRD_NDArray arr;
+          ismrmrd_init_ndarray(&arr);
+          ismrmrd_read_array(&out, array_names[n], i, &arr);
+          ismrmrd_cleanup_ndarray(&arr);
+        }
+      }
+      ismrmrd_close_dataset(&out);
+      read_time = now_seconds() - start;
+    } catch (std::exception &e) {
+      std::cout << settings[s].name << ": " << e.what() << std::endl;
+      continue;
+    }
+
+    double size = file_size(outfile);
+    std::cout << std::left << std::setw(20) << settings[s].name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(14) << payload_bytes / (1024.0 * 1024.0) / std::max(write_time, 1e-9)
+              << std::setw(14) << payload_bytes / (1024.0 * 1024.0) / std::max(read_time, 1e-9)
+              << std::setw(14) << size / (1024.0 * 1024.0)
+              << std::setw(10) << std::setprecision(2) << (size > 0.0 ? payload_bytes / size : 0.0)
+              << std::endl;
+  }
+  std::remove(outfile.c_str());
+
+  for (size_t i = 0; i < arrays.size(); i++) {
+    ismrmrd_cleanup_ndarray(&arrays[i]);
+  }
+  return 0;
+}
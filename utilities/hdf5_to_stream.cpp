@@ -0,0 +1,169 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include "ismrmrd/ismrmrd.h"
+#include "ismrmrd/dataset.h"
+#include "ismrmrd/stream.h"
+
+using namespace ISMRMRD;
+
+// Acquisitions read from the file at a time
+static const uint32_t batch_size = 1024;
+
+static void usage(const char *name)
+{
+  std::cerr << "Usage: " << std::endl;
+  std::cerr << "  " << name << " [-g <GROUP>] [-m <IMAGE VARIABLE>]... [-a <ARRAY VARIABLE>]... [-o <OUTPUT FILE>] -i <INPUT FILE>" << std::endl;
+  std::cerr << "  Writes the header, the acquisitions and the given image and array variables" << std::endl;
+  std::cerr << "  of a dataset as an ISMRMRD stream, to standard output by default" << std::endl;
+}
+
+static int fail(const std::string &what)
+{
+  std::cerr << what << ": " << build_exception_string() << std::endl;
+  return -1;
+}
+
+static int write_stream(ISMRMRD_Dataset &dset, StreamWriter &writer,
+                        const std::vector<std::string> &image_vars, const std::vector<std::string> &array_vars)
+{
+  char *xml = ismrmrd_read_header(&dset);
+  if (xml != NULL) {
+    writer.writeHeader(xml);
+    free(xml);
+  }
+
+  uint32_t count = ismrmrd_get_number_of_acquisitions(&dset);
+  std::vector<ISMRMRD_Acquisition> acqs(std::min(count, batch_size));
+  for (size_t i = 0; i < acqs.size(); i++) {
+    ismrmrd_init_acquisition(&acqs[i]);
+  }
+  int status = ISMRMRD_NOERROR;
+  for (uint32_t start = 0; start < count && status == ISMRMRD_NOERROR; start += batch_size) {
+    uint32_t n = std::min(count - start, batch_size);
+    status = ismrmrd_read_acquisitions(&dset, start, n, &acqs[0]);
+    for (uint32_t i = 0; i < n && status == ISMRMRD_NOERROR; i++) {
+      writer.writeAcquisition(&acqs[i]);
+    }
+  }
+  for (size_t i = 0; i < acqs.size(); i++) {
+    ismrmrd_cleanup_acquisition(&acqs[i]);
+  }
+  if (status != ISMRMRD_NOERROR) {
+    return fail("Failed to read acquisitions");
+  }
+
+  for (size_t v = 0; v < image_vars.size(); v++) {
+    ISMRMRD_Image im;
+    ismrmrd_init_image(&im);
+    uint32_t num = ismrmrd_get_number_of_images(&dset, image_vars[v].c_str());
+    for (uint32_t i = 0; i < num && status == ISMRMRD_NOERROR; i++) {
+      status = ismrmrd_read_image(&dset, image_vars[v].c_str(), i, &im);
+      if (status == ISMRMRD_NOERROR) {
+        writer.writeImage(image_vars[v], &im);
+      }
+    }
+    ismrmrd_cleanup_image(&im);
+    if (status != ISMRMRD_NOERROR) {
+      return fail("Failed to read images of " + image_vars[v]);
+    }
+  }
+
+  for (size_t v = 0; v < array_vars.size(); v++) {
+    ISMRMRD_NDArray arr;
+    ismrmrd_init_ndarray(&arr);
+    uint32_t num = ismrmrd_get_number_of_arrays(&dset, array_vars[v].c_str());
+    for (uint32_t i = 0; i < num && status == ISMRMRD_NOERROR; i++) {
+      status = ismrmrd_read_array(&dset, array_vars[v].c_str(), i, &arr);
+      if (status == ISMRMRD_NOERROR) {
+        writer.writeNDArray(array_vars[v], &arr);
+      }
+    }
+    ismrmrd_cleanup_ndarray(&arr);
+    if (status != ISMRMRD_NOERROR) {
+      return fail("Failed to read arrays of " + array_vars[v]);
+    }
+  }
+
+  writer.close();
+  return 0;
+}
+
+int main(int argc, char** argv)
+{
+  std::string group = "dataset";
+  std::string infile, outfile;
+  std::vector<std::string> image_vars, array_vars;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if ((arg == "-g" || arg == "-i" || arg == "-m" || arg == "-a" || arg == "-o") && i + 1 < argc) {
+      std::string value = argv[++i];
+      if (arg == "-g") {
+        group = value;
+      } else if (arg == "-i") {
+        infile = value;
+      } else if (arg == "-m") {
+        image_vars.push_back(value);
+      } else if (arg == "-a") {
+        array_vars.push_back(value);
+      } else {
+        outfile = value;
+      }
+    } else if (infile.empty() && arg[0] != '-') {
+      infile = arg;
+    } else {
+      usage(argv[0]);
+      return -1;
+    }
+  }
+  if (infile.empty()) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  ISMRMRD_Dataset dset;
+  if (ismrmrd_init_dataset(&dset, infile.c_str(), group.c_str()) != ISMRMRD_NOERROR ||
+      ismrmrd_open_dataset(&dset, false) != ISMRMRD_NOERROR) {
+    return fail("Failed to open " + infile);
+  }
+
+  int result;
+  try {
+    if (outfile.empty()) {
+#ifdef _WIN32
+      _setmode(_fileno(stdout), _O_BINARY);
+#endif
+      StreamWriter writer(fileno(stdout));
+      result = write_stream(dset, writer, image_vars, array_vars);
+    } else {
+      std::ofstream os(outfile.c_str(), std::ios::binary);
+      if (!os) {
+        std::cerr << "Failed to open " << outfile << std::endl;
+        ismrmrd_close_dataset(&dset);
+        return -1;
+      }
+      StreamWriter writer(os);
+      result = write_stream(dset, writer, image_vars, array_vars);
+    }
+  } catch (std::exception &e) {
+    std::cerr << "Failed to write stream: " << e.what() << std::endl;
+    result = -1;
+  }
+
+  ismrmrd_close_dataset(&dset);
+  free(dset.filename);
+  free(dset.groupname);
+  return result;
+}
@@ -6,6 +6,8 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
+#include <algorithm>
 
 #include "ismrmrd/ismrmrd.h"
 #include "ismrmrd/dataset.h"
@@ -80,6 +82,31 @@ int main(int argc, char** argv)
         //We'll just throw the data away here. 
     }
   }
+
+  {
+    Timer t("BATCHED READ TIMER");
+    ISMRMRD::Dataset d(argv[1],"dataset", false);
+    uint32_t number_of_acquisitions = d.getNumberOfAcquisitions();
+    const uint32_t batch_size = 1024;
+    std::vector<ISMRMRD::Acquisition> acqs;
+    for (uint32_t i = 0; i < number_of_acquisitions; i += batch_size) {
+        uint32_t count = std::min(batch_size, number_of_acquisitions - i);
+        d.readAcquisitions(i, count, acqs);
+        //We'll just throw the data away here. 
+    }
+  }
+
+  {
+    Timer t("HEADER SCAN TIMER");
+    ISMRMRD::Dataset d(argv[1],"dataset", false);
+    uint32_t number_of_acquisitions = d.getNumberOfAcquisitions();
+    const uint32_t batch_size = 1024;
+    std::vector<ISMRMRD::AcquisitionHeader> heads;
+    for (uint32_t i = 0; i < number_of_acquisitions; i += batch_size) {
+        uint32_t count = std::min(batch_size, number_of_acquisitions - i);
+        d.readAcquisitionHeaders(i, count, heads);
+    }
+  }
   
   return 0;
 }
@@ -0,0 +1,133 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+#include "ismrmrd/ismrmrd.h"
+#include "ismrmrd/dataset.h"
+#include "ismrmrd/stream.h"
+
+using namespace ISMRMRD;
+
+// Acquisitions appended to the file at a time
+static const size_t batch_size = 1024;
+
+static void usage(const char *name)
+{
+  std::cerr << "Usage: " << std::endl;
+  std::cerr << "  " << name << " [-g <GROUP>] [-i <INPUT FILE>] -o <OUTPUT FILE>" << std::endl;
+  std::cerr << "  Appends the messages of an ISMRMRD stream, read from standard input by default," << std::endl;
+  std::cerr << "  to a dataset" << std::endl;
+}
+
+static void read_stream(StreamReader &reader, Dataset &d)
+{
+  std::vector<Acquisition> acqs(batch_size);
+  size_t num_acqs = 0;
+  std::string xml, var;
+  ISMRMRD_Image im;
+  ISMRMRD_NDArray arr;
+  ismrmrd_init_image(&im);
+  ismrmrd_init_ndarray(&arr);
+
+  try {
+    for (;;) {
+      uint16_t id = reader.nextMessage();
+      if (id == ISMRMRD_STREAM_CLOSE) {
+        break;
+      }
+      switch (id) {
+      case ISMRMRD_STREAM_HEADER:
+        reader.readHeader(xml);
+        d.writeHeader(xml);
+        break;
+      case ISMRMRD_STREAM_ACQUISITION:
+        reader.readAcquisition(acqs[num_acqs++]);
+        if (num_acqs == acqs.size()) {
+          d.appendAcquisitions(acqs);
+          num_acqs = 0;
+        }
+        break;
+      case ISMRMRD_STREAM_IMAGE:
+        reader.readImage(var, &im);
+        d.appendImage(var, &im);
+        break;
+      case ISMRMRD_STREAM_NDARRAY:
+        reader.readNDArray(var, &arr);
+        d.appendNDArray(var, &arr);
+        break;
+      default:
+        std::cerr << "Skipping unknown message " << id << std::endl;
+        reader.skipMessage();
+        break;
+      }
+    }
+    if (num_acqs > 0) {
+      acqs.resize(num_acqs);
+      d.appendAcquisitions(acqs);
+    }
+  } catch (...) {
+    ismrmrd_cleanup_image(&im);
+    ismrmrd_cleanup_ndarray(&arr);
+    throw;
+  }
+  ismrmrd_cleanup_image(&im);
+  ismrmrd_cleanup_ndarray(&arr);
+}
+
+int main(int argc, char** argv)
+{
+  std::string group = "dataset";
+  std::string infile, outfile;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if ((arg == "-g" || arg == "-i" || arg == "-o") && i + 1 < argc) {
+      if (arg == "-g") {
+        group = argv[++i];
+      } else if (arg == "-i") {
+        infile = argv[++i];
+      } else {
+        outfile = argv[++i];
+      }
+    } else if (outfile.empty() && arg[0] != '-') {
+      outfile = arg;
+    } else {
+      usage(argv[0]);
+      return -1;
+    }
+  }
+  if (outfile.empty()) {
+    usage(argv[0]);
+    return -1;
+  }
+
+  try {
+    Dataset d(outfile.c_str(), group.c_str(), true);
+    if (infile.empty()) {
+#ifdef _WIN32
+      _setmode(_fileno(stdin), _O_BINARY);
+#endif
+      StreamReader reader(fileno(stdin));
+      read_stream(reader, d);
+    } else {
+      std::ifstream is(infile.c_str(), std::ios::binary);
+      if (!is) {
+        std::cerr << "Failed to open " << infile << std::endl;
+        return -1;
+      }
+      StreamReader reader(is);
+      read_stream(reader, d);
+    }
+  } catch (std::exception &e) {
+    std::cerr << "Failed to convert stream: " << e.what() << std::endl;
+    return -1;
+  }
+  return 0;
+}